@@ -57,6 +57,7 @@
  * To create an instance of AIQ library one must call function:
  * \code ia_aiq_init \endcode
  * \copydetails ia_aiq_init
+ * Instances for several identical camera modules can share the parsed CMC with \link ia_aiq_clone.h \endlink.
  *
  * <br><hr><br>
  *
@@ -87,6 +88,11 @@
  * \section running Running AIQ algorithms
  *
  * Once the AIQ instance is initialized and statistics are set, algorithms can be run in any order.
+ * Algorithms of one instance must not be run concurrently. AE, AWB and AF can be run in parallel on separate instances
+ * with \link ia_aiq_parallel.h \endlink.
+ * Algorithms of multiple AIQ instances (e.g. one per camera) can be run concurrently with \link ia_aiq_batch.h \endlink.
+ * Algorithms can be run without blocking the calling thread with \link ia_aiq_async.h \endlink.
+ * Algorithms can be run at a tunable rate lower than the frame rate with \link ia_aiq_scheduler.h \endlink.
  * \subsection af AF
  * \copybrief ia_aiq_af_run
  * \code ia_aiq_af_run \endcode
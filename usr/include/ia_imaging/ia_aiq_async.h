@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_async.h
+ * \brief Non-blocking submission of AIQ algorithm runs.
+ *
+ * ia_aiq_async owns a worker thread per AIQ instance. Requests submitted to it are executed in submission order on the worker
+ * thread, so the client thread can continue (for example with statistics conversion of the next frame) while 3A is running.
+ * Completion is signalled with a callback, by writing to an eventfd (or any file descriptor accepting 8 byte writes), or both.
+ *
+ * All AIQ calls on the wrapped instance must go through the async handle while it exists, because AIQ instances are not
+ * thread-safe. Input parameters, and everything they point to, must stay valid until the request has completed.
+ * Results are owned by the AIQ instance as with the synchronous functions and are valid until the same algorithm is run again.
+ */
+
+#ifndef _IA_AIQ_ASYNC_H_
+#define _IA_AIQ_ASYNC_H_
+
+#include "ia_aiq.h"
+#include "ia_task.h"
+
+#ifdef IA_TASK_HAS_PTHREAD
+#include <stdint.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Default maximum number of requests which can be pending at the same time.
+ */
+#define IA_AIQ_ASYNC_DEFAULT_QUEUE_DEPTH 16
+
+/*!
+ * \brief Algorithm to run.
+ */
+typedef enum
+{
+    ia_aiq_async_op_statistics_set, /*!< ia_aiq_statistics_set_v1. input_params: ia_aiq_statistics_input_params_v1. results: unused. */
+    ia_aiq_async_op_ae,             /*!< ia_aiq_ae_run. input_params: ia_aiq_ae_input_params. results: ia_aiq_ae_results**. */
+    ia_aiq_async_op_af,             /*!< ia_aiq_af_run. input_params: ia_aiq_af_input_params. results: ia_aiq_af_results**. */
+    ia_aiq_async_op_awb,            /*!< ia_aiq_awb_run. input_params: ia_aiq_awb_input_params. results: ia_aiq_awb_results**. */
+    ia_aiq_async_op_gbce,           /*!< ia_aiq_gbce_run. input_params: ia_aiq_gbce_input_params. results: ia_aiq_gbce_results**. */
+    ia_aiq_async_op_dsd,            /*!< ia_aiq_dsd_run. input_params: ia_aiq_dsd_input_params. results: ia_aiq_scene_mode*. */
+    ia_aiq_async_op_sa,             /*!< ia_aiq_sa_run. input_params: ia_aiq_sa_input_params. results: ia_aiq_sa_results**. */
+    ia_aiq_async_op_pa              /*!< ia_aiq_pa_run_v1. input_params: ia_aiq_pa_input_params. results: ia_aiq_pa_results_v1**. */
+} ia_aiq_async_op;
+
+struct ia_aiq_async_request;
+
+/*!
+ * \brief Completion callback. Called on the worker thread after the algorithm has been run.
+ * \param[in] user_data  User data given in the request.
+ * \param[in] request    Completed request.
+ * \param[in] err        Error code returned by the algorithm.
+ */
+typedef void (*ia_aiq_async_callback)(void *user_data,
+                                      const struct ia_aiq_async_request *request,
+                                      ia_err err);
+
+/*!
+ * \brief Asynchronous algorithm run request.
+ */
+typedef struct ia_aiq_async_request
+{
+    ia_aiq_async_op op;                 /*!< Mandatory. Algorithm to run. */
+    const void *input_params;           /*!< Mandatory. Input parameters of the algorithm. Type depends on op. */
+    void *results;                      /*!< Mandatory (except for statistics set). Where the algorithm writes its results. Type depends on op. */
+    unsigned long long frame_id;        /*!< Optional. Client specific identifier passed back in completion. */
+    ia_aiq_async_callback callback;     /*!< Optional. Called when the request has completed. */
+    void *user_data;                    /*!< Optional. Passed to the callback. */
+    int event_fd;                       /*!< Optional. If >= 0, an 8 byte counter value of 1 is written to the descriptor after the callback. -1 if N/A. */
+} ia_aiq_async_request;
+
+/*!
+ * \brief Async AIQ handle.
+ */
+typedef struct
+{
+    ia_aiq *ia_aiq;                     /*!< Wrapped AIQ instance. */
+    ia_aiq_async_request *queue;        /*!< Ring buffer of pending requests. */
+    unsigned int queue_depth;           /*!< Capacity of the ring buffer. */
+    unsigned int head;                  /*!< Index of the next request to execute. */
+    unsigned int count;                 /*!< Number of queued requests. */
+    bool busy;                          /*!< Worker is executing a request. */
+    bool shutdown;                      /*!< Worker shall exit when the queue is empty. */
+#ifdef IA_TASK_HAS_PTHREAD
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;           /*!< Signalled when a request is queued or shutdown is requested. */
+    pthread_cond_t idle_cond;           /*!< Signalled when a request completes. */
+    pthread_t worker;
+#endif
+} ia_aiq_async;
+
+static inline ia_err
+ia_aiq_async_execute(ia_aiq *ia_aiq, const ia_aiq_async_request *request)
+{
+    ia_err err;
+
+    switch (request->op)
+    {
+    case ia_aiq_async_op_statistics_set:
+        err = ia_aiq_statistics_set_v1(ia_aiq, (const ia_aiq_statistics_input_params_v1 *)request->input_params);
+        break;
+    case ia_aiq_async_op_ae:
+        err = ia_aiq_ae_run(ia_aiq, (const ia_aiq_ae_input_params *)request->input_params, (ia_aiq_ae_results **)request->results);
+        break;
+    case ia_aiq_async_op_af:
+        err = ia_aiq_af_run(ia_aiq, (const ia_aiq_af_input_params *)request->input_params, (ia_aiq_af_results **)request->results);
+        break;
+    case ia_aiq_async_op_awb:
+        err = ia_aiq_awb_run(ia_aiq, (const ia_aiq_awb_input_params *)request->input_params, (ia_aiq_awb_results **)request->results);
+        break;
+    case ia_aiq_async_op_gbce:
+        err = ia_aiq_gbce_run(ia_aiq, (const ia_aiq_gbce_input_params *)request->input_params, (ia_aiq_gbce_results **)request->results);
+        break;
+    case ia_aiq_async_op_dsd:
+        err = ia_aiq_dsd_run(ia_aiq, (const ia_aiq_dsd_input_params *)request->input_params, (ia_aiq_scene_mode *)request->results);
+        break;
+    case ia_aiq_async_op_sa:
+        err = ia_aiq_sa_run(ia_aiq, (const ia_aiq_sa_input_params *)request->input_params, (ia_aiq_sa_results **)request->results);
+        break;
+    case ia_aiq_async_op_pa:
+        err = ia_aiq_pa_run_v1(ia_aiq, (const ia_aiq_pa_input_params *)request->input_params, (ia_aiq_pa_results_v1 **)request->results);
+        break;
+    default:
+        err = ia_err_argument;
+        break;
+    }
+
+    if (request->callback != NULL)
+        request->callback(request->user_data, request, err);
+
+#ifdef IA_TASK_HAS_PTHREAD
+    if (request->event_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(request->event_fd, &one, sizeof(one));
+        IA_UNUSED(written);
+    }
+#endif
+    return err;
+}
+
+#ifdef IA_TASK_HAS_PTHREAD
+static inline void *
+ia_aiq_async_worker(void *async_ptr)
+{
+    ia_aiq_async *async = (ia_aiq_async *)async_ptr;
+    ia_aiq_async_request request;
+
+    pthread_mutex_lock(&async->lock);
+    for (;;) {
+        while (async->count == 0 && !async->shutdown)
+            pthread_cond_wait(&async->work_cond, &async->lock);
+        if (async->count == 0)
+            break;
+
+        request = async->queue[async->head];
+        async->head = (async->head + 1) % async->queue_depth;
+        async->count--;
+        async->busy = true;
+        pthread_mutex_unlock(&async->lock);
+
+        ia_aiq_async_execute(async->ia_aiq, &request);
+
+        pthread_mutex_lock(&async->lock);
+        async->busy = false;
+        pthread_cond_broadcast(&async->idle_cond);
+    }
+    pthread_mutex_unlock(&async->lock);
+    return NULL;
+}
+#endif
+
+/*!
+ * \brief Creates async wrapper and its worker thread for an AIQ instance.
+ *
+ * \param[in] ia_aiq       Mandatory. AIQ instance handle. Ownership is not transferred.
+ * \param[in] queue_depth  Maximum number of pending requests. 0 to use IA_AIQ_ASYNC_DEFAULT_QUEUE_DEPTH.
+ * \return                 Async handle or NULL in case of an error.
+ */
+static inline ia_aiq_async *
+ia_aiq_async_init(ia_aiq *ia_aiq, unsigned int queue_depth)
+{
+    ia_aiq_async *async;
+
+    if (ia_aiq == NULL)
+        return NULL;
+    if (queue_depth == 0)
+        queue_depth = IA_AIQ_ASYNC_DEFAULT_QUEUE_DEPTH;
+
+    async = (ia_aiq_async *)IA_CALLOC(sizeof(ia_aiq_async));
+    if (async == NULL)
+        return NULL;
+    async->queue = (ia_aiq_async_request *)IA_CALLOC(queue_depth * sizeof(ia_aiq_async_request));
+    if (async->queue == NULL) {
+        IA_FREEZ(async);
+        return NULL;
+    }
+    async->ia_aiq = ia_aiq;
+    async->queue_depth = queue_depth;
+
+#ifdef IA_TASK_HAS_PTHREAD
+    pthread_mutex_init(&async->lock, NULL);
+    pthread_cond_init(&async->work_cond, NULL);
+    pthread_cond_init(&async->idle_cond, NULL);
+    if (pthread_create(&async->worker, NULL, ia_aiq_async_worker, async) != 0) {
+        pthread_cond_destroy(&async->idle_cond);
+        pthread_cond_destroy(&async->work_cond);
+        pthread_mutex_destroy(&async->lock);
+        IA_FREEZ(async->queue);
+        IA_FREEZ(async);
+        return NULL;
+    }
+#endif
+    return async;
+}
+
+/*!
+ * \brief Queues a request for execution.
+ * Function doesn't wait for the algorithm. On platforms without thread support the request is executed before returning.
+ *
+ * \param[in] async    Mandatory. Async handle.
+ * \param[in] request  Mandatory. Request. Copied into the queue, so the structure itself may be reused after the call.
+ * \return             Error code. ia_err_general if the queue is full.
+ */
+static inline ia_err
+ia_aiq_async_submit(ia_aiq_async *async, const ia_aiq_async_request *request)
+{
+    if (async == NULL || request == NULL || request->input_params == NULL)
+        return ia_err_argument;
+    if (request->results == NULL && request->op != ia_aiq_async_op_statistics_set)
+        return ia_err_argument;
+
+#ifdef IA_TASK_HAS_PTHREAD
+    pthread_mutex_lock(&async->lock);
+    if (async->count == async->queue_depth || async->shutdown) {
+        pthread_mutex_unlock(&async->lock);
+        return ia_err_general;
+    }
+    async->queue[(async->head + async->count) % async->queue_depth] = *request;
+    async->count++;
+    pthread_cond_signal(&async->work_cond);
+    pthread_mutex_unlock(&async->lock);
+    return ia_err_none;
+#else
+    ia_aiq_async_execute(async->ia_aiq, request);
+    return ia_err_none;
+#endif
+}
+
+/*!
+ * \brief Waits until all submitted requests have completed.
+ * After this call the wrapped AIQ instance can also be accessed synchronously until next submit.
+ *
+ * \param[in] async    Mandatory. Async handle.
+ */
+static inline void
+ia_aiq_async_flush(ia_aiq_async *async)
+{
+    if (async == NULL)
+        return;
+#ifdef IA_TASK_HAS_PTHREAD
+    pthread_mutex_lock(&async->lock);
+    while (async->count > 0 || async->busy)
+        pthread_cond_wait(&async->idle_cond, &async->lock);
+    pthread_mutex_unlock(&async->lock);
+#endif
+}
+
+/*!
+ * \brief Completes pending requests and destroys the async wrapper.
+ * The wrapped AIQ instance is not de-initialized.
+ *
+ * \param[in] async    Mandatory. Async handle.
+ */
+static inline void
+ia_aiq_async_deinit(ia_aiq_async *async)
+{
+    if (async == NULL)
+        return;
+#ifdef IA_TASK_HAS_PTHREAD
+    pthread_mutex_lock(&async->lock);
+    async->shutdown = true;
+    pthread_cond_signal(&async->work_cond);
+    pthread_mutex_unlock(&async->lock);
+    pthread_join(async->worker, NULL);
+    pthread_cond_destroy(&async->idle_cond);
+    pthread_cond_destroy(&async->work_cond);
+    pthread_mutex_destroy(&async->lock);
+#endif
+    IA_FREEZ(async->queue);
+    IA_FREEZ(async);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_AIQ_ASYNC_H_ */
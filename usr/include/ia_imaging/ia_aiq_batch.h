@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_batch.h
+ * \brief Running AIQ algorithms of multiple AIQ instances (cameras) in one call.
+ *
+ * AIQ instances don't share state, so the per-frame algorithm chains of different cameras can be executed concurrently.
+ * ia_aiq_run_batch runs the chain statistics set -> AE -> AWB -> GBCE -> SA -> PA of each instance as one work item and
+ * distributes the work items to a worker pool (see ia_task.h). Algorithms of one instance are always run in the
+ * above order on one thread, so a single AIQ handle must not appear twice in the same batch.
+ */
+
+#ifndef _IA_AIQ_BATCH_H_
+#define _IA_AIQ_BATCH_H_
+
+#include "ia_aiq.h"
+#include "ia_task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Per-instance inputs and outputs of one batched AIQ run.
+ * Algorithms whose input parameters are NULL are skipped and their result pointer is set to NULL.
+ */
+typedef struct
+{
+    ia_aiq *ia_aiq;                                             /*!< Mandatory. AIQ instance handle. Must be unique within the batch. */
+    const ia_aiq_statistics_input_params_v1 *statistics_input_params; /*!< Optional. Statistics of the frame. Statistics are not updated, if NULL. */
+    const ia_aiq_ae_input_params *ae_input_params;              /*!< Optional. Input parameters for AEC. */
+    const ia_aiq_awb_input_params *awb_input_params;            /*!< Optional. Input parameters for AWB. */
+    const ia_aiq_gbce_input_params *gbce_input_params;          /*!< Optional. Input parameters for GBCE. */
+    const ia_aiq_sa_input_params *sa_input_params;              /*!< Optional. Input parameters for SA. If awb_results is NULL, AWB results of this run are used. */
+    const ia_aiq_pa_input_params *pa_input_params;              /*!< Optional. Input parameters for PA. If awb_results or exposure_params are NULL,
+                                                                     AWB results and the first exposure of AEC results of this run are used. */
+    ia_aiq_ae_results *ae_results;                              /*!< Output. AEC results. */
+    ia_aiq_awb_results *awb_results;                            /*!< Output. AWB results. */
+    ia_aiq_gbce_results *gbce_results;                          /*!< Output. GBCE results. */
+    ia_aiq_sa_results *sa_results;                              /*!< Output. SA results. */
+    ia_aiq_pa_results_v1 *pa_results;                           /*!< Output. PA results. */
+    ia_err err;                                                 /*!< Output. Combined error code of all algorithms run for this instance. */
+} ia_aiq_batch_item;
+
+static inline void
+ia_aiq_batch_run_item(void *items_ptr, unsigned int index)
+{
+    ia_aiq_batch_item *item = &((ia_aiq_batch_item *)items_ptr)[index];
+    int err = ia_err_none;
+
+    item->ae_results = NULL;
+    item->awb_results = NULL;
+    item->gbce_results = NULL;
+    item->sa_results = NULL;
+    item->pa_results = NULL;
+
+    if (item->ia_aiq == NULL) {
+        item->err = ia_err_argument;
+        return;
+    }
+
+    if (item->statistics_input_params != NULL)
+        err |= ia_aiq_statistics_set_v1(item->ia_aiq, item->statistics_input_params);
+
+    if (item->ae_input_params != NULL)
+        err |= ia_aiq_ae_run(item->ia_aiq, item->ae_input_params, &item->ae_results);
+
+    if (item->awb_input_params != NULL)
+        err |= ia_aiq_awb_run(item->ia_aiq, item->awb_input_params, &item->awb_results);
+
+    if (item->gbce_input_params != NULL)
+        err |= ia_aiq_gbce_run(item->ia_aiq, item->gbce_input_params, &item->gbce_results);
+
+    if (item->sa_input_params != NULL) {
+        ia_aiq_sa_input_params sa_input_params = *item->sa_input_params;
+        if (sa_input_params.awb_results == NULL)
+            sa_input_params.awb_results = item->awb_results;
+        err |= ia_aiq_sa_run(item->ia_aiq, &sa_input_params, &item->sa_results);
+    }
+
+    if (item->pa_input_params != NULL) {
+        ia_aiq_pa_input_params pa_input_params = *item->pa_input_params;
+        if (pa_input_params.awb_results == NULL)
+            pa_input_params.awb_results = item->awb_results;
+        if (pa_input_params.exposure_params == NULL && item->ae_results != NULL && item->ae_results->num_exposures > 0)
+            pa_input_params.exposure_params = item->ae_results->exposures[0].exposure;
+        err |= ia_aiq_pa_run_v1(item->ia_aiq, &pa_input_params, &item->pa_results);
+    }
+
+    item->err = (ia_err)err;
+}
+
+/*!
+ * \brief Runs AIQ algorithms for multiple AIQ instances.
+ * Each item is executed as one work item in the given worker pool. Function returns when algorithms of all instances have been run.
+ * Results stay valid until the next run of the corresponding algorithm on the same AIQ instance, as with the non-batched functions.
+ *
+ * \param[in]     task_env   Optional. Client worker pool. NULL to use the default executor of ia_task_run.
+ * \param[in,out] items      Mandatory. Array of per-instance inputs. Outputs are written to the same items.
+ * \param[in]     num_items  Mandatory. Number of items in the array.
+ * \return                   ia_err_none if all algorithms succeeded. Otherwise combination of error codes of all items.
+ */
+static inline ia_err
+ia_aiq_run_batch(const ia_task_env *task_env,
+                 ia_aiq_batch_item *items,
+                 unsigned int num_items)
+{
+    int err = ia_err_none;
+    unsigned int i;
+
+    if (items == NULL || num_items == 0)
+        return ia_err_argument;
+
+    ia_task_run(task_env, ia_aiq_batch_run_item, items, num_items);
+
+    for (i = 0; i < num_items; i++)
+        err |= items[i].err;
+
+    return (ia_err)err;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_AIQ_BATCH_H_ */
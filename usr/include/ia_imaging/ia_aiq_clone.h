@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_clone.h
+ * \brief Creating several AIQ instances for identical camera modules.
+ *
+ * ia_aiq_shared holds the read-only inputs of AIQ initialization: AIQB, NVM and the parsed CMC. The CMC is parsed only once
+ * and all instances created with ia_aiq_clone refer to the same ia_cmc_t, so opening an additional stream for an identical
+ * module doesn't parse the AIQB and NVM into a new CMC structure. ia_aiq_clone can take an existing instance as a source,
+ * in which case the run-time state collected by the source (AIQD) is carried over and the new instance starts from the same
+ * converged state instead of from defaults.
+ *
+ * Instances created from the same shared context are independent AIQ instances. They can run in parallel threads, one
+ * thread per instance.
+ */
+
+#ifndef _IA_AIQ_CLONE_H_
+#define _IA_AIQ_CLONE_H_
+
+#include "ia_aiq.h"
+#include "ia_cmc_parser.h"
+#include "ia_abstraction.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Shared initialization context of AIQ instances.
+ * Binary data given to ia_aiq_shared_init is referred to, not copied. It must be kept available by client until
+ * ia_aiq_shared_deinit.
+ */
+typedef struct
+{
+    ia_binary_data aiqb_data;       /*!< Tuning parameters for AIQ algorithms. */
+    ia_binary_data nvm_data;        /*!< NVM data. Size 0, if not given. */
+    ia_binary_data aiqd_data;       /*!< AIQD used for instances which are created without source instance. Size 0, if not given. */
+    unsigned int stats_max_width;   /*!< Maximum width of statistics grids. */
+    unsigned int stats_max_height;  /*!< Maximum height of statistics grids. */
+    unsigned int max_num_stats_in;  /*!< Maximum number of input statistics for one frame. */
+    ia_cmc_t *ia_cmc;               /*!< Parsed CMC shared by all instances. */
+    bool owns_cmc;                  /*!< CMC was parsed by ia_aiq_shared_init and is released in ia_aiq_shared_deinit. */
+    unsigned int num_instances;     /*!< Number of living instances created with ia_aiq_clone. */
+} ia_aiq_shared;
+
+static inline const ia_binary_data *
+ia_aiq_shared_binary(const ia_binary_data *data)
+{
+    return (data->data != NULL && data->size > 0) ? data : NULL;
+}
+
+/*!
+ * \brief Creates shared initialization context.
+ * Parameters are the same as in ia_aiq_init.
+ *
+ * \param[in] aiqb_data         Mandatory. Tuning parameters for AIQ algorithms.
+ * \param[in] nvm_data          Optional. NVM data.
+ * \param[in] aiqd_data         Optional. AIQD for instances created without source instance.
+ * \param[in] stats_max_width   Mandatory. Maximum width of RGBS and AF statistics grids from ISP.
+ * \param[in] stats_max_height  Mandatory. Maximum height of RGBS and AF statistics grids from ISP.
+ * \param[in] max_num_stats_in  Mandatory. The maximum number of input statistics for one frame.
+ * \param[in] ia_cmc            Optional. Already parsed CMC. If NULL, CMC is parsed from AIQB and NVM.
+ *                              If given, it must be kept available by client until ia_aiq_shared_deinit.
+ * \return                      Shared context or NULL in case of an error.
+ */
+static inline ia_aiq_shared *
+ia_aiq_shared_init(const ia_binary_data *aiqb_data,
+                   const ia_binary_data *nvm_data,
+                   const ia_binary_data *aiqd_data,
+                   unsigned int stats_max_width,
+                   unsigned int stats_max_height,
+                   unsigned int max_num_stats_in,
+                   ia_cmc_t *ia_cmc)
+{
+    ia_aiq_shared *shared;
+
+    if (aiqb_data == NULL || aiqb_data->data == NULL || aiqb_data->size == 0)
+        return NULL;
+
+    shared = (ia_aiq_shared *)IA_CALLOC(sizeof(ia_aiq_shared));
+    if (shared == NULL)
+        return NULL;
+
+    shared->aiqb_data = *aiqb_data;
+    if (nvm_data != NULL)
+        shared->nvm_data = *nvm_data;
+    if (aiqd_data != NULL)
+        shared->aiqd_data = *aiqd_data;
+    shared->stats_max_width = stats_max_width;
+    shared->stats_max_height = stats_max_height;
+    shared->max_num_stats_in = max_num_stats_in;
+
+    shared->ia_cmc = ia_cmc;
+    if (shared->ia_cmc == NULL) {
+        shared->ia_cmc = ia_cmc_parser_init_v1(&shared->aiqb_data, ia_aiq_shared_binary(&shared->nvm_data));
+        if (shared->ia_cmc == NULL) {
+            IA_FREEZ(shared);
+            return NULL;
+        }
+        shared->owns_cmc = true;
+    }
+    return shared;
+}
+
+/*!
+ * \brief Creates AIQ instance from shared initialization context.
+ * Shared context is not thread-safe. Creating and deleting instances must be serialized by client.
+ *
+ * \param[in,out] shared  Mandatory. Shared initialization context.
+ * \param[in]     source  Optional. Instance to clone the run-time state from. Must have been created with the same AIQB.
+ *                        Source is not modified, but it must not be running algorithms in another thread during the call.
+ *                        If NULL, AIQD of the shared context (if any) is used.
+ * \param[in,out] ia_mkn  Optional. Makernote handle of the new instance. Makernote can't be shared between instances.
+ * \return                AIQ handle or NULL in case of an error. Delete with ia_aiq_clone_deinit.
+ */
+static inline ia_aiq *
+ia_aiq_clone(ia_aiq_shared *shared,
+             ia_aiq *source,
+             ia_mkn *ia_mkn)
+{
+    ia_binary_data aiqd_data = { NULL, 0 };
+    ia_aiq *ia_aiq;
+
+    if (shared == NULL)
+        return NULL;
+
+    if (source != NULL) {
+        if (ia_aiq_get_aiqd_data(source, &aiqd_data) != ia_err_none)
+            return NULL;
+    } else {
+        aiqd_data = shared->aiqd_data;
+    }
+
+    ia_aiq = ia_aiq_init(&shared->aiqb_data,
+                         ia_aiq_shared_binary(&shared->nvm_data),
+                         ia_aiq_shared_binary(&aiqd_data),
+                         shared->stats_max_width,
+                         shared->stats_max_height,
+                         shared->max_num_stats_in,
+                         shared->ia_cmc,
+                         ia_mkn);
+    if (ia_aiq != NULL)
+        shared->num_instances++;
+    return ia_aiq;
+}
+
+/*!
+ * \brief Deletes AIQ instance created with ia_aiq_clone.
+ *
+ * \param[in,out] shared  Mandatory. Shared context the instance was created from.
+ * \param[in]     ia_aiq  Mandatory. AIQ instance handle.
+ */
+static inline void
+ia_aiq_clone_deinit(ia_aiq_shared *shared,
+                    ia_aiq *ia_aiq)
+{
+    if (shared == NULL || ia_aiq == NULL)
+        return;
+    ia_aiq_deinit(ia_aiq);
+    if (shared->num_instances > 0)
+        shared->num_instances--;
+}
+
+/*!
+ * \brief Deletes shared initialization context.
+ * All instances created from the context must be deleted first, because they refer to the shared CMC.
+ *
+ * \param[in] shared  Mandatory. Shared initialization context.
+ * \return            Error code. ia_err_general, if there are living instances. Context is not deleted in that case.
+ */
+static inline ia_err
+ia_aiq_shared_deinit(ia_aiq_shared *shared)
+{
+    if (shared == NULL)
+        return ia_err_argument;
+    if (shared->num_instances > 0)
+        return ia_err_general;
+    if (shared->owns_cmc)
+        ia_cmc_parser_deinit(shared->ia_cmc);
+    IA_FREEZ(shared);
+    return ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_AIQ_CLONE_H_ */
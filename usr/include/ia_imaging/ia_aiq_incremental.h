@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_incremental.h
+ * \brief Opt-in incremental mode for AWB and GBCE.
+ *
+ * On static scenes consecutive frames have nearly identical statistics and AWB and GBCE produce the same results.
+ * ia_aiq_incremental keeps a compact fingerprint of the RGBS grid and histogram of the statistics set to AIQ.
+ * ia_aiq_awb_run_incremental and ia_aiq_gbce_run_incremental compare the fingerprint against the one used in the
+ * previous run of the algorithm and return the previous results (flagged as reused) when the change stays under
+ * the tuned threshold. Results are owned by AIQ and stay valid until the algorithm is run again, so reusing them is safe.
+ *
+ * Algorithm is always run when
+ * - input parameters of the algorithm changed,
+ * - AWB has not converged (distance_from_convergence > 0),
+ * - the algorithm has been skipped max_consecutive_reuse times in a row.
+ */
+
+#ifndef _IA_AIQ_INCREMENTAL_H_
+#define _IA_AIQ_INCREMENTAL_H_
+
+#include "ia_aiq.h"
+#include "ia_abstraction.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IA_AIQ_FINGERPRINT_GRID_WIDTH   8   /*!< Width of the down sampled RGBS grid in the fingerprint. */
+#define IA_AIQ_FINGERPRINT_GRID_HEIGHT  6   /*!< Height of the down sampled RGBS grid in the fingerprint. */
+#define IA_AIQ_FINGERPRINT_HIST_BINS    16  /*!< Number of bins of the coarse histogram in the fingerprint. */
+#define IA_AIQ_FINGERPRINT_NUM_ELEMENTS \
+    (IA_AIQ_FINGERPRINT_GRID_WIDTH * IA_AIQ_FINGERPRINT_GRID_HEIGHT * 3 + IA_AIQ_FINGERPRINT_HIST_BINS)
+
+/*!
+ * \brief Compact description of frame statistics.
+ * Contains R, G and B averages of down sampled RGBS grid [0, 255] and coarse luminance histogram scaled to [0, 255] range.
+ */
+typedef struct
+{
+    float elements[IA_AIQ_FINGERPRINT_NUM_ELEMENTS];
+    bool valid;
+} ia_aiq_fingerprint;
+
+/*!
+ * \brief Tuning of the incremental mode.
+ */
+typedef struct
+{
+    float threshold;                    /*!< Maximum mean absolute difference of fingerprint elements [0, 255] for reusing results. 0 disables reuse. */
+    unsigned int max_consecutive_reuse; /*!< Algorithm is run at latest after this many reused frames. 0 means no limit. */
+} ia_aiq_incremental_config;
+
+/*!
+ * \brief Per algorithm state of the incremental mode.
+ */
+typedef struct
+{
+    ia_aiq_fingerprint reference;       /*!< Fingerprint of statistics used in the last run. */
+    unsigned int consecutive_reuse;     /*!< Number of frames the results have been reused. */
+    bool has_results;                   /*!< Results below are valid. */
+} ia_aiq_incremental_state;
+
+/*!
+ * \brief Incremental mode handle. Zero initialize before first use.
+ */
+typedef struct
+{
+    ia_aiq_incremental_config config;   /*!< Mandatory. Tuning of the incremental mode. */
+    ia_aiq_fingerprint current;         /*!< Fingerprint of the latest statistics. */
+    ia_aiq_incremental_state awb;       /*!< AWB state. */
+    ia_aiq_awb_input_params awb_input_params;
+    ia_aiq_awb_manual_cct_range awb_manual_cct_range;       /*!< Copy of the manual CCT range of awb_input_params. */
+    ia_coordinate awb_manual_white_coordinate;              /*!< Copy of the manual white coordinate of awb_input_params. */
+    ia_aiq_awb_results *awb_results;
+    ia_aiq_incremental_state gbce;      /*!< GBCE state. */
+    ia_aiq_gbce_input_params gbce_input_params;
+    ia_aiq_gbce_results *gbce_results;
+} ia_aiq_incremental;
+
+/*!
+ * \brief Calculates fingerprint from statistics.
+ * First RGBS grid and first external histogram are used. If no external histogram is given, histogram part
+ * is calculated from the RGBS grid luminance.
+ *
+ * \param[in]  statistics_input_params  Mandatory. Statistics given to AIQ.
+ * \param[out] fingerprint              Mandatory. Calculated fingerprint. Not valid, if statistics don't contain RGBS grid.
+ */
+static inline void
+ia_aiq_fingerprint_calculate(const ia_aiq_statistics_input_params_v1 *statistics_input_params,
+                             ia_aiq_fingerprint *fingerprint)
+{
+    const ia_aiq_rgbs_grid *grid;
+    float *rgb = fingerprint->elements;
+    float *hist = fingerprint->elements + IA_AIQ_FINGERPRINT_GRID_WIDTH * IA_AIQ_FINGERPRINT_GRID_HEIGHT * 3;
+    unsigned int counts[IA_AIQ_FINGERPRINT_GRID_WIDTH * IA_AIQ_FINGERPRINT_GRID_HEIGHT];
+    unsigned int x, y, i;
+
+    IA_MEMSET(fingerprint, 0, sizeof(*fingerprint));
+    IA_MEMSET(counts, 0, sizeof(counts));
+
+    if (statistics_input_params == NULL || statistics_input_params->rgbs_grids == NULL ||
+        statistics_input_params->num_rgbs_grids == 0)
+        return;
+    grid = statistics_input_params->rgbs_grids[0];
+    if (grid == NULL || grid->blocks_ptr == NULL || grid->grid_width == 0 || grid->grid_height == 0)
+        return;
+
+    for (y = 0; y < grid->grid_height; y++) {
+        unsigned int fy = y * IA_AIQ_FINGERPRINT_GRID_HEIGHT / grid->grid_height;
+        for (x = 0; x < grid->grid_width; x++) {
+            const rgbs_grid_block *block = &grid->blocks_ptr[y * grid->grid_width + x];
+            unsigned int f = fy * IA_AIQ_FINGERPRINT_GRID_WIDTH + x * IA_AIQ_FINGERPRINT_GRID_WIDTH / grid->grid_width;
+            rgb[f * 3 + 0] += block->avg_r;
+            rgb[f * 3 + 1] += (block->avg_gr + block->avg_gb) * 0.5f;
+            rgb[f * 3 + 2] += block->avg_b;
+            counts[f]++;
+            if (statistics_input_params->num_external_histograms == 0) {
+                unsigned int luma = (block->avg_r + block->avg_gr + block->avg_gb + block->avg_b) / 4;
+                hist[luma * IA_AIQ_FINGERPRINT_HIST_BINS / 256] += 1.0f;
+            }
+        }
+    }
+    for (i = 0; i < IA_AIQ_FINGERPRINT_GRID_WIDTH * IA_AIQ_FINGERPRINT_GRID_HEIGHT; i++) {
+        if (counts[i] > 0) {
+            rgb[i * 3 + 0] /= counts[i];
+            rgb[i * 3 + 1] /= counts[i];
+            rgb[i * 3 + 2] /= counts[i];
+        }
+    }
+
+    if (statistics_input_params->num_external_histograms > 0 && statistics_input_params->external_histograms != NULL &&
+        statistics_input_params->external_histograms[0] != NULL) {
+        const ia_aiq_histogram *histogram = statistics_input_params->external_histograms[0];
+        const unsigned int *bins = histogram->y != NULL ? histogram->y : histogram->rgb;
+        unsigned int num_bins = histogram->y != NULL ? histogram->num_y_elements : histogram->num_rgb_elements;
+        if (bins != NULL) {
+            for (i = 0; i < num_bins; i++)
+                hist[(unsigned long long)i * IA_AIQ_FINGERPRINT_HIST_BINS / num_bins] += (float)bins[i];
+        }
+    }
+
+    {
+        float total = 0.0f;
+        for (i = 0; i < IA_AIQ_FINGERPRINT_HIST_BINS; i++)
+            total += hist[i];
+        if (total > 0.0f) {
+            for (i = 0; i < IA_AIQ_FINGERPRINT_HIST_BINS; i++)
+                hist[i] = hist[i] * 255.0f / total;
+        }
+    }
+    fingerprint->valid = true;
+}
+
+/*!
+ * \brief Difference of two fingerprints.
+ * \return Mean absolute difference of fingerprint elements. Negative, if either of fingerprints is not valid.
+ */
+static inline float
+ia_aiq_fingerprint_distance(const ia_aiq_fingerprint *a,
+                            const ia_aiq_fingerprint *b)
+{
+    float sum = 0.0f;
+    unsigned int i;
+
+    if (!a->valid || !b->valid)
+        return -1.0f;
+    for (i = 0; i < IA_AIQ_FINGERPRINT_NUM_ELEMENTS; i++)
+        sum += IA_FABS(a->elements[i] - b->elements[i]);
+    return sum / IA_AIQ_FINGERPRINT_NUM_ELEMENTS;
+}
+
+/*!
+ * \brief Sets statistics to AIQ and updates the fingerprint of the incremental mode.
+ * Use instead of ia_aiq_statistics_set_v1 when incremental mode is used.
+ *
+ * \param[in,out] incremental               Mandatory. Incremental mode handle.
+ * \param[in]     ia_aiq                    Mandatory. AIQ instance handle.
+ * \param[in]     statistics_input_params   Mandatory. Input parameters containing statistics and information about a frame.
+ * \return                                  Error code.
+ */
+static inline ia_err
+ia_aiq_statistics_set_incremental(ia_aiq_incremental *incremental,
+                                  ia_aiq *ia_aiq,
+                                  const ia_aiq_statistics_input_params_v1 *statistics_input_params)
+{
+    if (incremental == NULL)
+        return ia_err_argument;
+    ia_aiq_fingerprint_calculate(statistics_input_params, &incremental->current);
+    return ia_aiq_statistics_set_v1(ia_aiq, statistics_input_params);
+}
+
+static inline bool
+ia_aiq_awb_input_params_equal(const ia_aiq_awb_input_params *a,
+                              const ia_aiq_awb_input_params *b)
+{
+    return a->frame_use == b->frame_use &&
+           a->scene_mode == b->scene_mode &&
+           (a->manual_cct_range == NULL) == (b->manual_cct_range == NULL) &&
+           (a->manual_cct_range == NULL ||
+            (a->manual_cct_range->min_cct == b->manual_cct_range->min_cct &&
+             a->manual_cct_range->max_cct == b->manual_cct_range->max_cct)) &&
+           (a->manual_white_coordinate == NULL) == (b->manual_white_coordinate == NULL) &&
+           (a->manual_white_coordinate == NULL ||
+            (a->manual_white_coordinate->x == b->manual_white_coordinate->x &&
+             a->manual_white_coordinate->y == b->manual_white_coordinate->y)) &&
+           a->manual_convergence_time == b->manual_convergence_time;
+}
+
+static inline bool
+ia_aiq_gbce_input_params_equal(const ia_aiq_gbce_input_params *a,
+                               const ia_aiq_gbce_input_params *b)
+{
+    return a->gbce_level == b->gbce_level &&
+           a->tone_map_level == b->tone_map_level &&
+           a->frame_use == b->frame_use &&
+           a->ev_shift == b->ev_shift;
+}
+
+static inline bool
+ia_aiq_incremental_can_reuse(const ia_aiq_incremental *incremental,
+                             const ia_aiq_incremental_state *state)
+{
+    float distance;
+
+    if (!state->has_results || incremental->config.threshold <= 0.0f)
+        return false;
+    if (incremental->config.max_consecutive_reuse > 0 &&
+        state->consecutive_reuse >= incremental->config.max_consecutive_reuse)
+        return false;
+    distance = ia_aiq_fingerprint_distance(&incremental->current, &state->reference);
+    return distance >= 0.0f && distance <= incremental->config.threshold;
+}
+
+/*!
+ * \brief AWB with change detection.
+ * Same as ia_aiq_awb_run, but returns the previous results if statistics haven't changed enough.
+ *
+ * \param[in,out] incremental       Mandatory. Incremental mode handle.
+ * \param[in]     ia_aiq            Mandatory. AIQ instance handle.
+ * \param[in]     awb_input_params  Mandatory. Input parameters for AWB calculations.
+ * \param[out]    awb_results       Mandatory. Pointer's pointer where address of AWB results are stored.
+ * \param[out]    reused            Optional. Set to true, if previous results were returned.
+ * \return                          Error code.
+ */
+static inline ia_err
+ia_aiq_awb_run_incremental(ia_aiq_incremental *incremental,
+                           ia_aiq *ia_aiq,
+                           const ia_aiq_awb_input_params *awb_input_params,
+                           ia_aiq_awb_results **awb_results,
+                           bool *reused)
+{
+    ia_err err;
+
+    if (incremental == NULL || awb_input_params == NULL || awb_results == NULL)
+        return ia_err_argument;
+
+    if (ia_aiq_incremental_can_reuse(incremental, &incremental->awb) &&
+        incremental->awb_results != NULL &&
+        incremental->awb_results->distance_from_convergence <= 0.0f &&
+        ia_aiq_awb_input_params_equal(&incremental->awb_input_params, awb_input_params)) {
+        incremental->awb.consecutive_reuse++;
+        *awb_results = incremental->awb_results;
+        if (reused != NULL)
+            *reused = true;
+        return ia_err_none;
+    }
+
+    err = ia_aiq_awb_run(ia_aiq, awb_input_params, awb_results);
+    incremental->awb.has_results = (err == ia_err_none && *awb_results != NULL);
+    incremental->awb.reference = incremental->current;
+    incremental->awb.consecutive_reuse = 0;
+    /* Manual CCT range and white coordinate are copied, because the client may update them in place. */
+    incremental->awb_input_params = *awb_input_params;
+    if (awb_input_params->manual_cct_range != NULL) {
+        incremental->awb_manual_cct_range = *awb_input_params->manual_cct_range;
+        incremental->awb_input_params.manual_cct_range = &incremental->awb_manual_cct_range;
+    }
+    if (awb_input_params->manual_white_coordinate != NULL) {
+        incremental->awb_manual_white_coordinate = *awb_input_params->manual_white_coordinate;
+        incremental->awb_input_params.manual_white_coordinate = &incremental->awb_manual_white_coordinate;
+    }
+    incremental->awb_results = incremental->awb.has_results ? *awb_results : NULL;
+    if (reused != NULL)
+        *reused = false;
+    return err;
+}
+
+/*!
+ * \brief GBCE with change detection.
+ * Same as ia_aiq_gbce_run, but returns the previous results if statistics haven't changed enough.
+ *
+ * \param[in,out] incremental        Mandatory. Incremental mode handle.
+ * \param[in]     ia_aiq             Mandatory. AIQ instance handle.
+ * \param[in]     gbce_input_params  Mandatory. Input parameters for GBCE calculations.
+ * \param[out]    gbce_results       Mandatory. Pointer's pointer where address of GBCE results are stored.
+ * \param[out]    reused             Optional. Set to true, if previous results were returned.
+ * \return                           Error code.
+ */
+static inline ia_err
+ia_aiq_gbce_run_incremental(ia_aiq_incremental *incremental,
+                            ia_aiq *ia_aiq,
+                            const ia_aiq_gbce_input_params *gbce_input_params,
+                            ia_aiq_gbce_results **gbce_results,
+                            bool *reused)
+{
+    ia_err err;
+
+    if (incremental == NULL || gbce_input_params == NULL || gbce_results == NULL)
+        return ia_err_argument;
+
+    if (ia_aiq_incremental_can_reuse(incremental, &incremental->gbce) &&
+        incremental->gbce_results != NULL &&
+        ia_aiq_gbce_input_params_equal(&incremental->gbce_input_params, gbce_input_params)) {
+        incremental->gbce.consecutive_reuse++;
+        *gbce_results = incremental->gbce_results;
+        if (reused != NULL)
+            *reused = true;
+        return ia_err_none;
+    }
+
+    err = ia_aiq_gbce_run(ia_aiq, gbce_input_params, gbce_results);
+    incremental->gbce.has_results = (err == ia_err_none && *gbce_results != NULL);
+    incremental->gbce.reference = incremental->current;
+    incremental->gbce.consecutive_reuse = 0;
+    incremental->gbce_input_params = *gbce_input_params;
+    incremental->gbce_results = incremental->gbce.has_results ? *gbce_results : NULL;
+    if (reused != NULL)
+        *reused = false;
+    return err;
+}
+
+/*!
+ * \brief Forces AWB and GBCE to be run on the next call, e.g. after tuning change.
+ * \param[in,out] incremental  Mandatory. Incremental mode handle.
+ */
+static inline void
+ia_aiq_incremental_invalidate(ia_aiq_incremental *incremental)
+{
+    if (incremental == NULL)
+        return;
+    incremental->awb.has_results = false;
+    incremental->gbce.has_results = false;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_AIQ_INCREMENTAL_H_ */
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_parallel.h
+ * \brief Running AE, AWB and AF of one camera concurrently.
+ *
+ * Concurrency contract:
+ * - A single ia_aiq instance is not thread-safe. No two AIQ functions may be called concurrently with the same handle.
+ * - Different ia_aiq instances are independent and can be used concurrently from different threads.
+ * - AE, AWB and AF depend on each other only through the statistics and the frame parameters given in
+ *   ia_aiq_statistics_input_params_v1 (frame_ae_parameters, awb_results etc.).
+ *
+ * ia_aiq_parallel therefore keeps one AIQ instance (lane) per algorithm, created from the same ia_aiq_shared context.
+ * Each frame statistics set + algorithm run of the lanes are executed in parallel. Every lane reads the caller's
+ * statistics input parameters directly: ia_aiq_statistics_set_v1 only reads them, and ia_aiq_parallel_run returns only
+ * after all lanes have finished, so the caller's buffers are not copied.
+ * GBCE, DSD, SA and PA are run on the AE lane (ia_aiq_parallel_primary) after ia_aiq_parallel_run has returned.
+ *
+ * Each lane is a full AIQ instance, so memory use of the instances is three times that of a single instance (CMC and
+ * AIQB are shared through ia_aiq_shared).
+ *
+ * Run-time history is kept by the lane which runs the algorithm. AIQD and makernote are per instance and opaque, so they
+ * can't be merged: AIQD of the AE lane has no AWB and AF history and the makernote of a lane contains records of its own
+ * algorithms only. Store AIQD of every lane (ia_aiq_parallel_get_aiqd_data) and give them back to ia_aiq_parallel_init,
+ * and give a separate ia_mkn to every lane whose makernote records are needed.
+ *
+ * AE and AWB results are the same as when running the algorithms one after another on a single instance, provided that
+ * frame_ae_parameters and awb_results of the statistics are given. The same is not guaranteed for AF: AF keeps its
+ * search state across frames and in the AF lane it sees only the statistics, not the AE and AWB runs of a single
+ * instance. AF parity has been checked only with a tuning which has no AF search (lens never moves in auto mode).
+ */
+
+#ifndef _IA_AIQ_PARALLEL_H_
+#define _IA_AIQ_PARALLEL_H_
+
+#include "ia_aiq.h"
+#include "ia_aiq_clone.h"
+#include "ia_task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Lanes of parallel execution.
+ */
+typedef enum
+{
+    ia_aiq_parallel_lane_ae,    /*!< AE. Also GBCE, DSD, SA and PA are run on this lane. */
+    ia_aiq_parallel_lane_awb,   /*!< AWB. */
+    ia_aiq_parallel_lane_af,    /*!< AF. */
+    ia_aiq_parallel_num_lanes
+} ia_aiq_parallel_lane;
+
+/*!
+ * \brief Parallel AIQ of one camera.
+ */
+typedef struct
+{
+    ia_aiq_shared *shared;                          /*!< Shared initialization context the lanes were created from. */
+    ia_aiq *lanes[ia_aiq_parallel_num_lanes];       /*!< AIQ instance per lane. */
+} ia_aiq_parallel;
+
+/*!
+ * \brief Creates AIQ instances for each lane.
+ *
+ * \param[in,out] shared     Mandatory. Shared initialization context. Must outlive the returned handle.
+ * \param[in]     aiqd_data  Optional. AIQD per lane (see ia_aiq_parallel_get_aiqd_data). If NULL or if an entry is NULL,
+ *                           AIQD of the shared context (if any) is used.
+ * \param[in,out] ia_mkn     Optional. Makernote handle per lane. Entries can be NULL. Handles can't be shared between lanes.
+ * \return                   Handle or NULL in case of an error.
+ */
+static inline ia_aiq_parallel *
+ia_aiq_parallel_init(ia_aiq_shared *shared,
+                     const ia_binary_data *const aiqd_data[ia_aiq_parallel_num_lanes],
+                     ia_mkn *const ia_mkn[ia_aiq_parallel_num_lanes])
+{
+    ia_aiq_parallel *parallel;
+    ia_binary_data shared_aiqd;
+    unsigned int i;
+
+    if (shared == NULL)
+        return NULL;
+    parallel = (ia_aiq_parallel *)IA_CALLOC(sizeof(ia_aiq_parallel));
+    if (parallel == NULL)
+        return NULL;
+    parallel->shared = shared;
+    shared_aiqd = shared->aiqd_data;
+    for (i = 0; i < ia_aiq_parallel_num_lanes; i++) {
+        /* Lane AIQD is given to ia_aiq_clone through the shared context. */
+        if (aiqd_data != NULL && aiqd_data[i] != NULL)
+            shared->aiqd_data = *aiqd_data[i];
+        parallel->lanes[i] = ia_aiq_clone(shared, NULL, ia_mkn != NULL ? ia_mkn[i] : NULL);
+        shared->aiqd_data = shared_aiqd;
+        if (parallel->lanes[i] == NULL) {
+            while (i-- > 0)
+                ia_aiq_clone_deinit(shared, parallel->lanes[i]);
+            IA_FREEZ(parallel);
+            return NULL;
+        }
+    }
+    return parallel;
+}
+
+/*!
+ * \brief Deletes lane instances and the handle.
+ */
+static inline void
+ia_aiq_parallel_deinit(ia_aiq_parallel *parallel)
+{
+    unsigned int i;
+
+    if (parallel == NULL)
+        return;
+    for (i = 0; i < ia_aiq_parallel_num_lanes; i++)
+        ia_aiq_clone_deinit(parallel->shared, parallel->lanes[i]);
+    IA_FREEZ(parallel);
+}
+
+/*!
+ * \brief Returns the AE lane instance for running GBCE, DSD, SA and PA.
+ * AIQD of this instance contains no AWB and AF history, see ia_aiq_parallel_get_aiqd_data.
+ */
+static inline ia_aiq *
+ia_aiq_parallel_primary(const ia_aiq_parallel *parallel)
+{
+    return parallel != NULL ? parallel->lanes[ia_aiq_parallel_lane_ae] : NULL;
+}
+
+/*!
+ * \brief Gets AIQD of one lane. AIQD contains the history of the algorithms run on the lane.
+ *
+ * \param[in]  parallel   Mandatory. Parallel AIQ handle.
+ * \param[in]  lane       Mandatory. Lane.
+ * \param[out] aiqd_data  Mandatory. AIQD owned by the lane instance. Copy it before the next run.
+ * \return                Error code.
+ */
+static inline ia_err
+ia_aiq_parallel_get_aiqd_data(ia_aiq_parallel *parallel,
+                              ia_aiq_parallel_lane lane,
+                              ia_binary_data *aiqd_data)
+{
+    if (parallel == NULL || aiqd_data == NULL || (unsigned int)lane >= ia_aiq_parallel_num_lanes)
+        return ia_err_argument;
+    return ia_aiq_get_aiqd_data(parallel->lanes[lane], aiqd_data);
+}
+
+/*!
+ * \brief Work of one parallel run.
+ */
+typedef struct
+{
+    ia_aiq_parallel *parallel;
+    const ia_aiq_statistics_input_params_v1 *statistics_input_params;
+    const ia_aiq_ae_input_params *ae_input_params;
+    const ia_aiq_awb_input_params *awb_input_params;
+    const ia_aiq_af_input_params *af_input_params;
+    ia_aiq_ae_results *ae_results;
+    ia_aiq_awb_results *awb_results;
+    ia_aiq_af_results *af_results;
+    ia_err err[ia_aiq_parallel_num_lanes];
+} ia_aiq_parallel_work;
+
+static inline void
+ia_aiq_parallel_run_lane(void *arg, unsigned int index)
+{
+    ia_aiq_parallel_work *work = (ia_aiq_parallel_work *)arg;
+    ia_aiq *ia_aiq = work->parallel->lanes[index];
+    ia_err err;
+
+    err = ia_aiq_statistics_set_v1(ia_aiq, work->statistics_input_params);
+    if (err != ia_err_none) {
+        work->err[index] = err;
+        return;
+    }
+
+    switch (index) {
+    case ia_aiq_parallel_lane_ae:
+        if (work->ae_input_params != NULL)
+            err = ia_aiq_ae_run(ia_aiq, work->ae_input_params, &work->ae_results);
+        break;
+    case ia_aiq_parallel_lane_awb:
+        if (work->awb_input_params != NULL)
+            err = ia_aiq_awb_run(ia_aiq, work->awb_input_params, &work->awb_results);
+        break;
+    case ia_aiq_parallel_lane_af:
+        if (work->af_input_params != NULL)
+            err = ia_aiq_af_run(ia_aiq, work->af_input_params, &work->af_results);
+        break;
+    default:
+        break;
+    }
+    work->err[index] = err;
+}
+
+/*!
+ * \brief Sets statistics and runs AE, AWB and AF in parallel.
+ * Statistics are not copied. The caller's statistics buffers must stay valid until the call returns.
+ * Results are owned by the lane instances and are valid until the next call.
+ *
+ * \param[in,out] parallel                 Mandatory. Parallel AIQ handle.
+ * \param[in]     env                      Optional. Worker pool. If NULL, default executor of ia_task_run is used.
+ * \param[in]     statistics_input_params  Mandatory. Statistics and information about the frame.
+ * \param[in]     ae_input_params          Optional. AE is not run, if NULL.
+ * \param[in]     awb_input_params         Optional. AWB is not run, if NULL.
+ * \param[in]     af_input_params          Optional. AF is not run, if NULL.
+ * \param[out]    ae_results               Optional. AE results.
+ * \param[out]    awb_results              Optional. AWB results.
+ * \param[out]    af_results               Optional. AF results.
+ * \return                                 Error code of the first failed lane in lane order.
+ */
+static inline ia_err
+ia_aiq_parallel_run(ia_aiq_parallel *parallel,
+                    const ia_task_env *env,
+                    const ia_aiq_statistics_input_params_v1 *statistics_input_params,
+                    const ia_aiq_ae_input_params *ae_input_params,
+                    const ia_aiq_awb_input_params *awb_input_params,
+                    const ia_aiq_af_input_params *af_input_params,
+                    ia_aiq_ae_results **ae_results,
+                    ia_aiq_awb_results **awb_results,
+                    ia_aiq_af_results **af_results)
+{
+    ia_aiq_parallel_work work;
+    unsigned int i;
+
+    if (parallel == NULL || statistics_input_params == NULL)
+        return ia_err_argument;
+
+    memset(&work, 0, sizeof(work));
+    work.parallel = parallel;
+    work.statistics_input_params = statistics_input_params;
+    work.ae_input_params = ae_input_params;
+    work.awb_input_params = awb_input_params;
+    work.af_input_params = af_input_params;
+    ia_task_run(env, ia_aiq_parallel_run_lane, &work, ia_aiq_parallel_num_lanes);
+
+    if (ae_results != NULL)
+        *ae_results = work.ae_results;
+    if (awb_results != NULL)
+        *awb_results = work.awb_results;
+    if (af_results != NULL)
+        *af_results = work.af_results;
+    for (i = 0; i < ia_aiq_parallel_num_lanes; i++)
+        if (work.err[i] != ia_err_none)
+            return work.err[i];
+    return ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_AIQ_PARALLEL_H_ */
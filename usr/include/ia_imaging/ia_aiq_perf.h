@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_perf.h
+ * \brief Per-algorithm performance counters of AIQ.
+ *
+ * Accumulates call count, total, minimum, maximum and latest execution time and number of failed calls per algorithm.
+ * Take ia_aiq_perf_now before an AIQ call and give it with the returned error code to ia_aiq_perf_account. Counters are
+ * collected per ia_aiq_perf structure, typically one per AIQ instance, and can be read with ia_aiq_get_perf_stats and
+ * cleared with ia_aiq_perf_reset. Counting adds two monotonic clock reads per call.
+ *
+ * Only whole AIQ calls can be measured. libia_aiq is binary and has no stage hooks: the only timing it reports are the
+ * "PERF: Enter/Exit" log lines around its public functions, so time spent in the stages of an algorithm is not available.
+ *
+ * Scratch memory is not counted per call, because the AIQ run functions don't allocate (apart from ia_log of libia_log
+ * when logging is enabled): all memory of an instance is allocated from the C library heap in ia_aiq_init. Measure it
+ * with ia_mem_footprint_begin and ia_mem_footprint_end (ia_mem_arena.h) around ia_aiq_init.
+ */
+
+#ifndef _IA_AIQ_PERF_H_
+#define _IA_AIQ_PERF_H_
+
+#include "ia_aiq.h"
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(WIN32) && !defined(__BUILD_FOR_GSD_AOH__)
+#define IA_AIQ_PERF_HAS_CLOCK
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Measured AIQ functions.
+ */
+typedef enum
+{
+    ia_aiq_perf_statistics_set,
+    ia_aiq_perf_ae,
+    ia_aiq_perf_af,
+    ia_aiq_perf_awb,
+    ia_aiq_perf_gbce,
+    ia_aiq_perf_dsd,
+    ia_aiq_perf_sa,
+    ia_aiq_perf_pa,
+    ia_aiq_perf_num_algos
+} ia_aiq_perf_algo;
+
+/*!
+ * \brief Counters of one algorithm. Times are in nanoseconds.
+ */
+typedef struct
+{
+    unsigned long long num_calls;   /*!< Number of calls since last reset. */
+    unsigned long long num_errors;  /*!< Number of calls which returned error. */
+    unsigned long long total_ns;    /*!< Sum of execution times. */
+    unsigned long long min_ns;      /*!< Shortest execution time. 0, if not called. */
+    unsigned long long max_ns;      /*!< Longest execution time. */
+    unsigned long long last_ns;     /*!< Execution time of the latest call. */
+} ia_aiq_perf_counter;
+
+/*!
+ * \brief Performance counters of all algorithms.
+ */
+typedef struct
+{
+    ia_aiq_perf_counter algos[ia_aiq_perf_num_algos];   /*!< Counters indexed with ia_aiq_perf_algo. */
+} ia_aiq_perf_stats;
+
+/*!
+ * \brief Performance counter state. Initialize with ia_aiq_perf_reset.
+ * Not thread-safe, use one per AIQ instance as the instance itself.
+ */
+typedef struct
+{
+    ia_aiq_perf_stats stats;
+} ia_aiq_perf;
+
+/*!
+ * \brief Current time of the monotonic clock in nanoseconds. 0 on platforms without the clock.
+ */
+static inline unsigned long long
+ia_aiq_perf_now(void)
+{
+#ifdef IA_AIQ_PERF_HAS_CLOCK
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/*!
+ * \brief Accounts one AIQ call which started at start.
+ *
+ * \param[in,out] perf   Optional. Performance counter state. Nothing is counted, if NULL.
+ * \param[in]     algo   Mandatory. Algorithm which was called.
+ * \param[in]     start  Mandatory. ia_aiq_perf_now before the call.
+ * \param[in]     err    Mandatory. Error code returned by the call.
+ * \return               err.
+ */
+static inline ia_err
+ia_aiq_perf_account(ia_aiq_perf *perf,
+                    ia_aiq_perf_algo algo,
+                    unsigned long long start,
+                    ia_err err)
+{
+    const unsigned long long elapsed = ia_aiq_perf_now() - start;
+    ia_aiq_perf_counter *counter;
+
+    if (perf == NULL)
+        return err;
+    counter = &perf->stats.algos[algo];
+    if (counter->num_calls == 0 || elapsed < counter->min_ns)
+        counter->min_ns = elapsed;
+    if (elapsed > counter->max_ns)
+        counter->max_ns = elapsed;
+    counter->num_calls++;
+    counter->total_ns += elapsed;
+    counter->last_ns = elapsed;
+    if (err != ia_err_none)
+        counter->num_errors++;
+    return err;
+}
+
+/*!
+ * \brief Clears all counters.
+ *
+ * \param[out] perf  Mandatory. Performance counter state.
+ */
+static inline void
+ia_aiq_perf_reset(ia_aiq_perf *perf)
+{
+    if (perf != NULL)
+        memset(&perf->stats, 0, sizeof(perf->stats));
+}
+
+/*!
+ * \brief Gets counters collected since the last reset.
+ *
+ * \param[in]  perf   Mandatory. Performance counter state.
+ * \param[out] stats  Mandatory. Copy of the counters.
+ * \return            Error code.
+ */
+static inline ia_err
+ia_aiq_get_perf_stats(const ia_aiq_perf *perf,
+                      ia_aiq_perf_stats *stats)
+{
+    if (perf == NULL || stats == NULL)
+        return ia_err_argument;
+    *stats = perf->stats;
+    return ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_AIQ_PERF_H_ */
@@ -0,0 +1,1400 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_record.h
+ * \brief Recording of AIQ inputs and outputs into a file and replaying them without a sensor.
+ *
+ * ia_aiq_recorder_XXX functions run the corresponding AIQ function and append its input parameters and results into a
+ * recording file. ia_aiq_replay maps the file into memory and ia_aiq_replay_run drives an AIQ instance with the recorded
+ * inputs as fast as possible, reporting timing of each algorithm and the results which differ from the recorded ones.
+ *
+ * File consists of ia_aiq_record_file_header followed by records. Each record starts with ia_aiq_record_header and contains
+ * input parameters and results with everything they point to. Pointers are stored as offsets from the start of the record
+ * and listed in a relocation table at the end of the record, so records are used in place after mapping the file.
+ * Structures are stored in the memory layout of the recording host; the file can be replayed on hosts with the same ABI.
+ *
+ * Replay tool: usr/share/doc/ia_imaging/examples/ia_aiq_replay.c. In short:
+ * \code
+ * ia_aiq_replay replay;
+ * ia_aiq_replay_report report;
+ * ia_cmc_t *cmc;
+ * ia_aiq *aiq;
+ *
+ * ia_aiq_replay_open(&replay, "frames.aiqr");
+ * cmc = ia_cmc_parser_init_v1(&aiqb, NULL);   // aiqb loaded from e.g. etc/camera/ipu4p/imx185.aiqb
+ * aiq = ia_aiq_init(&aiqb, NULL, NULL, replay.header->stats_max_width, replay.header->stats_max_height,
+ *                   replay.header->max_num_stats_in, cmc, NULL);
+ * ia_aiq_replay_run(&replay, aiq, &report);
+ * printf("%u frames, %u mismatches, %llu ns\n", report.num_frames, report.num_mismatches, report.total_ns);
+ * \endcode
+ */
+
+#ifndef _IA_AIQ_RECORD_H_
+#define _IA_AIQ_RECORD_H_
+
+#include "ia_aiq.h"
+#include "ia_aiq_perf.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(WIN32) && !defined(__BUILD_FOR_GSD_AOH__)
+#define IA_AIQ_RECORD_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IA_AIQ_RECORD_MAGIC   0x52514941u  /*!< "AIQR" */
+#define IA_AIQ_RECORD_VERSION 1u
+
+/*!
+ * \brief Type of a record.
+ */
+typedef enum
+{
+    ia_aiq_record_type_statistics = 0,  /*!< ia_aiq_statistics_set_v1. Input: ia_aiq_statistics_input_params_v1. No results. */
+    ia_aiq_record_type_ae,              /*!< ia_aiq_ae_run. Input: ia_aiq_ae_input_params. Results: ia_aiq_ae_results. */
+    ia_aiq_record_type_af,              /*!< ia_aiq_af_run. Input: ia_aiq_af_input_params. Results: ia_aiq_af_results. */
+    ia_aiq_record_type_awb,             /*!< ia_aiq_awb_run. Input: ia_aiq_awb_input_params. Results: ia_aiq_awb_results. */
+    ia_aiq_record_type_gbce,            /*!< ia_aiq_gbce_run. Input: ia_aiq_gbce_input_params. Results: ia_aiq_gbce_results. */
+    ia_aiq_record_type_sa,              /*!< ia_aiq_sa_run. Input: ia_aiq_sa_input_params. Results: ia_aiq_sa_results. */
+    ia_aiq_record_type_pa,              /*!< ia_aiq_pa_run_v1. Input: ia_aiq_pa_input_params. Results: ia_aiq_pa_results_v1. */
+    ia_aiq_record_type_num
+} ia_aiq_record_type;
+
+/*!
+ * \brief Header of the recording file.
+ */
+typedef struct
+{
+    uint32_t magic;             /*!< IA_AIQ_RECORD_MAGIC. */
+    uint32_t version;           /*!< IA_AIQ_RECORD_VERSION. */
+    uint32_t pointer_size;      /*!< Size of a pointer on the recording host. */
+    uint32_t stats_max_width;   /*!< stats_max_width the recorded AIQ instance was initialized with. */
+    uint32_t stats_max_height;  /*!< stats_max_height the recorded AIQ instance was initialized with. */
+    uint32_t max_num_stats_in;  /*!< max_num_stats_in the recorded AIQ instance was initialized with. */
+} ia_aiq_record_file_header;
+
+/*!
+ * \brief Header of a record. All offsets are in bytes from the start of the record header.
+ */
+typedef struct
+{
+    uint32_t type;              /*!< ia_aiq_record_type. */
+    uint32_t size;              /*!< Size of the record including the header. Multiple of 8. */
+    uint64_t frame_id;          /*!< Frame id of the latest statistics when the record was made. */
+    int32_t err;                /*!< Error code returned by the recorded function. */
+    uint32_t input_offset;      /*!< Offset of the input parameters. */
+    uint32_t result_offset;     /*!< Offset of the results. 0, if there are no results. */
+    uint32_t reloc_offset;      /*!< Offset of the relocation table. Results (if any) end at this offset. */
+    uint32_t num_relocs;        /*!< Number of uint32_t offsets of pointers in the relocation table. */
+    uint32_t relocated;         /*!< Non-zero, when pointers of the record have been converted to addresses in memory. */
+} ia_aiq_record_header;
+
+/*!
+ * \brief Growing buffer in which one record is composed.
+ */
+typedef struct
+{
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+    uint32_t *relocs;
+    unsigned int num_relocs;
+    unsigned int max_relocs;
+    ia_err err;                 /*!< First error in composing the record. Functions do nothing after an error. */
+} ia_aiq_record_buffer;
+
+#define IA_AIQ_RECORD_SLOT(offset, type, field) ((offset) + offsetof(type, field))
+
+static inline void
+ia_aiq_record_buffer_reset(ia_aiq_record_buffer *buffer)
+{
+    buffer->size = 0;
+    buffer->num_relocs = 0;
+    buffer->err = ia_err_none;
+}
+
+static inline void
+ia_aiq_record_buffer_free(ia_aiq_record_buffer *buffer)
+{
+    free(buffer->data);
+    free(buffer->relocs);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+/*!
+ * \brief Appends data into the buffer aligned to 8 bytes.
+ * \return Offset of the data or 0 in case of an error. Data is zero filled, if src is NULL.
+ */
+static inline size_t
+ia_aiq_record_put(ia_aiq_record_buffer *buffer, const void *src, size_t size)
+{
+    const size_t aligned = (size + 7) & ~(size_t)7;
+    const size_t offset = buffer->size;
+
+    if (buffer->err != ia_err_none)
+        return 0;
+    if (aligned > buffer->capacity - buffer->size) {
+        size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+        unsigned char *data;
+        while (capacity - buffer->size < aligned)
+            capacity *= 2;
+        data = (unsigned char *)realloc(buffer->data, capacity);
+        if (data == NULL) {
+            buffer->err = ia_err_nomemory;
+            return 0;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    if (src != NULL)
+        memcpy(buffer->data + offset, src, size);
+    else
+        memset(buffer->data + offset, 0, size);
+    memset(buffer->data + offset + size, 0, aligned - size);
+    buffer->size += aligned;
+    return offset;
+}
+
+/*!
+ * \brief Stores offset of target into pointer at offset slot. Target 0 stores NULL. Slot 0 is ignored.
+ */
+static inline void
+ia_aiq_record_link(ia_aiq_record_buffer *buffer, size_t slot, size_t target)
+{
+    const uintptr_t value = (uintptr_t)target;
+
+    if (buffer->err != ia_err_none || slot == 0)
+        return;
+    memcpy(buffer->data + slot, &value, sizeof(value));
+    if (target == 0)
+        return;
+    if (buffer->num_relocs == buffer->max_relocs) {
+        const unsigned int max_relocs = buffer->max_relocs > 0 ? buffer->max_relocs * 2 : 64;
+        uint32_t *relocs = (uint32_t *)realloc(buffer->relocs, max_relocs * sizeof(uint32_t));
+        if (relocs == NULL) {
+            buffer->err = ia_err_nomemory;
+            return;
+        }
+        buffer->relocs = relocs;
+        buffer->max_relocs = max_relocs;
+    }
+    buffer->relocs[buffer->num_relocs++] = (uint32_t)slot;
+}
+
+/*!
+ * \brief Appends array pointed by a pointer at offset slot and links the pointer to it.
+ * \return Offset of the array or 0, if src is NULL or size is 0.
+ */
+static inline size_t
+ia_aiq_record_array(ia_aiq_record_buffer *buffer, size_t slot, const void *src, size_t size)
+{
+    const size_t offset = (src != NULL && size > 0) ? ia_aiq_record_put(buffer, src, size) : 0;
+    ia_aiq_record_link(buffer, slot, offset);
+    return offset;
+}
+
+/*!
+ * \brief Appends array of pointers, which are linked by the caller.
+ */
+static inline size_t
+ia_aiq_record_pointer_array(ia_aiq_record_buffer *buffer, size_t slot, const void *src, unsigned int count)
+{
+    const size_t offset = (src != NULL && count > 0) ? ia_aiq_record_put(buffer, NULL, count * sizeof(void *)) : 0;
+    ia_aiq_record_link(buffer, slot, offset);
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_rgbs_grid(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_rgbs_grid *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0)
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_rgbs_grid, blocks_ptr), src->blocks_ptr,
+                            (size_t)src->grid_width * src->grid_height * sizeof(rgbs_grid_block));
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_hdr_rgbs_grid(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_hdr_rgbs_grid *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0)
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_hdr_rgbs_grid, blocks_ptr), src->blocks_ptr,
+                            (size_t)src->grid_width * src->grid_height * sizeof(hdr_rgbs_grid_block));
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_af_grid(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_af_grid *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        const size_t size = (size_t)src->grid_width * src->grid_height * sizeof(int);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_af_grid, filter_response_1), src->filter_response_1, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_af_grid, filter_response_2), src->filter_response_2, size);
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_histogram(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_histogram *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        const size_t size = src->num_bins * sizeof(unsigned int);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_histogram, r), src->r, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_histogram, g), src->g, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_histogram, b), src->b, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_histogram, rgb), src->rgb, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_histogram, rgb_ch), src->rgb_ch, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_histogram, y), src->y, size);
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_depth_grid(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_depth_grid *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        const size_t count = (size_t)src->grid_width * src->grid_height;
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_depth_grid, grid_rect), src->grid_rect, sizeof(ia_rectangle));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_depth_grid, depth_data), src->depth_data, count * sizeof(int));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_depth_grid, confidence), src->confidence, count);
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_grid(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_grid *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0)
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_grid, data), src->data,
+                            (size_t)src->width * src->height * sizeof(unsigned short));
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_face_state(ia_aiq_record_buffer *b, size_t slot, const ia_face_state *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0)
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_face_state, faces), src->faces,
+                            src->num_faces > 0 ? (size_t)src->num_faces * sizeof(ia_face) : 0);
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_ae_results(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_ae_results *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    size_t exposures, weight_grid;
+    unsigned int i;
+
+    if (offset == 0)
+        return 0;
+
+    exposures = ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_results, exposures), src->exposures,
+                                    src->num_exposures * sizeof(ia_aiq_ae_exposure_result));
+    for (i = 0; exposures != 0 && i < src->num_exposures; i++) {
+        const ia_aiq_ae_exposure_result *exposure = &src->exposures[i];
+        const size_t exposure_offset = exposures + i * sizeof(ia_aiq_ae_exposure_result);
+        const unsigned int num_plan = exposure->num_exposure_plan > 0 ? exposure->num_exposure_plan : 1;
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(exposure_offset, ia_aiq_ae_exposure_result, exposure),
+                            exposure->exposure, num_plan * sizeof(ia_aiq_exposure_parameters));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(exposure_offset, ia_aiq_ae_exposure_result, sensor_exposure),
+                            exposure->sensor_exposure, num_plan * sizeof(ia_aiq_exposure_sensor_parameters));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(exposure_offset, ia_aiq_ae_exposure_result, exposure_plan_ids),
+                            exposure->exposure_plan_ids, exposure->num_exposure_plan * sizeof(unsigned int));
+    }
+
+    weight_grid = ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_results, weight_grid), src->weight_grid,
+                                      sizeof(ia_aiq_hist_weight_grid));
+    if (weight_grid != 0)
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(weight_grid, ia_aiq_hist_weight_grid, weights), src->weight_grid->weights,
+                            (size_t)src->weight_grid->width * src->weight_grid->height);
+    ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_results, flashes), src->flashes,
+                        src->num_flashes * sizeof(ia_aiq_flash_parameters));
+    ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_results, aperture_control), src->aperture_control,
+                        sizeof(ia_aiq_aperture_control));
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_gbce_results(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_gbce_results *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        const size_t size = src->gamma_lut_size * sizeof(float);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_gbce_results, r_gamma_lut), src->r_gamma_lut, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_gbce_results, b_gamma_lut), src->b_gamma_lut, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_gbce_results, g_gamma_lut), src->g_gamma_lut, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_gbce_results, tone_map_lut), src->tone_map_lut,
+                            src->tone_map_lut_size * sizeof(float));
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_sa_results(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_sa_results *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    unsigned int i, j;
+
+    for (i = 0; offset != 0 && i < 4; i++)
+        for (j = 0; j < 4; j++)
+            ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_sa_results, lsc_grid) + (i * 4 + j) * sizeof(unsigned short *),
+                                src->lsc_grid[i][j], (size_t)src->width * src->height * sizeof(unsigned short));
+    return offset;
+}
+
+/* Color channel LUT embedded in a structure at offset lut. */
+static inline void
+ia_aiq_record_write_color_channels_lut(ia_aiq_record_buffer *b, size_t lut, const ia_aiq_color_channels_lut *src)
+{
+    const size_t size = src->size * sizeof(float);
+    ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(lut, ia_aiq_color_channels_lut, gr), src->gr, size);
+    ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(lut, ia_aiq_color_channels_lut, r), src->r, size);
+    ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(lut, ia_aiq_color_channels_lut, b), src->b, size);
+    ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(lut, ia_aiq_color_channels_lut, gb), src->gb, size);
+}
+
+static inline size_t
+ia_aiq_record_write_advanced_ccm(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_advanced_ccm_t *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_advanced_ccm_t, hue_of_sectors), src->hue_of_sectors,
+                            src->sector_count * sizeof(unsigned int));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_advanced_ccm_t, advanced_color_conversion_matrices),
+                            src->advanced_color_conversion_matrices, src->sector_count * sizeof(float[3][3]));
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_ir_weight(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_ir_weight_t *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        const size_t size = (size_t)src->width * src->height * sizeof(unsigned short);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ir_weight_t, ir_weight_grid_R), src->ir_weight_grid_R, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ir_weight_t, ir_weight_grid_G), src->ir_weight_grid_G, size);
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ir_weight_t, ir_weight_grid_B), src->ir_weight_grid_B, size);
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_rgbir(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_rgbir_t *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0)
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_rgbir_t, models), src->models,
+                            src->n_models * sizeof(ia_aiq_rgbir_model_t));
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_pa_results(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_pa_results *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        ia_aiq_record_write_color_channels_lut(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_results, linearization), &src->linearization);
+        ia_aiq_record_write_advanced_ccm(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_results, preferred_acm), src->preferred_acm);
+        ia_aiq_record_write_ir_weight(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_results, ir_weight), src->ir_weight);
+        ia_aiq_record_write_rgbir(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_results, rgbir), src->rgbir);
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_pa_results_v1(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_pa_results_v1 *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        ia_aiq_record_write_color_channels_lut(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_results_v1, linearization), &src->linearization);
+        ia_aiq_record_write_advanced_ccm(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_results_v1, preferred_acm), src->preferred_acm);
+        ia_aiq_record_write_ir_weight(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_results_v1, ir_weight), src->ir_weight);
+        ia_aiq_record_write_rgbir(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_results_v1, rgbir), src->rgbir);
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_statistics(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_statistics_input_params_v1 *src)
+{
+    typedef ia_aiq_statistics_input_params_v1 params_t;
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    size_t array;
+    unsigned int i;
+
+    if (offset == 0)
+        return 0;
+
+    ia_aiq_record_write_ae_results(b, IA_AIQ_RECORD_SLOT(offset, params_t, frame_ae_parameters), src->frame_ae_parameters);
+    ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, params_t, frame_af_parameters), src->frame_af_parameters,
+                        sizeof(ia_aiq_af_results));
+
+    array = ia_aiq_record_pointer_array(b, IA_AIQ_RECORD_SLOT(offset, params_t, rgbs_grids), src->rgbs_grids, src->num_rgbs_grids);
+    for (i = 0; array != 0 && i < src->num_rgbs_grids; i++)
+        ia_aiq_record_write_rgbs_grid(b, array + i * sizeof(void *), src->rgbs_grids[i]);
+
+    ia_aiq_record_write_hdr_rgbs_grid(b, IA_AIQ_RECORD_SLOT(offset, params_t, hdr_rgbs_grid), src->hdr_rgbs_grid);
+
+    array = ia_aiq_record_pointer_array(b, IA_AIQ_RECORD_SLOT(offset, params_t, af_grids), src->af_grids, src->num_af_grids);
+    for (i = 0; array != 0 && i < src->num_af_grids; i++)
+        ia_aiq_record_write_af_grid(b, array + i * sizeof(void *), src->af_grids[i]);
+
+    array = ia_aiq_record_pointer_array(b, IA_AIQ_RECORD_SLOT(offset, params_t, external_histograms), src->external_histograms,
+                                        src->num_external_histograms);
+    for (i = 0; array != 0 && i < src->num_external_histograms; i++)
+        ia_aiq_record_write_histogram(b, array + i * sizeof(void *), src->external_histograms[i]);
+
+    ia_aiq_record_write_pa_results(b, IA_AIQ_RECORD_SLOT(offset, params_t, frame_pa_parameters), src->frame_pa_parameters);
+    ia_aiq_record_write_face_state(b, IA_AIQ_RECORD_SLOT(offset, params_t, faces), src->faces);
+    ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, params_t, awb_results), src->awb_results, sizeof(ia_aiq_awb_results));
+    ia_aiq_record_write_sa_results(b, IA_AIQ_RECORD_SLOT(offset, params_t, frame_sa_parameters), src->frame_sa_parameters);
+
+    array = ia_aiq_record_pointer_array(b, IA_AIQ_RECORD_SLOT(offset, params_t, depth_grids), src->depth_grids, src->num_depth_grids);
+    for (i = 0; array != 0 && i < src->num_depth_grids; i++)
+        ia_aiq_record_write_depth_grid(b, array + i * sizeof(void *), src->depth_grids[i]);
+
+    ia_aiq_record_write_grid(b, IA_AIQ_RECORD_SLOT(offset, params_t, ir_grid), src->ir_grid);
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_ae_input(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_ae_input_params *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_input_params, sensor_descriptor), src->sensor_descriptor,
+                            src->num_sensor_descriptors * sizeof(ia_aiq_exposure_sensor_descriptor));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_input_params, exposure_window), src->exposure_window,
+                            sizeof(ia_rectangle));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_input_params, exposure_coordinate), src->exposure_coordinate,
+                            sizeof(ia_coordinate));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_input_params, manual_exposure_time_us),
+                            src->manual_exposure_time_us, src->num_exposures * sizeof(long));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_input_params, manual_analog_gain), src->manual_analog_gain,
+                            src->num_exposures * sizeof(float));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_input_params, manual_iso), src->manual_iso,
+                            src->num_exposures * sizeof(short));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_input_params, aec_features), src->aec_features,
+                            sizeof(ia_aiq_ae_features));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_ae_input_params, manual_limits), src->manual_limits,
+                            sizeof(ia_aiq_ae_manual_limits));
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_af_input(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_af_input_params *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_af_input_params, focus_rect), src->focus_rect,
+                            sizeof(ia_rectangle));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_af_input_params, manual_focus_parameters),
+                            src->manual_focus_parameters, sizeof(ia_aiq_manual_focus_parameters));
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_awb_input(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_awb_input_params *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_awb_input_params, manual_cct_range), src->manual_cct_range,
+                            sizeof(ia_aiq_awb_manual_cct_range));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_awb_input_params, manual_white_coordinate),
+                            src->manual_white_coordinate, sizeof(ia_coordinate));
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_sa_input(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_sa_input_params *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_sa_input_params, sensor_frame_params), src->sensor_frame_params,
+                            sizeof(ia_aiq_frame_params));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_sa_input_params, awb_results), src->awb_results,
+                            sizeof(ia_aiq_awb_results));
+    }
+    return offset;
+}
+
+static inline size_t
+ia_aiq_record_write_pa_input(ia_aiq_record_buffer *b, size_t slot, const ia_aiq_pa_input_params *src)
+{
+    const size_t offset = ia_aiq_record_array(b, slot, src, sizeof(*src));
+    if (offset != 0) {
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_input_params, awb_results), src->awb_results,
+                            sizeof(ia_aiq_awb_results));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_input_params, exposure_params), src->exposure_params,
+                            sizeof(ia_aiq_exposure_parameters));
+        ia_aiq_record_array(b, IA_AIQ_RECORD_SLOT(offset, ia_aiq_pa_input_params, color_gains), src->color_gains,
+                            sizeof(ia_aiq_color_channels));
+    }
+    return offset;
+}
+
+/*!
+ * \brief Writes results of the given record type.
+ * \return Offset of the results or 0, if results is NULL.
+ */
+static inline size_t
+ia_aiq_record_write_results(ia_aiq_record_buffer *b, ia_aiq_record_type type, const void *results)
+{
+    switch (type) {
+    case ia_aiq_record_type_ae:
+        return ia_aiq_record_write_ae_results(b, 0, (const ia_aiq_ae_results *)results);
+    case ia_aiq_record_type_af:
+        return ia_aiq_record_array(b, 0, results, sizeof(ia_aiq_af_results));
+    case ia_aiq_record_type_awb:
+        return ia_aiq_record_array(b, 0, results, sizeof(ia_aiq_awb_results));
+    case ia_aiq_record_type_gbce:
+        return ia_aiq_record_write_gbce_results(b, 0, (const ia_aiq_gbce_results *)results);
+    case ia_aiq_record_type_sa:
+        return ia_aiq_record_write_sa_results(b, 0, (const ia_aiq_sa_results *)results);
+    case ia_aiq_record_type_pa:
+        return ia_aiq_record_write_pa_results_v1(b, 0, (const ia_aiq_pa_results_v1 *)results);
+    default:
+        return 0;
+    }
+}
+
+/*!
+ * \brief Recorder state.
+ */
+typedef struct
+{
+    FILE *file;
+    ia_aiq_record_buffer buffer;
+    unsigned long long frame_id;    /*!< Frame id of the latest recorded statistics. */
+    ia_err err;                     /*!< First error in recording. */
+} ia_aiq_recorder;
+
+/*!
+ * \brief Opens a recording file.
+ *
+ * \param[out] recorder          Mandatory. Recorder state.
+ * \param[in]  path              Mandatory. File to create.
+ * \param[in]  stats_max_width   Mandatory. stats_max_width given to ia_aiq_init of the recorded instance.
+ * \param[in]  stats_max_height  Mandatory. stats_max_height given to ia_aiq_init of the recorded instance.
+ * \param[in]  max_num_stats_in  Mandatory. max_num_stats_in given to ia_aiq_init of the recorded instance.
+ * \return                       Error code.
+ */
+static inline ia_err
+ia_aiq_recorder_open(ia_aiq_recorder *recorder,
+                     const char *path,
+                     unsigned int stats_max_width,
+                     unsigned int stats_max_height,
+                     unsigned int max_num_stats_in)
+{
+    ia_aiq_record_file_header header;
+
+    if (recorder == NULL || path == NULL)
+        return ia_err_argument;
+    memset(recorder, 0, sizeof(*recorder));
+    recorder->file = fopen(path, "wb");
+    if (recorder->file == NULL)
+        return ia_err_general;
+
+    header.magic = IA_AIQ_RECORD_MAGIC;
+    header.version = IA_AIQ_RECORD_VERSION;
+    header.pointer_size = (uint32_t)sizeof(void *);
+    header.stats_max_width = stats_max_width;
+    header.stats_max_height = stats_max_height;
+    header.max_num_stats_in = max_num_stats_in;
+    if (fwrite(&header, sizeof(header), 1, recorder->file) != 1)
+        recorder->err = ia_err_general;
+    return recorder->err;
+}
+
+/*!
+ * \brief Closes the recording file.
+ * \return Error code. Error, if writing of any record failed.
+ */
+static inline ia_err
+ia_aiq_recorder_close(ia_aiq_recorder *recorder)
+{
+    ia_err err;
+
+    if (recorder == NULL || recorder->file == NULL)
+        return ia_err_argument;
+    if (fclose(recorder->file) != 0 && recorder->err == ia_err_none)
+        recorder->err = ia_err_general;
+    ia_aiq_record_buffer_free(&recorder->buffer);
+    err = recorder->err;
+    memset(recorder, 0, sizeof(*recorder));
+    return err;
+}
+
+static inline size_t
+ia_aiq_recorder_begin(ia_aiq_recorder *recorder)
+{
+    ia_aiq_record_buffer_reset(&recorder->buffer);
+    return ia_aiq_record_put(&recorder->buffer, NULL, sizeof(ia_aiq_record_header));
+}
+
+static inline void
+ia_aiq_recorder_commit(ia_aiq_recorder *recorder,
+                       ia_aiq_record_type type,
+                       ia_err err,
+                       size_t input_offset,
+                       size_t result_offset)
+{
+    ia_aiq_record_buffer *buffer = &recorder->buffer;
+    ia_aiq_record_header header;
+    const size_t reloc_offset = buffer->size;
+
+    if (buffer->num_relocs > 0)
+        ia_aiq_record_put(buffer, buffer->relocs, buffer->num_relocs * sizeof(uint32_t));
+    if (buffer->err != ia_err_none || buffer->size > UINT32_MAX) {
+        if (recorder->err == ia_err_none)
+            recorder->err = buffer->err != ia_err_none ? buffer->err : ia_err_data;
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.type = (uint32_t)type;
+    header.size = (uint32_t)buffer->size;
+    header.frame_id = recorder->frame_id;
+    header.err = (int32_t)err;
+    header.input_offset = (uint32_t)input_offset;
+    header.result_offset = (uint32_t)result_offset;
+    header.reloc_offset = (uint32_t)reloc_offset;
+    header.num_relocs = buffer->num_relocs;
+    memcpy(buffer->data, &header, sizeof(header));
+
+    if (fwrite(buffer->data, buffer->size, 1, recorder->file) != 1 && recorder->err == ia_err_none)
+        recorder->err = ia_err_general;
+}
+
+/*!
+ * \brief ia_aiq_statistics_set_v1 with recording.
+ */
+static inline ia_err
+ia_aiq_recorder_statistics_set_v1(ia_aiq_recorder *recorder,
+                                  ia_aiq *ia_aiq,
+                                  const ia_aiq_statistics_input_params_v1 *statistics_input_params)
+{
+    const ia_err err = ia_aiq_statistics_set_v1(ia_aiq, statistics_input_params);
+
+    if (recorder != NULL && statistics_input_params != NULL) {
+        size_t input;
+        recorder->frame_id = statistics_input_params->frame_id;
+        ia_aiq_recorder_begin(recorder);
+        input = ia_aiq_record_write_statistics(&recorder->buffer, 0, statistics_input_params);
+        ia_aiq_recorder_commit(recorder, ia_aiq_record_type_statistics, err, input, 0);
+    }
+    return err;
+}
+
+/*!
+ * \brief ia_aiq_ae_run with recording.
+ */
+static inline ia_err
+ia_aiq_recorder_ae_run(ia_aiq_recorder *recorder,
+                       ia_aiq *ia_aiq,
+                       const ia_aiq_ae_input_params *ae_input_params,
+                       ia_aiq_ae_results **ae_results)
+{
+    const ia_err err = ia_aiq_ae_run(ia_aiq, ae_input_params, ae_results);
+
+    if (recorder != NULL && ae_input_params != NULL) {
+        size_t input, result;
+        ia_aiq_recorder_begin(recorder);
+        input = ia_aiq_record_write_ae_input(&recorder->buffer, 0, ae_input_params);
+        result = ia_aiq_record_write_results(&recorder->buffer, ia_aiq_record_type_ae,
+                                             (err == ia_err_none && ae_results != NULL) ? *ae_results : NULL);
+        ia_aiq_recorder_commit(recorder, ia_aiq_record_type_ae, err, input, result);
+    }
+    return err;
+}
+
+/*!
+ * \brief ia_aiq_af_run with recording.
+ */
+static inline ia_err
+ia_aiq_recorder_af_run(ia_aiq_recorder *recorder,
+                       ia_aiq *ia_aiq,
+                       const ia_aiq_af_input_params *af_input_params,
+                       ia_aiq_af_results **af_results)
+{
+    const ia_err err = ia_aiq_af_run(ia_aiq, af_input_params, af_results);
+
+    if (recorder != NULL && af_input_params != NULL) {
+        size_t input, result;
+        ia_aiq_recorder_begin(recorder);
+        input = ia_aiq_record_write_af_input(&recorder->buffer, 0, af_input_params);
+        result = ia_aiq_record_write_results(&recorder->buffer, ia_aiq_record_type_af,
+                                             (err == ia_err_none && af_results != NULL) ? *af_results : NULL);
+        ia_aiq_recorder_commit(recorder, ia_aiq_record_type_af, err, input, result);
+    }
+    return err;
+}
+
+/*!
+ * \brief ia_aiq_awb_run with recording.
+ */
+static inline ia_err
+ia_aiq_recorder_awb_run(ia_aiq_recorder *recorder,
+                        ia_aiq *ia_aiq,
+                        const ia_aiq_awb_input_params *awb_input_params,
+                        ia_aiq_awb_results **awb_results)
+{
+    const ia_err err = ia_aiq_awb_run(ia_aiq, awb_input_params, awb_results);
+
+    if (recorder != NULL && awb_input_params != NULL) {
+        size_t input, result;
+        ia_aiq_recorder_begin(recorder);
+        input = ia_aiq_record_write_awb_input(&recorder->buffer, 0, awb_input_params);
+        result = ia_aiq_record_write_results(&recorder->buffer, ia_aiq_record_type_awb,
+                                             (err == ia_err_none && awb_results != NULL) ? *awb_results : NULL);
+        ia_aiq_recorder_commit(recorder, ia_aiq_record_type_awb, err, input, result);
+    }
+    return err;
+}
+
+/*!
+ * \brief ia_aiq_gbce_run with recording.
+ */
+static inline ia_err
+ia_aiq_recorder_gbce_run(ia_aiq_recorder *recorder,
+                         ia_aiq *ia_aiq,
+                         const ia_aiq_gbce_input_params *gbce_input_params,
+                         ia_aiq_gbce_results **gbce_results)
+{
+    const ia_err err = ia_aiq_gbce_run(ia_aiq, gbce_input_params, gbce_results);
+
+    if (recorder != NULL && gbce_input_params != NULL) {
+        size_t input, result;
+        ia_aiq_recorder_begin(recorder);
+        input = ia_aiq_record_array(&recorder->buffer, 0, gbce_input_params, sizeof(*gbce_input_params));
+        result = ia_aiq_record_write_results(&recorder->buffer, ia_aiq_record_type_gbce,
+                                             (err == ia_err_none && gbce_results != NULL) ? *gbce_results : NULL);
+        ia_aiq_recorder_commit(recorder, ia_aiq_record_type_gbce, err, input, result);
+    }
+    return err;
+}
+
+/*!
+ * \brief ia_aiq_sa_run with recording.
+ */
+static inline ia_err
+ia_aiq_recorder_sa_run(ia_aiq_recorder *recorder,
+                       ia_aiq *ia_aiq,
+                       const ia_aiq_sa_input_params *sa_input_params,
+                       ia_aiq_sa_results **sa_results)
+{
+    const ia_err err = ia_aiq_sa_run(ia_aiq, sa_input_params, sa_results);
+
+    if (recorder != NULL && sa_input_params != NULL) {
+        size_t input, result;
+        ia_aiq_recorder_begin(recorder);
+        input = ia_aiq_record_write_sa_input(&recorder->buffer, 0, sa_input_params);
+        result = ia_aiq_record_write_results(&recorder->buffer, ia_aiq_record_type_sa,
+                                             (err == ia_err_none && sa_results != NULL) ? *sa_results : NULL);
+        ia_aiq_recorder_commit(recorder, ia_aiq_record_type_sa, err, input, result);
+    }
+    return err;
+}
+
+/*!
+ * \brief ia_aiq_pa_run_v1 with recording.
+ */
+static inline ia_err
+ia_aiq_recorder_pa_run_v1(ia_aiq_recorder *recorder,
+                          ia_aiq *ia_aiq,
+                          const ia_aiq_pa_input_params *pa_input_params,
+                          ia_aiq_pa_results_v1 **pa_results)
+{
+    const ia_err err = ia_aiq_pa_run_v1(ia_aiq, pa_input_params, pa_results);
+
+    if (recorder != NULL && pa_input_params != NULL) {
+        size_t input, result;
+        ia_aiq_recorder_begin(recorder);
+        input = ia_aiq_record_write_pa_input(&recorder->buffer, 0, pa_input_params);
+        result = ia_aiq_record_write_results(&recorder->buffer, ia_aiq_record_type_pa,
+                                             (err == ia_err_none && pa_results != NULL) ? *pa_results : NULL);
+        ia_aiq_recorder_commit(recorder, ia_aiq_record_type_pa, err, input, result);
+    }
+    return err;
+}
+
+/*!
+ * \brief Recording opened for replay.
+ */
+typedef struct
+{
+    unsigned char *data;                        /*!< File contents. Writable private mapping, as pointers are relocated in place. */
+    size_t size;                                /*!< File size. */
+    size_t offset;                              /*!< Offset of the next record. */
+    bool mapped;                                /*!< Data is memory mapped. Otherwise it has been read into allocated memory. */
+    bool corrupted;                             /*!< Invalid file header or record was found. */
+    const ia_aiq_record_file_header *header;    /*!< File header. */
+} ia_aiq_replay;
+
+/*!
+ * \brief Opens a recording for replay.
+ * File is mapped copy-on-write into memory, so records are used in place without copying.
+ *
+ * \param[out] replay  Mandatory. Replay state.
+ * \param[in]  path    Mandatory. Recording file.
+ * \return             Error code. ia_err_data, if file is not a recording made on a host with the same pointer size.
+ */
+static inline ia_err
+ia_aiq_replay_open(ia_aiq_replay *replay, const char *path)
+{
+    if (replay == NULL || path == NULL)
+        return ia_err_argument;
+    memset(replay, 0, sizeof(*replay));
+
+#ifdef IA_AIQ_RECORD_HAS_MMAP
+    {
+        struct stat st;
+        void *data;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return ia_err_general;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            return ia_err_general;
+        }
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return ia_err_general;
+        replay->data = (unsigned char *)data;
+        replay->size = (size_t)st.st_size;
+        replay->mapped = true;
+    }
+#else
+    {
+        long size;
+        FILE *file = fopen(path, "rb");
+        if (file == NULL)
+            return ia_err_general;
+        if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+            fclose(file);
+            return ia_err_general;
+        }
+        replay->data = (unsigned char *)malloc((size_t)size);
+        if (replay->data == NULL) {
+            fclose(file);
+            return ia_err_nomemory;
+        }
+        if (fread(replay->data, (size_t)size, 1, file) != 1) {
+            fclose(file);
+            free(replay->data);
+            replay->data = NULL;
+            return ia_err_general;
+        }
+        fclose(file);
+        replay->size = (size_t)size;
+    }
+#endif
+
+    replay->header = (const ia_aiq_record_file_header *)replay->data;
+    if (replay->size < sizeof(ia_aiq_record_file_header) ||
+        replay->header->magic != IA_AIQ_RECORD_MAGIC ||
+        replay->header->version != IA_AIQ_RECORD_VERSION ||
+        replay->header->pointer_size != sizeof(void *)) {
+        replay->corrupted = true;
+        return ia_err_data;
+    }
+    replay->offset = sizeof(ia_aiq_record_file_header);
+    return ia_err_none;
+}
+
+/*!
+ * \brief Closes a recording.
+ */
+static inline void
+ia_aiq_replay_close(ia_aiq_replay *replay)
+{
+    if (replay == NULL || replay->data == NULL)
+        return;
+#ifdef IA_AIQ_RECORD_HAS_MMAP
+    if (replay->mapped)
+        munmap(replay->data, replay->size);
+    else
+#endif
+        free(replay->data);
+    memset(replay, 0, sizeof(*replay));
+}
+
+/*!
+ * \brief Restarts replay from the first record. Records stay relocated.
+ */
+static inline void
+ia_aiq_replay_rewind(ia_aiq_replay *replay)
+{
+    if (replay != NULL && replay->data != NULL && !replay->corrupted)
+        replay->offset = sizeof(ia_aiq_record_file_header);
+}
+
+/*!
+ * \brief Returns the next record with its pointers converted to addresses.
+ * Input parameters are at input_offset and results at result_offset from the returned header.
+ *
+ * \param[in,out] replay  Mandatory. Replay state.
+ * \return                Record or NULL at the end of the recording or if the record is corrupted.
+ */
+static inline ia_aiq_record_header *
+ia_aiq_replay_next(ia_aiq_replay *replay)
+{
+    ia_aiq_record_header *record;
+    unsigned char *base;
+    uint32_t i;
+
+    if (replay == NULL || replay->data == NULL || replay->corrupted || replay->offset == replay->size)
+        return NULL;
+    if (replay->size - replay->offset < sizeof(ia_aiq_record_header)) {
+        replay->corrupted = true;
+        return NULL;
+    }
+
+    base = replay->data + replay->offset;
+    record = (ia_aiq_record_header *)base;
+    if (record->size < sizeof(ia_aiq_record_header) || record->size > replay->size - replay->offset ||
+        (record->size & 7) != 0 || record->type >= ia_aiq_record_type_num ||
+        record->reloc_offset > record->size ||
+        record->num_relocs > (record->size - record->reloc_offset) / sizeof(uint32_t) ||
+        record->input_offset >= record->reloc_offset || record->result_offset >= record->reloc_offset) {
+        replay->corrupted = true;
+        return NULL;
+    }
+
+    if (!record->relocated) {
+        const uint32_t *relocs = (const uint32_t *)(base + record->reloc_offset);
+        for (i = 0; i < record->num_relocs; i++) {
+            uintptr_t value;
+            if (relocs[i] < sizeof(ia_aiq_record_header) || relocs[i] > record->reloc_offset - sizeof(value)) {
+                replay->corrupted = true;
+                return NULL;
+            }
+            memcpy(&value, base + relocs[i], sizeof(value));
+            if (value >= record->reloc_offset) {
+                replay->corrupted = true;
+                return NULL;
+            }
+            value += (uintptr_t)base;
+            memcpy(base + relocs[i], &value, sizeof(value));
+        }
+        record->relocated = 1;
+    }
+
+    replay->offset += record->size;
+    return record;
+}
+
+/*!
+ * \brief Replay summary.
+ */
+typedef struct
+{
+    unsigned int num_frames;                                /*!< Number of replayed statistics records. */
+    unsigned int num_records;                               /*!< Number of replayed records. */
+    unsigned int num_mismatches;                            /*!< Number of records with results or error code different from the recording. */
+    unsigned int mismatches[ia_aiq_record_type_num];        /*!< Mismatches per record type. */
+    unsigned long long first_mismatch_frame_id;             /*!< Frame id of the first mismatch. 0, if none. */
+    unsigned long long total_ns;                            /*!< Total time spent in AIQ functions. */
+    ia_aiq_perf_stats perf;                                 /*!< Timing of each algorithm. */
+} ia_aiq_replay_report;
+
+/*
+ * Results are compared field by field: padding bytes between the fields are indeterminate both in the results and in
+ * the recorded copy, so whole structures can't be compared with memcmp. Fields are compared bytewise, so floats must be
+ * bit-identical. Arrays of 0 bytes are recorded as NULL.
+ */
+#define IA_AIQ_REPLAY_FIELD_EQUAL(a, b, field) (memcmp(&(a)->field, &(b)->field, sizeof((a)->field)) == 0)
+
+static inline bool
+ia_aiq_replay_array_equal(const void *a, const void *b, size_t size)
+{
+    if (size == 0)
+        return true;
+    if (a == NULL || b == NULL)
+        return a == b;
+    return memcmp(a, b, size) == 0;
+}
+
+static inline bool
+ia_aiq_replay_exposure_parameters_equal(const ia_aiq_exposure_parameters *a, const ia_aiq_exposure_parameters *b)
+{
+    return IA_AIQ_REPLAY_FIELD_EQUAL(a, b, exposure_time_us) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, analog_gain) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, digital_gain) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, aperture_fn) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, total_target_exposure) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, nd_filter_enabled) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, iso);
+}
+
+static inline bool
+ia_aiq_replay_sensor_exposure_equal(const ia_aiq_exposure_sensor_parameters *a, const ia_aiq_exposure_sensor_parameters *b)
+{
+    return IA_AIQ_REPLAY_FIELD_EQUAL(a, b, fine_integration_time) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, coarse_integration_time) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, analog_gain_code_global) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, digital_gain_global) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, line_length_pixels) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, frame_length_lines);
+}
+
+static inline bool
+ia_aiq_replay_exposure_result_equal(const ia_aiq_ae_exposure_result *a, const ia_aiq_ae_exposure_result *b)
+{
+    const unsigned int num_plan = a->num_exposure_plan > 0 ? a->num_exposure_plan : 1;
+    unsigned int i;
+
+    if (!IA_AIQ_REPLAY_FIELD_EQUAL(a, b, exposure_index) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, distance_from_convergence) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, converged) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, num_exposure_plan) ||
+        (a->exposure == NULL) != (b->exposure == NULL) ||
+        (a->sensor_exposure == NULL) != (b->sensor_exposure == NULL) ||
+        !ia_aiq_replay_array_equal(a->exposure_plan_ids, b->exposure_plan_ids, a->num_exposure_plan * sizeof(unsigned int)))
+        return false;
+    for (i = 0; i < num_plan; i++) {
+        if (a->exposure != NULL && !ia_aiq_replay_exposure_parameters_equal(&a->exposure[i], &b->exposure[i]))
+            return false;
+        if (a->sensor_exposure != NULL && !ia_aiq_replay_sensor_exposure_equal(&a->sensor_exposure[i], &b->sensor_exposure[i]))
+            return false;
+    }
+    return true;
+}
+
+static inline bool
+ia_aiq_replay_ae_results_equal(const ia_aiq_ae_results *a, const ia_aiq_ae_results *b)
+{
+    unsigned int i;
+
+    if (!IA_AIQ_REPLAY_FIELD_EQUAL(a, b, num_exposures) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, num_flashes) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, lux_level_estimate) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, multiframe) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, flicker_reduction_mode) ||
+        (a->num_exposures > 0 && (a->exposures == NULL) != (b->exposures == NULL)) ||
+        (a->num_flashes > 0 && (a->flashes == NULL) != (b->flashes == NULL)) ||
+        (a->weight_grid == NULL) != (b->weight_grid == NULL) ||
+        (a->aperture_control == NULL) != (b->aperture_control == NULL))
+        return false;
+    for (i = 0; a->exposures != NULL && i < a->num_exposures; i++)
+        if (!ia_aiq_replay_exposure_result_equal(&a->exposures[i], &b->exposures[i]))
+            return false;
+    for (i = 0; a->flashes != NULL && i < a->num_flashes; i++)
+        if (!IA_AIQ_REPLAY_FIELD_EQUAL(&a->flashes[i], &b->flashes[i], status) ||
+            !IA_AIQ_REPLAY_FIELD_EQUAL(&a->flashes[i], &b->flashes[i], power_prc))
+            return false;
+    if (a->weight_grid != NULL &&
+        (!IA_AIQ_REPLAY_FIELD_EQUAL(a->weight_grid, b->weight_grid, width) ||
+         !IA_AIQ_REPLAY_FIELD_EQUAL(a->weight_grid, b->weight_grid, height) ||
+         !ia_aiq_replay_array_equal(a->weight_grid->weights, b->weight_grid->weights,
+                                    (size_t)a->weight_grid->width * a->weight_grid->height)))
+        return false;
+    if (a->aperture_control != NULL &&
+        (!IA_AIQ_REPLAY_FIELD_EQUAL(a->aperture_control, b->aperture_control, aperture_fn) ||
+         !IA_AIQ_REPLAY_FIELD_EQUAL(a->aperture_control, b->aperture_control, dc_iris_command) ||
+         !IA_AIQ_REPLAY_FIELD_EQUAL(a->aperture_control, b->aperture_control, code)))
+        return false;
+    return true;
+}
+
+static inline bool
+ia_aiq_replay_af_results_equal(const ia_aiq_af_results *a, const ia_aiq_af_results *b)
+{
+    return IA_AIQ_REPLAY_FIELD_EQUAL(a, b, status) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, current_focus_distance) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, next_lens_position) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, next_focal_distance) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, lens_driver_action) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, use_af_assist) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, final_lens_position_reached);
+}
+
+static inline bool
+ia_aiq_replay_awb_results_equal(const ia_aiq_awb_results *a, const ia_aiq_awb_results *b)
+{
+    return IA_AIQ_REPLAY_FIELD_EQUAL(a, b, accurate_r_per_g) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, accurate_b_per_g) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, final_r_per_g) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, final_b_per_g) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, cct_estimate) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, distance_from_convergence);
+}
+
+static inline bool
+ia_aiq_replay_gbce_results_equal(const ia_aiq_gbce_results *a, const ia_aiq_gbce_results *b)
+{
+    const size_t size = a->gamma_lut_size * sizeof(float);
+
+    return IA_AIQ_REPLAY_FIELD_EQUAL(a, b, gamma_lut_size) &&
+           IA_AIQ_REPLAY_FIELD_EQUAL(a, b, tone_map_lut_size) &&
+           ia_aiq_replay_array_equal(a->r_gamma_lut, b->r_gamma_lut, size) &&
+           ia_aiq_replay_array_equal(a->b_gamma_lut, b->b_gamma_lut, size) &&
+           ia_aiq_replay_array_equal(a->g_gamma_lut, b->g_gamma_lut, size) &&
+           ia_aiq_replay_array_equal(a->tone_map_lut, b->tone_map_lut, a->tone_map_lut_size * sizeof(float));
+}
+
+static inline bool
+ia_aiq_replay_sa_results_equal(const ia_aiq_sa_results *a, const ia_aiq_sa_results *b)
+{
+    const size_t size = (size_t)a->width * a->height * sizeof(unsigned short);
+    unsigned int i, j;
+
+    if (!IA_AIQ_REPLAY_FIELD_EQUAL(a, b, width) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, height) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, fraction_bits) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, color_order) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, lsc_update) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, light_source) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, confidence) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, frame_params.horizontal_crop_offset) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, frame_params.vertical_crop_offset) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, frame_params.cropped_image_width) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, frame_params.cropped_image_height) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, frame_params.horizontal_scaling_numerator) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, frame_params.horizontal_scaling_denominator) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, frame_params.vertical_scaling_numerator) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, frame_params.vertical_scaling_denominator))
+        return false;
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < 4; j++)
+            if (!ia_aiq_replay_array_equal(a->lsc_grid[i][j], b->lsc_grid[i][j], size))
+                return false;
+    return true;
+}
+
+static inline bool
+ia_aiq_replay_pa_results_equal(const ia_aiq_pa_results_v1 *a, const ia_aiq_pa_results_v1 *b)
+{
+    const size_t lut_size = a->linearization.size * sizeof(float);
+    unsigned int i;
+
+    if (!IA_AIQ_REPLAY_FIELD_EQUAL(a, b, color_conversion_matrix) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, black_level_4x4) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, color_gains.gr) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, color_gains.r) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, color_gains.b) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, color_gains.gb) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, linearization.size) ||
+        !ia_aiq_replay_array_equal(a->linearization.gr, b->linearization.gr, lut_size) ||
+        !ia_aiq_replay_array_equal(a->linearization.r, b->linearization.r, lut_size) ||
+        !ia_aiq_replay_array_equal(a->linearization.b, b->linearization.b, lut_size) ||
+        !ia_aiq_replay_array_equal(a->linearization.gb, b->linearization.gb, lut_size) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, saturation_factor) ||
+        !IA_AIQ_REPLAY_FIELD_EQUAL(a, b, brightness_level) ||
+        (a->preferred_acm == NULL) != (b->preferred_acm == NULL) ||
+        (a->ir_weight == NULL) != (b->ir_weight == NULL) ||
+        (a->rgbir == NULL) != (b->rgbir == NULL))
+        return false;
+
+    if (a->preferred_acm != NULL &&
+        (!IA_AIQ_REPLAY_FIELD_EQUAL(a->preferred_acm, b->preferred_acm, sector_count) ||
+         !IA_AIQ_REPLAY_FIELD_EQUAL(a->preferred_acm, b->preferred_acm, media_format) ||
+         !ia_aiq_replay_array_equal(a->preferred_acm->hue_of_sectors, b->preferred_acm->hue_of_sectors,
+                                    a->preferred_acm->sector_count * sizeof(unsigned int)) ||
+         !ia_aiq_replay_array_equal(a->preferred_acm->advanced_color_conversion_matrices,
+                                    b->preferred_acm->advanced_color_conversion_matrices,
+                                    a->preferred_acm->sector_count * sizeof(float[3][3]))))
+        return false;
+
+    if (a->ir_weight != NULL) {
+        const size_t size = (size_t)a->ir_weight->width * a->ir_weight->height * sizeof(unsigned short);
+        if (!IA_AIQ_REPLAY_FIELD_EQUAL(a->ir_weight, b->ir_weight, width) ||
+            !IA_AIQ_REPLAY_FIELD_EQUAL(a->ir_weight, b->ir_weight, height) ||
+            !ia_aiq_replay_array_equal(a->ir_weight->ir_weight_grid_R, b->ir_weight->ir_weight_grid_R, size) ||
+            !ia_aiq_replay_array_equal(a->ir_weight->ir_weight_grid_G, b->ir_weight->ir_weight_grid_G, size) ||
+            !ia_aiq_replay_array_equal(a->ir_weight->ir_weight_grid_B, b->ir_weight->ir_weight_grid_B, size))
+            return false;
+    }
+
+    if (a->rgbir != NULL) {
+        if (!IA_AIQ_REPLAY_FIELD_EQUAL(a->rgbir, b->rgbir, grid_indices) ||
+            !IA_AIQ_REPLAY_FIELD_EQUAL(a->rgbir, b->rgbir, n_models) ||
+            (a->rgbir->n_models > 0 && (a->rgbir->models == NULL) != (b->rgbir->models == NULL)))
+            return false;
+        for (i = 0; a->rgbir->models != NULL && i < a->rgbir->n_models; i++) {
+            const ia_aiq_rgbir_model_t *model_a = &a->rgbir->models[i], *model_b = &b->rgbir->models[i];
+            if (!IA_AIQ_REPLAY_FIELD_EQUAL(model_a, model_b, width) ||
+                !IA_AIQ_REPLAY_FIELD_EQUAL(model_a, model_b, height) ||
+                !IA_AIQ_REPLAY_FIELD_EQUAL(model_a, model_b, sigma) ||
+                !IA_AIQ_REPLAY_FIELD_EQUAL(model_a, model_b, offset) ||
+                !IA_AIQ_REPLAY_FIELD_EQUAL(model_a, model_b, max) ||
+                !IA_AIQ_REPLAY_FIELD_EQUAL(model_a, model_b, base))
+                return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Compares results with the results of a relocated record, field by field including everything they point to.
+ */
+static inline bool
+ia_aiq_replay_results_equal(const ia_aiq_record_header *record, const void *results)
+{
+    const void *recorded = (const unsigned char *)record + record->result_offset;
+
+    if (record->result_offset == 0 || results == NULL)
+        return record->result_offset == 0 && results == NULL;
+
+    switch (record->type) {
+    case ia_aiq_record_type_ae:
+        return ia_aiq_replay_ae_results_equal((const ia_aiq_ae_results *)recorded, (const ia_aiq_ae_results *)results);
+    case ia_aiq_record_type_af:
+        return ia_aiq_replay_af_results_equal((const ia_aiq_af_results *)recorded, (const ia_aiq_af_results *)results);
+    case ia_aiq_record_type_awb:
+        return ia_aiq_replay_awb_results_equal((const ia_aiq_awb_results *)recorded, (const ia_aiq_awb_results *)results);
+    case ia_aiq_record_type_gbce:
+        return ia_aiq_replay_gbce_results_equal((const ia_aiq_gbce_results *)recorded, (const ia_aiq_gbce_results *)results);
+    case ia_aiq_record_type_sa:
+        return ia_aiq_replay_sa_results_equal((const ia_aiq_sa_results *)recorded, (const ia_aiq_sa_results *)results);
+    case ia_aiq_record_type_pa:
+        return ia_aiq_replay_pa_results_equal((const ia_aiq_pa_results_v1 *)recorded,
+                                              (const ia_aiq_pa_results_v1 *)results);
+    default:
+        return false;
+    }
+}
+
+/*!
+ * \brief Drives AIQ instance with all remaining records of the recording.
+ * Recorded results are not used as inputs; each algorithm gets only the recorded input parameters and statistics.
+ *
+ * \param[in,out] replay  Mandatory. Recording.
+ * \param[in]     ia_aiq  Mandatory. AIQ instance, normally freshly initialized with the tuning used in recording.
+ * \param[out]    report  Mandatory. Summary of the replay.
+ * \return                Error code. ia_err_data, if the recording is corrupted.
+ */
+static inline ia_err
+ia_aiq_replay_run(ia_aiq_replay *replay,
+                  ia_aiq *ia_aiq,
+                  ia_aiq_replay_report *report)
+{
+    ia_aiq_record_header *record;
+    ia_aiq_perf perf;
+    unsigned int i;
+
+    if (replay == NULL || ia_aiq == NULL || report == NULL)
+        return ia_err_argument;
+
+    memset(report, 0, sizeof(*report));
+    ia_aiq_perf_reset(&perf);
+
+    while ((record = ia_aiq_replay_next(replay)) != NULL) {
+        const void *input = (const unsigned char *)record + record->input_offset;
+        const void *results = NULL;
+        ia_aiq_perf_algo algo = ia_aiq_perf_num_algos;
+        const unsigned long long start = ia_aiq_perf_now();
+        ia_err err = ia_err_none;
+
+        switch (record->type) {
+        case ia_aiq_record_type_statistics:
+            algo = ia_aiq_perf_statistics_set;
+            err = ia_aiq_statistics_set_v1(ia_aiq, (const ia_aiq_statistics_input_params_v1 *)input);
+            report->num_frames++;
+            break;
+        case ia_aiq_record_type_ae: {
+            ia_aiq_ae_results *ae_results = NULL;
+            algo = ia_aiq_perf_ae;
+            err = ia_aiq_ae_run(ia_aiq, (const ia_aiq_ae_input_params *)input, &ae_results);
+            results = ae_results;
+            break;
+        }
+        case ia_aiq_record_type_af: {
+            ia_aiq_af_results *af_results = NULL;
+            algo = ia_aiq_perf_af;
+            err = ia_aiq_af_run(ia_aiq, (const ia_aiq_af_input_params *)input, &af_results);
+            results = af_results;
+            break;
+        }
+        case ia_aiq_record_type_awb: {
+            ia_aiq_awb_results *awb_results = NULL;
+            algo = ia_aiq_perf_awb;
+            err = ia_aiq_awb_run(ia_aiq, (const ia_aiq_awb_input_params *)input, &awb_results);
+            results = awb_results;
+            break;
+        }
+        case ia_aiq_record_type_gbce: {
+            ia_aiq_gbce_results *gbce_results = NULL;
+            algo = ia_aiq_perf_gbce;
+            err = ia_aiq_gbce_run(ia_aiq, (const ia_aiq_gbce_input_params *)input, &gbce_results);
+            results = gbce_results;
+            break;
+        }
+        case ia_aiq_record_type_sa: {
+            ia_aiq_sa_results *sa_results = NULL;
+            algo = ia_aiq_perf_sa;
+            err = ia_aiq_sa_run(ia_aiq, (const ia_aiq_sa_input_params *)input, &sa_results);
+            results = sa_results;
+            break;
+        }
+        case ia_aiq_record_type_pa: {
+            ia_aiq_pa_results_v1 *pa_results = NULL;
+            algo = ia_aiq_perf_pa;
+            err = ia_aiq_pa_run_v1(ia_aiq, (const ia_aiq_pa_input_params *)input, &pa_results);
+            results = pa_results;
+            break;
+        }
+        default:
+            break;
+        }
+        if (algo != ia_aiq_perf_num_algos)
+            ia_aiq_perf_account(&perf, algo, start, err);
+
+        report->num_records++;
+        if ((int32_t)err != record->err ||
+            (record->type != ia_aiq_record_type_statistics &&
+             !ia_aiq_replay_results_equal(record, err == ia_err_none ? results : NULL))) {
+            if (report->num_mismatches == 0)
+                report->first_mismatch_frame_id = record->frame_id;
+            report->num_mismatches++;
+            report->mismatches[record->type]++;
+        }
+    }
+
+    ia_aiq_get_perf_stats(&perf, &report->perf);
+    for (i = 0; i < ia_aiq_perf_num_algos; i++)
+        report->total_ns += report->perf.algos[i].total_ns;
+    return replay->corrupted ? ia_err_data : ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_AIQ_RECORD_H_ */
@@ -0,0 +1,427 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_scheduler.h
+ * \brief Tunable run rate of AIQ algorithms.
+ *
+ * Like the tunable run rate of ISP algorithms in AIC (see ia_isp_bxt.h), AIQ algorithms can be run at a lower rate than the
+ * frame rate. Run rate of each algorithm is given in the tuning as an execution interval in microseconds
+ * (see ia_aiq_run_rate_record). Interval 0 means that the algorithm is run for every frame.
+ *
+ * ia_aiq_scheduler compares frame_timestamp of the statistics against the timestamp when the algorithm was last run and
+ * decides which algorithms are executed for the frame. ia_aiq_scheduler_XXX_run functions run the corresponding AIQ
+ * function when it is due and otherwise return the results of the previous run, which remain valid in the AIQ instance
+ * until the algorithm is run again.
+ *
+ * Scheduling assumes that input parameters of an algorithm stay the same between runs. When they change (e.g. frame use
+ * or manual settings), call ia_aiq_scheduler_invalidate so that the algorithm is run for the next frame.
+ */
+
+#ifndef _IA_AIQ_SCHEDULER_H_
+#define _IA_AIQ_SCHEDULER_H_
+
+#include "ia_aiq.h"
+#include "ia_cmc_types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Name ID of the run rate record in AIQB.
+ */
+#define IA_AIQ_RUN_RATE_NAME_ID 1000
+
+/*!
+ * \brief Scheduled algorithms. Values are stored in the tuning and must not change.
+ */
+typedef enum
+{
+    ia_aiq_run_rate_ae = 0,
+    ia_aiq_run_rate_af = 1,
+    ia_aiq_run_rate_awb = 2,
+    ia_aiq_run_rate_gbce = 3,
+    ia_aiq_run_rate_dsd = 4,
+    ia_aiq_run_rate_sa = 5,
+    ia_aiq_run_rate_pa = 6,
+    ia_aiq_run_rate_num_algos
+} ia_aiq_run_rate_algo;
+
+/*!
+ * \brief Run rate of one algorithm in the run rate record.
+ */
+typedef struct
+{
+    uint16_t algo;          /*!< Algorithm, see ia_aiq_run_rate_algo. */
+    uint16_t reserved;
+    uint32_t interval_us;   /*!< Minimum time between two runs in microseconds. 0 means every frame. */
+} ia_aiq_run_rate_entry;
+
+/*!
+ * \brief Run rate record of AIQB. Followed by num_entries of ia_aiq_run_rate_entry.
+ */
+typedef struct
+{
+    ia_mkn_record_header header;    /*!< Record header with Format ID: UInt32 (See AIQB_DataID), Name ID: IA_AIQ_RUN_RATE_NAME_ID. */
+    uint32_t num_entries;           /*!< Number of ia_aiq_run_rate_entry items following the record. */
+} ia_aiq_run_rate_record;
+
+/*!
+ * \brief Run rate configuration.
+ */
+typedef struct
+{
+    unsigned int interval_us[ia_aiq_run_rate_num_algos];   /*!< Run interval per algorithm in microseconds. 0 means every frame. */
+} ia_aiq_run_rate_config;
+
+/*!
+ * \brief Reads run rate configuration from AIQB.
+ * If AIQB contains no run rate record, all algorithms are run for every frame.
+ * Entries of unknown algorithms are ignored.
+ *
+ * \param[in]  aiqb_data  Mandatory. AIQB tuning data.
+ * \param[out] config     Mandatory. Run rate configuration.
+ * \return                Error code. ia_err_data, if AIQB or the run rate record is malformed.
+ */
+static inline ia_err
+ia_aiq_run_rate_config_parse(const ia_binary_data *aiqb_data,
+                             ia_aiq_run_rate_config *config)
+{
+    const unsigned char *data;
+    ia_mkn_header header;
+    size_t offset;
+
+    if (aiqb_data == NULL || aiqb_data->data == NULL || config == NULL)
+        return ia_err_argument;
+
+    memset(config, 0, sizeof(*config));
+    if (aiqb_data->size < sizeof(header))
+        return ia_err_data;
+    data = (const unsigned char *)aiqb_data->data;
+    memcpy(&header, data, sizeof(header));
+    if (header.tag != AIQB_TAG || header.size > aiqb_data->size || header.size < sizeof(header))
+        return ia_err_data;
+
+    for (offset = sizeof(header); offset + sizeof(ia_mkn_record_header) <= header.size; ) {
+        ia_mkn_record_header record;
+        ia_aiq_run_rate_record run_rate;
+        uint32_t i;
+
+        memcpy(&record, data + offset, sizeof(record));
+        if (record.size < sizeof(record) || record.size > header.size - offset)
+            return ia_err_data;
+        if (record.data_name_id == IA_AIQ_RUN_RATE_NAME_ID) {
+            if (record.size < sizeof(run_rate))
+                return ia_err_data;
+            memcpy(&run_rate, data + offset, sizeof(run_rate));
+            if (run_rate.num_entries > (record.size - sizeof(run_rate)) / sizeof(ia_aiq_run_rate_entry))
+                return ia_err_data;
+            for (i = 0; i < run_rate.num_entries; i++) {
+                ia_aiq_run_rate_entry entry;
+                memcpy(&entry, data + offset + sizeof(run_rate) + i * sizeof(entry), sizeof(entry));
+                if (entry.algo < ia_aiq_run_rate_num_algos)
+                    config->interval_us[entry.algo] = entry.interval_us;
+            }
+            return ia_err_none;
+        }
+        offset += record.size;
+    }
+    return ia_err_none;
+}
+
+/*!
+ * \brief Scheduler state of one AIQ instance. Initialize with ia_aiq_scheduler_init.
+ */
+typedef struct
+{
+    ia_aiq_run_rate_config config;
+    unsigned long long frame_timestamp;                         /*!< Timestamp of the current frame in microseconds. */
+    unsigned long long frame_period;                            /*!< Time between the two latest frames in microseconds. */
+    bool has_frame;
+    bool due[ia_aiq_run_rate_num_algos];                        /*!< Algorithm is run for the current frame. */
+    bool valid[ia_aiq_run_rate_num_algos];                      /*!< Algorithm has been run and its results are stored. */
+    unsigned long long last_run[ia_aiq_run_rate_num_algos];     /*!< Frame timestamp of the latest run. */
+    unsigned long long num_runs[ia_aiq_run_rate_num_algos];     /*!< Number of executed runs. */
+    unsigned long long num_skips[ia_aiq_run_rate_num_algos];    /*!< Number of runs replaced with previous results. */
+    void *results[ia_aiq_run_rate_num_algos];                   /*!< Results of the latest run. */
+    ia_aiq_scene_mode dsd_scene;                                /*!< DSD result of the latest run. */
+} ia_aiq_scheduler;
+
+/*!
+ * \brief Initializes scheduler. All algorithms are run for the first frame.
+ *
+ * \param[out] scheduler  Mandatory. Scheduler.
+ * \param[in]  config     Optional. Run rate configuration. If NULL, all algorithms are run for every frame.
+ */
+static inline void
+ia_aiq_scheduler_init(ia_aiq_scheduler *scheduler,
+                      const ia_aiq_run_rate_config *config)
+{
+    if (scheduler == NULL)
+        return;
+    memset(scheduler, 0, sizeof(*scheduler));
+    if (config != NULL)
+        scheduler->config = *config;
+}
+
+/*!
+ * \brief Forces the algorithm to be run for the next frame, e.g. when its input parameters have changed.
+ */
+static inline void
+ia_aiq_scheduler_invalidate(ia_aiq_scheduler *scheduler,
+                            ia_aiq_run_rate_algo algo)
+{
+    if (scheduler != NULL && algo < ia_aiq_run_rate_num_algos)
+        scheduler->valid[algo] = false;
+}
+
+/*!
+ * \brief Starts a new frame and decides which algorithms are run for it.
+ * Algorithm is due when it has not been run yet, or when at least its interval has elapsed since its last run. Half of
+ * the frame period is allowed as tolerance, so that an interval which is a multiple of the frame period is kept despite
+ * timestamp jitter. A timestamp older than the previous one (e.g. after stream restart) makes all algorithms due.
+ *
+ * \param[in,out] scheduler        Mandatory. Scheduler.
+ * \param[in]     frame_timestamp  Mandatory. Start of frame timestamp in microseconds, as in ia_aiq_statistics_input_params_v1.
+ */
+static inline void
+ia_aiq_scheduler_frame(ia_aiq_scheduler *scheduler,
+                       unsigned long long frame_timestamp)
+{
+    unsigned int i;
+
+    if (scheduler == NULL)
+        return;
+
+    if (scheduler->has_frame && frame_timestamp < scheduler->frame_timestamp) {
+        for (i = 0; i < ia_aiq_run_rate_num_algos; i++)
+            scheduler->valid[i] = false;
+        scheduler->frame_period = 0;
+    } else if (scheduler->has_frame && frame_timestamp > scheduler->frame_timestamp) {
+        scheduler->frame_period = frame_timestamp - scheduler->frame_timestamp;
+    }
+    scheduler->frame_timestamp = frame_timestamp;
+    scheduler->has_frame = true;
+
+    for (i = 0; i < ia_aiq_run_rate_num_algos; i++) {
+        const unsigned long long interval = scheduler->config.interval_us[i];
+        scheduler->due[i] = !scheduler->valid[i] || interval == 0 ||
+                            frame_timestamp - scheduler->last_run[i] + scheduler->frame_period / 2 >= interval;
+    }
+}
+
+/*!
+ * \brief Tells whether the algorithm is run for the current frame.
+ */
+static inline bool
+ia_aiq_scheduler_is_due(const ia_aiq_scheduler *scheduler,
+                        ia_aiq_run_rate_algo algo)
+{
+    if (scheduler == NULL || algo >= ia_aiq_run_rate_num_algos)
+        return true;
+    return !scheduler->has_frame || !scheduler->valid[algo] || scheduler->due[algo];
+}
+
+static inline bool
+ia_aiq_scheduler_begin(ia_aiq_scheduler *scheduler,
+                       ia_aiq_run_rate_algo algo)
+{
+    if (ia_aiq_scheduler_is_due(scheduler, algo))
+        return true;
+    scheduler->num_skips[algo]++;
+    return false;
+}
+
+static inline ia_err
+ia_aiq_scheduler_end(ia_aiq_scheduler *scheduler,
+                     ia_aiq_run_rate_algo algo,
+                     void *results,
+                     ia_err err)
+{
+    if (scheduler == NULL)
+        return err;
+    scheduler->valid[algo] = err == ia_err_none;
+    scheduler->results[algo] = results;
+    scheduler->last_run[algo] = scheduler->frame_timestamp;
+    scheduler->num_runs[algo]++;
+    return err;
+}
+
+/*!
+ * \brief ia_aiq_statistics_set_v1 followed by ia_aiq_scheduler_frame with frame_timestamp of the statistics.
+ */
+static inline ia_err
+ia_aiq_scheduler_statistics_set_v1(ia_aiq_scheduler *scheduler,
+                                   ia_aiq *ia_aiq,
+                                   const ia_aiq_statistics_input_params_v1 *statistics_input_params)
+{
+    ia_err err = ia_aiq_statistics_set_v1(ia_aiq, statistics_input_params);
+    if (err == ia_err_none && statistics_input_params != NULL)
+        ia_aiq_scheduler_frame(scheduler, statistics_input_params->frame_timestamp);
+    return err;
+}
+
+/*!
+ * \brief Scheduled ia_aiq_ae_run. If AE is not due, results of the previous run are returned.
+ */
+static inline ia_err
+ia_aiq_scheduler_ae_run(ia_aiq_scheduler *scheduler,
+                        ia_aiq *ia_aiq,
+                        const ia_aiq_ae_input_params *ae_input_params,
+                        ia_aiq_ae_results **ae_results)
+{
+    ia_err err;
+
+    if (!ia_aiq_scheduler_begin(scheduler, ia_aiq_run_rate_ae)) {
+        if (ae_results != NULL)
+            *ae_results = (ia_aiq_ae_results *)scheduler->results[ia_aiq_run_rate_ae];
+        return ia_err_none;
+    }
+    err = ia_aiq_ae_run(ia_aiq, ae_input_params, ae_results);
+    return ia_aiq_scheduler_end(scheduler, ia_aiq_run_rate_ae, ae_results != NULL ? *ae_results : NULL, err);
+}
+
+/*!
+ * \brief Scheduled ia_aiq_af_run. If AF is not due, results of the previous run are returned.
+ */
+static inline ia_err
+ia_aiq_scheduler_af_run(ia_aiq_scheduler *scheduler,
+                        ia_aiq *ia_aiq,
+                        const ia_aiq_af_input_params *af_input_params,
+                        ia_aiq_af_results **af_results)
+{
+    ia_err err;
+
+    if (!ia_aiq_scheduler_begin(scheduler, ia_aiq_run_rate_af)) {
+        if (af_results != NULL)
+            *af_results = (ia_aiq_af_results *)scheduler->results[ia_aiq_run_rate_af];
+        return ia_err_none;
+    }
+    err = ia_aiq_af_run(ia_aiq, af_input_params, af_results);
+    return ia_aiq_scheduler_end(scheduler, ia_aiq_run_rate_af, af_results != NULL ? *af_results : NULL, err);
+}
+
+/*!
+ * \brief Scheduled ia_aiq_awb_run. If AWB is not due, results of the previous run are returned.
+ */
+static inline ia_err
+ia_aiq_scheduler_awb_run(ia_aiq_scheduler *scheduler,
+                         ia_aiq *ia_aiq,
+                         const ia_aiq_awb_input_params *awb_input_params,
+                         ia_aiq_awb_results **awb_results)
+{
+    ia_err err;
+
+    if (!ia_aiq_scheduler_begin(scheduler, ia_aiq_run_rate_awb)) {
+        if (awb_results != NULL)
+            *awb_results = (ia_aiq_awb_results *)scheduler->results[ia_aiq_run_rate_awb];
+        return ia_err_none;
+    }
+    err = ia_aiq_awb_run(ia_aiq, awb_input_params, awb_results);
+    return ia_aiq_scheduler_end(scheduler, ia_aiq_run_rate_awb, awb_results != NULL ? *awb_results : NULL, err);
+}
+
+/*!
+ * \brief Scheduled ia_aiq_gbce_run. If GBCE is not due, results of the previous run are returned.
+ */
+static inline ia_err
+ia_aiq_scheduler_gbce_run(ia_aiq_scheduler *scheduler,
+                          ia_aiq *ia_aiq,
+                          const ia_aiq_gbce_input_params *gbce_input_params,
+                          ia_aiq_gbce_results **gbce_results)
+{
+    ia_err err;
+
+    if (!ia_aiq_scheduler_begin(scheduler, ia_aiq_run_rate_gbce)) {
+        if (gbce_results != NULL)
+            *gbce_results = (ia_aiq_gbce_results *)scheduler->results[ia_aiq_run_rate_gbce];
+        return ia_err_none;
+    }
+    err = ia_aiq_gbce_run(ia_aiq, gbce_input_params, gbce_results);
+    return ia_aiq_scheduler_end(scheduler, ia_aiq_run_rate_gbce, gbce_results != NULL ? *gbce_results : NULL, err);
+}
+
+/*!
+ * \brief Scheduled ia_aiq_dsd_run. If DSD is not due, scene mode of the previous run is returned.
+ */
+static inline ia_err
+ia_aiq_scheduler_dsd_run(ia_aiq_scheduler *scheduler,
+                         ia_aiq *ia_aiq,
+                         const ia_aiq_dsd_input_params *dsd_input_params,
+                         ia_aiq_scene_mode *dsd_scene)
+{
+    ia_err err;
+
+    if (!ia_aiq_scheduler_begin(scheduler, ia_aiq_run_rate_dsd)) {
+        if (dsd_scene != NULL)
+            *dsd_scene = scheduler->dsd_scene;
+        return ia_err_none;
+    }
+    err = ia_aiq_dsd_run(ia_aiq, dsd_input_params, dsd_scene);
+    if (scheduler != NULL && err == ia_err_none && dsd_scene != NULL)
+        scheduler->dsd_scene = *dsd_scene;
+    return ia_aiq_scheduler_end(scheduler, ia_aiq_run_rate_dsd, NULL, err);
+}
+
+/*!
+ * \brief Scheduled ia_aiq_sa_run. If SA is not due, results of the previous run are returned.
+ */
+static inline ia_err
+ia_aiq_scheduler_sa_run(ia_aiq_scheduler *scheduler,
+                        ia_aiq *ia_aiq,
+                        const ia_aiq_sa_input_params *sa_input_params,
+                        ia_aiq_sa_results **sa_results)
+{
+    ia_err err;
+
+    if (!ia_aiq_scheduler_begin(scheduler, ia_aiq_run_rate_sa)) {
+        if (sa_results != NULL)
+            *sa_results = (ia_aiq_sa_results *)scheduler->results[ia_aiq_run_rate_sa];
+        return ia_err_none;
+    }
+    err = ia_aiq_sa_run(ia_aiq, sa_input_params, sa_results);
+    return ia_aiq_scheduler_end(scheduler, ia_aiq_run_rate_sa, sa_results != NULL ? *sa_results : NULL, err);
+}
+
+/*!
+ * \brief Scheduled ia_aiq_pa_run_v1. If PA is not due, results of the previous run are returned.
+ */
+static inline ia_err
+ia_aiq_scheduler_pa_run_v1(ia_aiq_scheduler *scheduler,
+                           ia_aiq *ia_aiq,
+                           const ia_aiq_pa_input_params *pa_input_params,
+                           ia_aiq_pa_results_v1 **pa_results)
+{
+    ia_err err;
+
+    if (!ia_aiq_scheduler_begin(scheduler, ia_aiq_run_rate_pa)) {
+        if (pa_results != NULL)
+            *pa_results = (ia_aiq_pa_results_v1 *)scheduler->results[ia_aiq_run_rate_pa];
+        return ia_err_none;
+    }
+    err = ia_aiq_pa_run_v1(ia_aiq, pa_input_params, pa_results);
+    return ia_aiq_scheduler_end(scheduler, ia_aiq_run_rate_pa, pa_results != NULL ? *pa_results : NULL, err);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_AIQ_SCHEDULER_H_ */
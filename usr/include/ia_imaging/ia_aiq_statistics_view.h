@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_statistics_view.h
+ * \brief Setting RGBS statistics to AIQ directly from ISP statistics layout.
+ *
+ * ISP outputs RGBS statistics as separate int32 planes per color channel (structure of arrays) while AIQ consumes
+ * ia_aiq_rgbs_grid with 8-bit blocks (array of structures). ia_aiq_rgbs_grid_view describes the ISP layout in place,
+ * without copying, and ia_aiq_statistics_set_v1_view packs the views straight into client owned block storage
+ * in a single pass over the valid grid area and sets the statistics. No intermediate copy of the ISP records is made.
+ */
+
+#ifndef _IA_AIQ_STATISTICS_VIEW_H_
+#define _IA_AIQ_STATISTICS_VIEW_H_
+
+#include "ia_aiq.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Strided structure of arrays view of RGBS statistics.
+ * Channel planes are addressed as plane[y * row_stride + x]. Saturation is stored in four interleaved planes so that
+ * block with linear index i = y * grid_width + x uses sat[i % 4][i / 4] (ISP statistics layout).
+ * Values are clamped to [0, 255] when packed into rgbs_grid_block.
+ */
+typedef struct
+{
+    const int32_t *avg_gr;          /*!< Mandatory. Average Gr plane (C0 in ISP statistics). */
+    const int32_t *avg_r;           /*!< Mandatory. Average R plane (C1 in ISP statistics). */
+    const int32_t *avg_b;           /*!< Mandatory. Average B plane (C2 in ISP statistics). */
+    const int32_t *avg_gb;          /*!< Mandatory. Average Gb plane (C3 in ISP statistics). */
+    const int32_t *sat[4];          /*!< Mandatory. Interleaved saturation ratio planes. */
+    unsigned int row_stride;        /*!< Mandatory. Distance between grid rows in elements. Must be >= grid_width. */
+    unsigned short grid_width;      /*!< Mandatory. Grid width. */
+    unsigned short grid_height;     /*!< Mandatory. Grid height. */
+    bool shading_correction;        /*!< Flag indicating if statistics was calculated using lens shading corrected data. */
+} ia_aiq_rgbs_grid_view;
+
+static inline unsigned char
+ia_aiq_rgbs_view_clamp(int32_t value)
+{
+    return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+/*!
+ * \brief Packs RGBS grid view into AIQ RGBS grid.
+ * Result is identical to the RGBS grid produced by ia_isp_bxt statistics conversion from the same data.
+ *
+ * \param[in]  view       Mandatory. RGBS grid view.
+ * \param[in]  blocks     Mandatory. Client owned storage of at least grid_width * grid_height blocks.
+ * \param[out] rgbs_grid  Mandatory. RGBS grid pointing to the given blocks.
+ * \return                Error code.
+ */
+static inline ia_err
+ia_aiq_rgbs_grid_view_pack(const ia_aiq_rgbs_grid_view *view,
+                           rgbs_grid_block *blocks,
+                           ia_aiq_rgbs_grid *rgbs_grid)
+{
+    unsigned int x, y, i = 0;
+
+    if (view == NULL || blocks == NULL || rgbs_grid == NULL ||
+        view->avg_gr == NULL || view->avg_r == NULL || view->avg_b == NULL || view->avg_gb == NULL ||
+        view->sat[0] == NULL || view->sat[1] == NULL || view->sat[2] == NULL || view->sat[3] == NULL ||
+        view->row_stride < view->grid_width)
+        return ia_err_argument;
+
+    for (y = 0; y < view->grid_height; y++) {
+        const unsigned int row = y * view->row_stride;
+        for (x = 0; x < view->grid_width; x++, i++) {
+            rgbs_grid_block *block = &blocks[i];
+            block->avg_gr = ia_aiq_rgbs_view_clamp(view->avg_gr[row + x]);
+            block->avg_r = ia_aiq_rgbs_view_clamp(view->avg_r[row + x]);
+            block->avg_b = ia_aiq_rgbs_view_clamp(view->avg_b[row + x]);
+            block->avg_gb = ia_aiq_rgbs_view_clamp(view->avg_gb[row + x]);
+            block->sat = ia_aiq_rgbs_view_clamp(view->sat[i & 3][i >> 2]);
+        }
+    }
+
+    rgbs_grid->blocks_ptr = blocks;
+    rgbs_grid->grid_width = view->grid_width;
+    rgbs_grid->grid_height = view->grid_height;
+    rgbs_grid->shading_correction = view->shading_correction;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Maximum number of RGBS grid views accepted by ia_aiq_statistics_set_v1_view.
+ */
+#define IA_AIQ_STATISTICS_VIEW_MAX_GRIDS IA_AIQ_MAX_NUM_EXPOSURES
+
+/*!
+ * \brief Sets statistics to AIQ taking RGBS grids as views to ISP statistics.
+ * rgbs_grids and num_rgbs_grids of statistics_input_params are ignored and replaced by the packed views.
+ * All other fields are passed to ia_aiq_statistics_set_v1 as they are.
+ *
+ * \param[in] ia_aiq                   Mandatory. AIQ instance handle.
+ * \param[in] statistics_input_params  Mandatory. Statistics and information about the frame.
+ * \param[in] rgbs_views               Mandatory. RGBS grid views, one per exposure.
+ * \param[in] num_rgbs_views           Mandatory. Number of views [1, IA_AIQ_STATISTICS_VIEW_MAX_GRIDS].
+ * \param[in] blocks                   Mandatory. Client owned storage for the packed blocks of all views. Can be reused for every frame.
+ * \param[in] num_blocks               Mandatory. Number of blocks in the storage.
+ * \return                             Error code.
+ */
+static inline ia_err
+ia_aiq_statistics_set_v1_view(ia_aiq *ia_aiq,
+                              const ia_aiq_statistics_input_params_v1 *statistics_input_params,
+                              const ia_aiq_rgbs_grid_view *rgbs_views,
+                              unsigned int num_rgbs_views,
+                              rgbs_grid_block *blocks,
+                              unsigned int num_blocks)
+{
+    ia_aiq_rgbs_grid grids[IA_AIQ_STATISTICS_VIEW_MAX_GRIDS];
+    const ia_aiq_rgbs_grid *grid_ptrs[IA_AIQ_STATISTICS_VIEW_MAX_GRIDS];
+    ia_aiq_statistics_input_params_v1 params;
+    unsigned int used = 0;
+    unsigned int i;
+    ia_err err;
+
+    if (ia_aiq == NULL || statistics_input_params == NULL || rgbs_views == NULL ||
+        num_rgbs_views == 0 || num_rgbs_views > IA_AIQ_STATISTICS_VIEW_MAX_GRIDS)
+        return ia_err_argument;
+
+    for (i = 0; i < num_rgbs_views; i++) {
+        unsigned int size = (unsigned int)rgbs_views[i].grid_width * rgbs_views[i].grid_height;
+        if (used + size > num_blocks)
+            return ia_err_nomemory;
+        err = ia_aiq_rgbs_grid_view_pack(&rgbs_views[i], blocks + used, &grids[i]);
+        if (err != ia_err_none)
+            return err;
+        grid_ptrs[i] = &grids[i];
+        used += size;
+    }
+
+    params = *statistics_input_params;
+    params.rgbs_grids = grid_ptrs;
+    params.num_rgbs_grids = num_rgbs_views;
+    return ia_aiq_statistics_set_v1(ia_aiq, &params);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_AIQ_STATISTICS_VIEW_H_ */
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_cmc_file.h
+ * \brief Memory mapped AIQB file with lazily parsed CMC.
+ *
+ * ia_cmc_file maps the AIQB file read-only into memory instead of reading it into a heap buffer. Pages of the file are
+ * loaded by the kernel only when touched and, being clean file backed pages, they can be dropped again under memory
+ * pressure.
+ *
+ * Single records can be accessed in place with ia_cmc_file_find_record, which touches only the record headers on the way
+ * and the requested record itself. Full ia_cmc_t is parsed with ia_cmc_parser_init_v1 on the first call of
+ * ia_cmc_file_get_cmc, so pipelines which need only a few records or no CMC at all don't pay for parsing.
+ * Note that ia_cmc_parser_init_v1 decodes all CMC records into its own memory when it is called.
+ *
+ * The mapping (ia_cmc_file_aiqb) can be given directly as aiqb_data to ia_aiq_init, ia_isp_bxt_init, ia_ltm_init etc.
+ *
+ * Functions are not thread-safe. ia_cmc_file_get_cmc must not be called concurrently with the same file.
+ */
+
+#ifndef _IA_CMC_FILE_H_
+#define _IA_CMC_FILE_H_
+
+#include "ia_cmc_parser.h"
+#include "ia_cmc_types.h"
+#include "ia_types.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(WIN32) && !defined(__BUILD_FOR_GSD_AOH__)
+#define IA_CMC_FILE_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief AIQB file.
+ */
+typedef struct
+{
+    ia_binary_data aiqb;    /*!< Contents of the file. */
+    bool mapped;            /*!< Contents are memory mapped. Otherwise they have been read into allocated memory. */
+    ia_cmc_t *ia_cmc;       /*!< Parsed CMC. NULL, until ia_cmc_file_get_cmc is called. */
+} ia_cmc_file;
+
+static inline ia_err
+ia_cmc_file_validate(ia_cmc_file *file)
+{
+    ia_mkn_header header;
+
+    if (file->aiqb.size < sizeof(header))
+        return ia_err_data;
+    memcpy(&header, file->aiqb.data, sizeof(header));
+    if (header.tag != AIQB_TAG || header.size < sizeof(header) || header.size > file->aiqb.size)
+        return ia_err_data;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Closes AIQB file. Parsed CMC is released.
+ * Data returned by ia_cmc_file_aiqb, ia_cmc_file_find_record and ia_cmc_file_get_cmc must not be used after this call.
+ */
+static inline void
+ia_cmc_file_close(ia_cmc_file *file)
+{
+    if (file == NULL)
+        return;
+    if (file->ia_cmc != NULL)
+        ia_cmc_parser_deinit(file->ia_cmc);
+    if (file->aiqb.data != NULL) {
+#ifdef IA_CMC_FILE_HAS_MMAP
+        if (file->mapped)
+            munmap(file->aiqb.data, file->aiqb.size);
+        else
+#endif
+            free(file->aiqb.data);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+#ifdef IA_CMC_FILE_HAS_MMAP
+/*!
+ * \brief Maps AIQB file from an open file descriptor.
+ * Descriptor is not closed and can be closed by the caller right after this call.
+ *
+ * \param[out] file  Mandatory. AIQB file.
+ * \param[in]  fd    Mandatory. File descriptor opened for reading.
+ * \return           Error code. ia_err_data, if the file is not AIQB.
+ */
+static inline ia_err
+ia_cmc_file_open_fd(ia_cmc_file *file, int fd)
+{
+    struct stat st;
+    void *data;
+    ia_err err;
+
+    if (file == NULL || fd < 0)
+        return ia_err_argument;
+    memset(file, 0, sizeof(*file));
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (unsigned long long)st.st_size > 0xFFFFFFFFULL)
+        return ia_err_general;
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+        return ia_err_general;
+    file->aiqb.data = data;
+    file->aiqb.size = (unsigned int)st.st_size;
+    file->mapped = true;
+
+    err = ia_cmc_file_validate(file);
+    if (err != ia_err_none)
+        ia_cmc_file_close(file);
+    return err;
+}
+#endif
+
+/*!
+ * \brief Opens AIQB file. File is memory mapped where supported and read into memory otherwise.
+ *
+ * \param[out] file  Mandatory. AIQB file.
+ * \param[in]  path  Mandatory. Path of the AIQB file.
+ * \return           Error code. ia_err_data, if the file is not AIQB.
+ */
+static inline ia_err
+ia_cmc_file_open(ia_cmc_file *file, const char *path)
+{
+    ia_err err;
+
+    if (file == NULL || path == NULL)
+        return ia_err_argument;
+    memset(file, 0, sizeof(*file));
+
+#ifdef IA_CMC_FILE_HAS_MMAP
+    {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return ia_err_general;
+        err = ia_cmc_file_open_fd(file, fd);
+        close(fd);
+        return err;
+    }
+#else
+    {
+        long size;
+        FILE *stream = fopen(path, "rb");
+        if (stream == NULL)
+            return ia_err_general;
+        if (fseek(stream, 0, SEEK_END) != 0 || (size = ftell(stream)) <= 0 || fseek(stream, 0, SEEK_SET) != 0) {
+            fclose(stream);
+            return ia_err_general;
+        }
+        file->aiqb.data = malloc((size_t)size);
+        if (file->aiqb.data == NULL) {
+            fclose(stream);
+            return ia_err_nomemory;
+        }
+        file->aiqb.size = (unsigned int)size;
+        if (fread(file->aiqb.data, (size_t)size, 1, stream) != 1) {
+            fclose(stream);
+            ia_cmc_file_close(file);
+            return ia_err_general;
+        }
+        fclose(stream);
+    }
+    err = ia_cmc_file_validate(file);
+    if (err != ia_err_none)
+        ia_cmc_file_close(file);
+    return err;
+#endif
+}
+
+/*!
+ * \brief Returns contents of the AIQB file for initialization functions taking aiqb_data.
+ */
+static inline const ia_binary_data *
+ia_cmc_file_aiqb(const ia_cmc_file *file)
+{
+    return file != NULL && file->aiqb.data != NULL ? &file->aiqb : NULL;
+}
+
+/*!
+ * \brief Finds a record from AIQB without parsing the CMC.
+ * Record is returned in place. Its layout is defined by the record type in ia_cmc_types.h (e.g. cmc_general_data_t for
+ * cmc_name_id_general_data). Records are aligned to 4 bytes in AIQB, so records with 64 bit members should be copied
+ * before use on platforms which require natural alignment.
+ *
+ * \param[in] file          Mandatory. AIQB file.
+ * \param[in] data_name_id  Mandatory. Name ID of the record, e.g. cmc_name_id_general_data.
+ * \return                  Header of the first record with the name ID or NULL, if not found.
+ */
+static inline const ia_mkn_record_header *
+ia_cmc_file_find_record(const ia_cmc_file *file, uint16_t data_name_id)
+{
+    const unsigned char *data;
+    ia_mkn_header header;
+    size_t offset;
+
+    if (file == NULL || file->aiqb.data == NULL)
+        return NULL;
+    data = (const unsigned char *)file->aiqb.data;
+    memcpy(&header, data, sizeof(header));
+
+    for (offset = sizeof(header); offset + sizeof(ia_mkn_record_header) <= header.size; ) {
+        ia_mkn_record_header record;
+        memcpy(&record, data + offset, sizeof(record));
+        if (record.size < sizeof(record) || record.size > header.size - offset)
+            return NULL;
+        if (record.data_name_id == data_name_id)
+            return (const ia_mkn_record_header *)(data + offset);
+        offset += record.size;
+    }
+    return NULL;
+}
+
+/*!
+ * \brief Returns parsed CMC. CMC is parsed on the first call.
+ * The CMC is owned by the file and can be given to ia_aiq_init and other functions taking ia_cmc_t.
+ *
+ * \param[in,out] file      Mandatory. AIQB file.
+ * \param[in]     nvm_data  Optional. NVM data. Used only on the first call, when the CMC is parsed.
+ * \return                  Parsed CMC or NULL in case of an error.
+ */
+static inline ia_cmc_t *
+ia_cmc_file_get_cmc(ia_cmc_file *file, const ia_binary_data *nvm_data)
+{
+    if (file == NULL || file->aiqb.data == NULL)
+        return NULL;
+    if (file->ia_cmc == NULL)
+        file->ia_cmc = ia_cmc_parser_init_v1(&file->aiqb, nvm_data);
+    return file->ia_cmc;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_CMC_FILE_H_ */
@@ -0,0 +1,969 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_cmc_snapshot.h
+ * \brief Persistent binary snapshot of parsed CMC.
+ *
+ * ia_cmc_serialize stores ia_cmc_t with everything it points to into one contiguous image. Pointers are stored as offsets
+ * from the start of the image and listed in a relocation table, the same way as in AIQ recordings (see ia_aiq_record.h).
+ * The image is keyed with a hash of the AIQB and NVM data it was parsed from (ia_cmc_snapshot_key), so a stale snapshot
+ * is detected after tuning or module change.
+ *
+ * ia_cmc_deserialize turns an image into ia_cmc_t in place by adding the image address to the pointers listed in the
+ * relocation table. No parsing is done and only pages containing pointers are written. ia_cmc_snapshot_load maps a
+ * snapshot file copy-on-write and deserializes it, so on camera restart the CMC is available without ia_cmc_parser_init_v1:
+ * \code
+ * const uint64_t key = ia_cmc_snapshot_key(aiqb, nvm);
+ * ia_cmc_snapshot snapshot;
+ * ia_cmc_t *cmc = NULL;
+ *
+ * if (ia_cmc_snapshot_load(&snapshot, "/var/cache/camera/imx185.cmcs", key) == ia_err_none) {
+ *     cmc = snapshot.ia_cmc;
+ * } else {
+ *     cmc = ia_cmc_parser_init_v1(aiqb, nvm);
+ *     ia_cmc_snapshot_save("/var/cache/camera/imx185.cmcs", cmc, key);
+ * }
+ * \endcode
+ *
+ * Image is stored in the memory layout of the host and can be used on hosts with the same ABI and library version.
+ * CMC returned from a snapshot is owned by the snapshot and must not be given to ia_cmc_parser_deinit.
+ */
+
+#ifndef _IA_CMC_SNAPSHOT_H_
+#define _IA_CMC_SNAPSHOT_H_
+
+#include "ia_aiq_record.h"
+#include "ia_cmc_types.h"
+#include "ia_types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(WIN32) && !defined(__BUILD_FOR_GSD_AOH__)
+#define IA_CMC_SNAPSHOT_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IA_CMC_SNAPSHOT_MAGIC IA_MKN_CHTOUL('C','M','C','S')
+#define IA_CMC_SNAPSHOT_VERSION 1
+
+/*!
+ * \brief Header in the beginning of a CMC image.
+ */
+typedef struct
+{
+    uint32_t magic;             /*!< IA_CMC_SNAPSHOT_MAGIC. */
+    uint32_t version;           /*!< IA_CMC_SNAPSHOT_VERSION. */
+    uint32_t pointer_size;      /*!< Size of pointers on the host which created the image. */
+    uint32_t cmc_size;          /*!< Size of ia_cmc_t on the host which created the image. */
+    uint64_t key;               /*!< Hash of AIQB and NVM data, see ia_cmc_snapshot_key. */
+    uint64_t size;              /*!< Size of the image including this header. */
+    uint64_t cmc_offset;        /*!< Offset of ia_cmc_t. */
+    uint64_t reloc_offset;      /*!< Offset of relocation table (uint32_t offsets of pointers). */
+    uint64_t num_relocs;        /*!< Number of pointers. */
+    uint64_t base;              /*!< Address the pointers are currently relocated to. 0 in a stored image. */
+} ia_cmc_snapshot_header;
+
+/*!
+ * \brief Calculates key of CMC parsed from given AIQB and NVM data (64 bit FNV-1a hash).
+ *
+ * \param[in] aiqb_data  Mandatory. AIQB data.
+ * \param[in] nvm_data   Optional. NVM data.
+ * \return               Key.
+ */
+static inline uint64_t
+ia_cmc_snapshot_key(const ia_binary_data *aiqb_data,
+                    const ia_binary_data *nvm_data)
+{
+    const ia_binary_data *inputs[2];
+    uint64_t hash = 14695981039346656037ULL;
+    unsigned int i, j;
+
+    inputs[0] = aiqb_data;
+    inputs[1] = nvm_data;
+    for (i = 0; i < 2; i++) {
+        const unsigned char *data;
+        const unsigned int size = inputs[i] != NULL && inputs[i]->data != NULL ? inputs[i]->size : 0;
+        for (j = 0; j < 4; j++) {
+            hash ^= (size >> (8 * j)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+        data = size > 0 ? (const unsigned char *)inputs[i]->data : NULL;
+        for (j = 0; j < size; j++) {
+            hash ^= data[j];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+/*!
+ * \brief Memory block of the source CMC already stored into the image.
+ */
+typedef struct
+{
+    const unsigned char *src;
+    size_t size;
+    size_t offset;
+} ia_cmc_snapshot_span;
+
+typedef struct
+{
+    ia_aiq_record_buffer buffer;
+    ia_cmc_snapshot_span *spans;
+    unsigned int num_spans;
+    unsigned int max_spans;
+} ia_cmc_snapshot_writer;
+
+/*!
+ * \brief Stores data pointed by the pointer at offset slot and links the pointer to it.
+ * Parser keeps many pointers into records it has already copied (e.g. LSC grids inside the LSC record) and shares arrays
+ * between pointers. If data is inside an already stored block, pointer is linked into that block and created is set to
+ * false. Size 0 means that the data is only known to be inside an already stored block.
+ *
+ * \return Offset of the data in the image or 0, if src is NULL or in case of an error.
+ */
+static inline size_t
+ia_cmc_snapshot_data(ia_cmc_snapshot_writer *w, size_t slot, const void *src,
+                     size_t copy_size, size_t size, bool *created)
+{
+    const unsigned char *p = (const unsigned char *)src;
+    size_t offset;
+    unsigned int i;
+
+    if (created != NULL)
+        *created = false;
+    if (src == NULL || w->buffer.err != ia_err_none) {
+        ia_aiq_record_link(&w->buffer, slot, 0);
+        return 0;
+    }
+
+    for (i = 0; i < w->num_spans; i++) {
+        const ia_cmc_snapshot_span *span = &w->spans[i];
+        if (p >= span->src && p < span->src + span->size && (size_t)(p - span->src) + size <= span->size) {
+            offset = span->offset + (size_t)(p - span->src);
+            ia_aiq_record_link(&w->buffer, slot, offset);
+            return offset;
+        }
+    }
+    if (size == 0) {
+        w->buffer.err = ia_err_data;
+        return 0;
+    }
+
+    if (w->num_spans == w->max_spans) {
+        const unsigned int max_spans = w->max_spans > 0 ? w->max_spans * 2 : 64;
+        ia_cmc_snapshot_span *spans = (ia_cmc_snapshot_span *)realloc(w->spans, max_spans * sizeof(*spans));
+        if (spans == NULL) {
+            w->buffer.err = ia_err_nomemory;
+            return 0;
+        }
+        w->spans = spans;
+        w->max_spans = max_spans;
+    }
+    offset = ia_aiq_record_put(&w->buffer, NULL, size);
+    if (offset == 0)
+        return 0;
+    memcpy(w->buffer.data + offset, src, copy_size < size ? copy_size : size);
+    w->spans[w->num_spans].src = p;
+    w->spans[w->num_spans].size = size;
+    w->spans[w->num_spans].offset = offset;
+    w->num_spans++;
+    ia_aiq_record_link(&w->buffer, slot, offset);
+    if (created != NULL)
+        *created = true;
+    return offset;
+}
+
+/*!
+ * \brief Stores array. Size 0 requires the array to be inside an already stored block.
+ */
+static inline size_t
+ia_cmc_snapshot_array(ia_cmc_snapshot_writer *w, size_t slot, const void *src, size_t size)
+{
+    return ia_cmc_snapshot_data(w, slot, src, size, size, NULL);
+}
+
+/*!
+ * \brief Stores a copied AIQB record. Record size comes from its header. Records of older versions can be shorter than
+ * the structure, in which case the rest is zero filled.
+ */
+static inline size_t
+ia_cmc_snapshot_record(ia_cmc_snapshot_writer *w, size_t slot, const void *src, size_t struct_size)
+{
+    ia_mkn_record_header header;
+
+    if (src == NULL)
+        return ia_cmc_snapshot_data(w, slot, NULL, 0, 0, NULL);
+    memcpy(&header, src, sizeof(header));
+    return ia_cmc_snapshot_data(w, slot, src, header.size,
+                                header.size > struct_size ? header.size : struct_size, NULL);
+}
+
+static inline size_t
+ia_cmc_snapshot_string(ia_cmc_snapshot_writer *w, size_t slot, const uint8_t *src)
+{
+    return ia_cmc_snapshot_array(w, slot, src, src != NULL ? strlen((const char *)src) + 1 : 0);
+}
+
+static inline void
+ia_cmc_snapshot_write_comment(ia_cmc_snapshot_writer *w, size_t c, const cmc_parsed_comment_t *src)
+{
+    size_t versions;
+    bool created;
+    unsigned int i;
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_comment.cmc_comment), src->cmc_comment,
+                           sizeof(cmc_comment_t));
+    ia_cmc_snapshot_string(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_comment.comment), src->comment);
+    versions = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_comment.version_infos), src->version_infos,
+                                    src->num_version_infos * sizeof(cmc_version_info_t),
+                                    src->num_version_infos * sizeof(cmc_version_info_t), &created);
+    for (i = 0; created && i < src->num_version_infos; i++) {
+        const size_t info = versions + i * sizeof(cmc_version_info_t);
+        ia_cmc_snapshot_string(w, IA_AIQ_RECORD_SLOT(info, cmc_version_info_t, key), src->version_infos[i].key);
+        ia_cmc_snapshot_string(w, IA_AIQ_RECORD_SLOT(info, cmc_version_info_t, version), src->version_infos[i].version);
+    }
+}
+
+static inline void
+ia_cmc_snapshot_write_chromaticity(ia_cmc_snapshot_writer *w, size_t c, const cmc_parsed_chromaticity_response_t *src)
+{
+    const cmc_chromaticity_response_v101_t *v101 = src->cmc_chromaticity_response_v101;
+    size_t offset, gamuts;
+    bool created;
+    unsigned int i;
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_chromaticity_response.cmc_chromaticity_response),
+                           src->cmc_chromaticity_response, sizeof(cmc_chromaticity_response_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_chromaticity_response.cmc_lightsources_avg),
+                          src->cmc_lightsources_avg, 0);
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_chromaticity_response.cmc_lightsources_hi),
+                          src->cmc_lightsources_hi, 0);
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_chromaticity_response.cmc_lightsources_lo),
+                          src->cmc_lightsources_lo, 0);
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_chromaticity_response.cmc_lightsources_nvm),
+                          src->cmc_lightsources_nvm, 0);
+
+    offset = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_chromaticity_response.cmc_chromaticity_response_v101),
+                                  v101, sizeof(*v101), sizeof(*v101), &created);
+    if (!created)
+        return;
+    gamuts = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(offset, cmc_chromaticity_response_v101_t, cmc_gamut), v101->cmc_gamut,
+                                  v101->num_illumination_gamuts * sizeof(cmc_gamut_t),
+                                  v101->num_illumination_gamuts * sizeof(cmc_gamut_t), &created);
+    for (i = 0; created && i < v101->num_illumination_gamuts; i++) {
+        const size_t gamut = gamuts + i * sizeof(cmc_gamut_t);
+        const size_t size = v101->cmc_gamut[i].size * sizeof(uint16_t);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(gamut, cmc_gamut_t, gamut_r_per_g), v101->cmc_gamut[i].gamut_r_per_g, size);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(gamut, cmc_gamut_t, gamut_b_per_g), v101->cmc_gamut[i].gamut_b_per_g, size);
+    }
+}
+
+static inline void
+ia_cmc_snapshot_write_geometric_distortion2(ia_cmc_snapshot_writer *w, size_t slot,
+                                            const cmc_parsed_geometric_distortion2_t *src)
+{
+    const size_t grid_size = (src != NULL && src->ldc_grid_width > 0 && src->ldc_grid_height > 0)
+                             ? (size_t)src->ldc_grid_width * src->ldc_grid_height * sizeof(int32_t) : 0;
+    size_t offset, grids, luts;
+    bool created;
+    int i;
+
+    offset = ia_cmc_snapshot_data(w, slot, src, sizeof(*src), sizeof(*src), &created);
+    if (!created)
+        return;
+    grids = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(offset, cmc_parsed_geometric_distortion2_t, ldc_grid), src->ldc_grid,
+                                 src->ldc_grid_count * sizeof(cmc_geometric_distortion2_grid_t),
+                                 src->ldc_grid_count * sizeof(cmc_geometric_distortion2_grid_t), &created);
+    for (i = 0; created && i < src->ldc_grid_count; i++) {
+        const size_t grid = grids + i * sizeof(cmc_geometric_distortion2_grid_t);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(grid, cmc_geometric_distortion2_grid_t, x_deltas), src->ldc_grid[i].x_deltas, grid_size);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(grid, cmc_geometric_distortion2_grid_t, y_deltas), src->ldc_grid[i].y_deltas, grid_size);
+    }
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_parsed_geometric_distortion2_t, ldc_lut), src->ldc_lut,
+                          src->ldc_lut_count > 0 ? src->ldc_lut_count * sizeof(cmc_ldc_lut_t) : 0);
+    luts = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(offset, cmc_parsed_geometric_distortion2_t, wfov_ldc_lut), src->wfov_ldc_lut,
+                                src->num_wfov_luts > 0 ? src->num_wfov_luts * sizeof(cmc_wfov_ldc_lut_t) : 0,
+                                src->num_wfov_luts > 0 ? src->num_wfov_luts * sizeof(cmc_wfov_ldc_lut_t) : 0, &created);
+    for (i = 0; created && i < src->num_wfov_luts; i++) {
+        const size_t lut = luts + i * sizeof(cmc_wfov_ldc_lut_t);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(lut, cmc_wfov_ldc_lut_t, ldc_r_lut), src->wfov_ldc_lut[i].ldc_r_lut,
+                              src->wfov_ldc_lut[i].num_lut_elements > 0 ? src->wfov_ldc_lut[i].num_lut_elements * sizeof(float) : 0);
+    }
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_parsed_geometric_distortion2_t, affine_params), src->affine_params,
+                          src->num_wfov_luts > 0 ? src->num_wfov_luts * sizeof(cmc_affine_params_t) : 0);
+}
+
+static inline void
+ia_cmc_snapshot_write_multi_led_flash(ia_cmc_snapshot_writer *w, size_t slot, const cmc_multi_led_flash_t *src)
+{
+    size_t offset, devices;
+    bool created;
+    unsigned int i;
+
+    offset = ia_cmc_snapshot_data(w, slot, src, sizeof(*src), sizeof(*src), &created);
+    if (!created)
+        return;
+    devices = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(offset, cmc_multi_led_flash_t, flash_devices), src->flash_devices,
+                                   src->num_flash_devices * sizeof(cmc_flash_device_t),
+                                   src->num_flash_devices * sizeof(cmc_flash_device_t), &created);
+    for (i = 0; created && i < src->num_flash_devices; i++) {
+        const size_t device = devices + i * sizeof(cmc_flash_device_t);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(device, cmc_flash_device_t, poly_points), src->flash_devices[i].poly_points,
+                              src->flash_devices[i].num_poly_points * sizeof(cmc_poly_point_t));
+    }
+}
+
+static inline void
+ia_cmc_snapshot_write_advanced_color_matrix(ia_cmc_snapshot_writer *w, size_t c, const cmc_parsed_advanced_color_matrix_t *src)
+{
+    const cmc_advanced_color_matrix_info_t *info = src->cmc_advanced_color_matrix_info;
+    const unsigned int num_light_sources = info != NULL ? info->light_sources_count : 0;
+    const unsigned int num_sectors = info != NULL ? info->sector_count : 0;
+    size_t light_sources;
+    bool created;
+    unsigned int i;
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_advanced_color_matrix.cmc_advanced_color_matrix_info),
+                           info, sizeof(*info));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_advanced_color_matrix.hue_of_sectors),
+                          src->hue_of_sectors, num_sectors * sizeof(uint32_t));
+    light_sources = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_advanced_color_matrix.cmc_parsed_advanced_color_matrices_ls),
+                                         src->cmc_parsed_advanced_color_matrices_ls,
+                                         num_light_sources * sizeof(cmc_parsed_advanced_color_matrices_ls_t),
+                                         num_light_sources * sizeof(cmc_parsed_advanced_color_matrices_ls_t), &created);
+    for (i = 0; created && i < num_light_sources; i++) {
+        const size_t ls = light_sources + i * sizeof(cmc_parsed_advanced_color_matrices_ls_t);
+        const cmc_parsed_advanced_color_matrices_ls_t *matrices = &src->cmc_parsed_advanced_color_matrices_ls[i];
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(ls, cmc_parsed_advanced_color_matrices_ls_t, color_matrices_info),
+                              matrices->color_matrices_info, sizeof(cmc_acm_color_matrices_info_t));
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(ls, cmc_parsed_advanced_color_matrices_ls_t, advanced_color_matrices),
+                              matrices->advanced_color_matrices, num_sectors * sizeof(cmc_acm_color_matrix_t));
+    }
+}
+
+static inline void
+ia_cmc_snapshot_write_ir_weight(ia_cmc_snapshot_writer *w, size_t slot, const cmc_parsed_ir_weight_t *src)
+{
+    const cmc_ir_weight_info_t *info;
+    size_t offset, grids;
+    bool created;
+    unsigned int i;
+
+    offset = ia_cmc_snapshot_data(w, slot, src, sizeof(*src), sizeof(*src), &created);
+    if (!created)
+        return;
+    info = src->ir_weight_info;
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(offset, cmc_parsed_ir_weight_t, ir_weight_info), info, sizeof(*info));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_parsed_ir_weight_t, ir_proportion), src->ir_proportion,
+                          sizeof(cmc_ir_proportion_t));
+    if (info == NULL) {
+        ia_aiq_record_link(&w->buffer, IA_AIQ_RECORD_SLOT(offset, cmc_parsed_ir_weight_t, ir_weight_grids), 0);
+        return;
+    }
+    grids = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(offset, cmc_parsed_ir_weight_t, ir_weight_grids), src->ir_weight_grids,
+                                 info->num_light_sources * sizeof(cmc_ir_weight_grids_t),
+                                 info->num_light_sources * sizeof(cmc_ir_weight_grids_t), &created);
+    for (i = 0; created && i < info->num_light_sources; i++) {
+        const size_t grid = grids + i * sizeof(cmc_ir_weight_grids_t);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(grid, cmc_ir_weight_grids_t, ir_weight_grid_info),
+                              src->ir_weight_grids[i].ir_weight_grid_info, sizeof(cmc_ir_weight_grid_info_t));
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(grid, cmc_ir_weight_grids_t, ir_weight_grid), src->ir_weight_grids[i].ir_weight_grid,
+                              (size_t)info->num_grids * info->grid_width * info->grid_height * sizeof(uint16_t));
+    }
+}
+
+static inline void
+ia_cmc_snapshot_write_lsc_grid(ia_cmc_snapshot_writer *w, size_t offset, const cmc_lsc_grid *src, size_t grid_size)
+{
+    unsigned int i;
+
+    for (i = 0; i < 16; i++)
+        ia_cmc_snapshot_array(w, offset + offsetof(cmc_lsc_grid, grids) + i * sizeof(unsigned short *),
+                              src->grids[i / 4][i % 4], grid_size);
+}
+
+static inline void
+ia_cmc_snapshot_write_lens_shading(ia_cmc_snapshot_writer *w, size_t slot, const cmc_lens_shading_correction *src)
+{
+    size_t offset, grids, grid_size;
+    bool created;
+    unsigned int i;
+
+    offset = ia_cmc_snapshot_data(w, slot, src, sizeof(*src), sizeof(*src), &created);
+    if (!created)
+        return;
+    grid_size = (size_t)src->grid_width * src->grid_height * sizeof(unsigned short);
+    grids = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(offset, cmc_lens_shading_correction, lsc_grids), src->lsc_grids,
+                                 src->num_light_srcs * sizeof(cmc_lsc_grid), src->num_light_srcs * sizeof(cmc_lsc_grid), &created);
+    for (i = 0; created && i < src->num_light_srcs; i++)
+        ia_cmc_snapshot_write_lsc_grid(w, grids + i * sizeof(cmc_lsc_grid), &src->lsc_grids[i], grid_size);
+}
+
+static inline void
+ia_cmc_snapshot_write_lens_shading_ratio(ia_cmc_snapshot_writer *w, size_t slot, const cmc_lens_shading_ratio_correction *src)
+{
+    size_t offset, grids, grid_size;
+    bool created;
+    unsigned int i;
+
+    offset = ia_cmc_snapshot_data(w, slot, src, sizeof(*src), sizeof(*src), &created);
+    if (!created)
+        return;
+    grid_size = (size_t)src->grid_width * src->grid_height * sizeof(unsigned short);
+    grids = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(offset, cmc_lens_shading_ratio_correction, ratio_grids), src->ratio_grids,
+                                 src->num_light_srcs * sizeof(cmc_lsc_ratio_grid), src->num_light_srcs * sizeof(cmc_lsc_ratio_grid),
+                                 &created);
+    for (i = 0; created && i < src->num_light_srcs; i++)
+        ia_cmc_snapshot_write_lsc_grid(w, grids + i * sizeof(cmc_lsc_ratio_grid) + offsetof(cmc_lsc_ratio_grid, lsc_grid),
+                                       &src->ratio_grids[i].lsc_grid, grid_size);
+}
+
+static inline void
+ia_cmc_snapshot_write_cmc(ia_cmc_snapshot_writer *w, size_t slot, const ia_cmc_t *src)
+{
+    const size_t c = ia_cmc_snapshot_array(w, slot, src, sizeof(*src));
+    size_t offset;
+    bool created;
+
+    if (c == 0)
+        return;
+
+    ia_cmc_snapshot_write_comment(w, c, &src->cmc_parsed_comment);
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_general_data), src->cmc_general_data, sizeof(cmc_general_data_t));
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_black_level.cmc_black_level),
+                           src->cmc_parsed_black_level.cmc_black_level, sizeof(cmc_black_level_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_black_level.cmc_black_level_luts),
+                          src->cmc_parsed_black_level.cmc_black_level_luts,
+                          src->cmc_parsed_black_level.cmc_black_level != NULL
+                          ? src->cmc_parsed_black_level.cmc_black_level->num_bl_luts * sizeof(cmc_black_level_lut_t) : 0);
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_saturation_level), src->cmc_saturation_level,
+                           sizeof(cmc_saturation_level_t));
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_linearity.cmc_linearity),
+                           src->cmc_parsed_linearity.cmc_linearity, sizeof(cmc_linearity_t));
+    if (src->cmc_parsed_linearity.cmc_linearity != NULL) {
+        const cmc_linearity_t *linearity = src->cmc_parsed_linearity.cmc_linearity;
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_linearity.cmc_linearity_lut),
+                              src->cmc_parsed_linearity.cmc_linearity_lut,
+                              ((size_t)linearity->num_linearity_cc1 + linearity->num_linearity_cc2 +
+                               linearity->num_linearity_cc3 + linearity->num_linearity_cc4) * sizeof(uint16_t));
+    } else {
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_linearity.cmc_linearity_lut),
+                              src->cmc_parsed_linearity.cmc_linearity_lut, 0);
+    }
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_sensitivity), src->cmc_sensitivity, sizeof(cmc_sensitivity_t));
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_defect_pixel), src->cmc_defect_pixel, sizeof(cmc_defect_pixel_t));
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_noise_model), src->cmc_noise_model, sizeof(cmc_noise));
+
+    /* Grids and ratios of the legacy shading records point inside the records. */
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_lens_shading.cmc_lens_shading),
+                           src->cmc_parsed_lens_shading.cmc_lens_shading, sizeof(cmc_lens_shading_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_lens_shading.cmc_lsc_grids),
+                          src->cmc_parsed_lens_shading.cmc_lsc_grids, 0);
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_lens_shading.lsc_grids),
+                          src->cmc_parsed_lens_shading.lsc_grids, 0);
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_lens_shading.cmc_lsc_rg_bg_ratios),
+                          src->cmc_parsed_lens_shading.cmc_lsc_rg_bg_ratios, 0);
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_lens_shading_ratio.cmc_lens_shading_ratio),
+                           src->cmc_parsed_lens_shading_ratio.cmc_lens_shading_ratio, sizeof(cmc_lens_shading_ratio_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_lens_shading_ratio.cmc_lsc_ratio_grids),
+                          src->cmc_parsed_lens_shading_ratio.cmc_lsc_ratio_grids, 0);
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_lens_shading_ratio.lsc_grids),
+                          src->cmc_parsed_lens_shading_ratio.lsc_grids, 0);
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_geometric_distortion), src->cmc_geometric_distortion,
+                           sizeof(cmc_geometric_distortion_t));
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_optics.cmc_optomechanics),
+                           src->cmc_parsed_optics.cmc_optomechanics, sizeof(cmc_optomechanics_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_optics.lut_apertures), src->cmc_parsed_optics.lut_apertures,
+                          src->cmc_parsed_optics.cmc_optomechanics != NULL
+                          ? src->cmc_parsed_optics.cmc_optomechanics->num_apertures * sizeof(uint16_t) : 0);
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_spectral_response.cmc_spectral_response),
+                           src->cmc_parsed_spectral_response.cmc_spectral_response, sizeof(cmc_spectral_response_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_spectral_response.spectral_responses),
+                          src->cmc_parsed_spectral_response.spectral_responses, 0);
+
+    ia_cmc_snapshot_write_chromaticity(w, c, &src->cmc_parsed_chromaticity_response);
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_flash_chromaticity.cmc_flash_chromaticity),
+                           src->cmc_parsed_flash_chromaticity.cmc_flash_chromaticity, sizeof(cmc_flash_chromaticity_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_flash_chromaticity.cmc_poly_points),
+                          src->cmc_parsed_flash_chromaticity.cmc_poly_points, 0);
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_nvm_info.cmc_nvm_info),
+                           src->cmc_parsed_nvm_info.cmc_nvm_info, sizeof(cmc_nvm_info_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_nvm_info.cmc_nvm_info_v101),
+                          src->cmc_parsed_nvm_info.cmc_nvm_info_v101, sizeof(cmc_nvm_info_v101_t));
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_color_matrices.cmc_color_matrices),
+                           src->cmc_parsed_color_matrices.cmc_color_matrices, sizeof(cmc_color_matrices_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_color_matrices.cmc_color_matrix),
+                          src->cmc_parsed_color_matrices.cmc_color_matrix,
+                          src->cmc_parsed_color_matrices.cmc_color_matrices != NULL
+                          ? src->cmc_parsed_color_matrices.cmc_color_matrices->num_matrices * sizeof(cmc_color_matrix_t) : 0);
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_color_matrices.ccm_estimate_method),
+                          src->cmc_parsed_color_matrices.ccm_estimate_method, sizeof(uint16_t));
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_analog_gain_conversion.cmc_analog_gain_conversion),
+                           src->cmc_parsed_analog_gain_conversion.cmc_analog_gain_conversion, sizeof(cmc_analog_gain_conversion_t));
+    if (src->cmc_parsed_analog_gain_conversion.cmc_analog_gain_conversion != NULL) {
+        const cmc_analog_gain_conversion_t *conversion = src->cmc_parsed_analog_gain_conversion.cmc_analog_gain_conversion;
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_analog_gain_conversion.cmc_analog_gain_segments),
+                              src->cmc_parsed_analog_gain_conversion.cmc_analog_gain_segments,
+                              conversion->num_segments * sizeof(cmc_analog_gain_segment_t));
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_analog_gain_conversion.cmc_analog_gain_pairs),
+                              src->cmc_parsed_analog_gain_conversion.cmc_analog_gain_pairs,
+                              conversion->num_pairs * sizeof(cmc_analog_gain_pair_t));
+    } else {
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_analog_gain_conversion.cmc_analog_gain_segments),
+                              src->cmc_parsed_analog_gain_conversion.cmc_analog_gain_segments, 0);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_analog_gain_conversion.cmc_analog_gain_pairs),
+                              src->cmc_parsed_analog_gain_conversion.cmc_analog_gain_pairs, 0);
+    }
+
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_digital_gain.cmc_digital_gain),
+                           src->cmc_parsed_digital_gain.cmc_digital_gain, sizeof(cmc_digital_gain_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_digital_gain.cmc_digital_gain_v102),
+                          src->cmc_parsed_digital_gain.cmc_digital_gain_v102, sizeof(cmc_digital_gain_v102_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_digital_gain.cmc_digital_gain_pairs),
+                          src->cmc_parsed_digital_gain.cmc_digital_gain_pairs,
+                          src->cmc_parsed_digital_gain.cmc_digital_gain_v102 != NULL
+                          ? src->cmc_parsed_digital_gain.cmc_digital_gain_v102->num_pairs * sizeof(cmc_analog_gain_pair_t) : 0);
+
+    ia_cmc_snapshot_write_geometric_distortion2(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_geometric_distortion2),
+                                                src->cmc_parsed_geometric_distortion2);
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_exposure_range), src->cmc_exposure_range,
+                           sizeof(cmc_exposure_range_t));
+    ia_cmc_snapshot_write_multi_led_flash(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_multi_led_flashes), src->cmc_multi_led_flashes);
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_emd_decoder_config), src->cmc_emd_decoder_config,
+                           sizeof(cmc_emd_decoder_config_t));
+    ia_cmc_snapshot_write_advanced_color_matrix(w, c, &src->cmc_parsed_advanced_color_matrix);
+    ia_cmc_snapshot_record(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_hdr_parameters), src->cmc_parsed_hdr_parameters,
+                           sizeof(cmc_parsed_hdr_parameters_t));
+    ia_cmc_snapshot_write_ir_weight(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_ir_weight), src->cmc_parsed_ir_weight);
+
+    /* Records below are decoded by the parser into structures with pointers, so header size is not the structure size. */
+    offset = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_phase_difference), src->cmc_phase_difference,
+                                  sizeof(cmc_phase_difference_t), sizeof(cmc_phase_difference_t), &created);
+    if (created) {
+        const cmc_phase_difference_t *pd = src->cmc_phase_difference;
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_phase_difference_t, cmc_pd_pattern), pd->cmc_pd_pattern,
+                              pd->num_pd_pixels * sizeof(cmc_pd_pattern_t));
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_phase_difference_t, cmc_pd_dlom), pd->cmc_pd_dlom,
+                              (size_t)pd->dlom_width * pd->dlom_height * sizeof(cmc_pd_dlom_t));
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_phase_difference_t, cmc_pd_ps_gains), pd->cmc_pd_ps_gains,
+                              (size_t)pd->ps_gains_width * pd->ps_gains_height * sizeof(cmc_pd_ps_gains_t));
+    }
+
+    offset = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_parsed_lca), src->cmc_parsed_lca,
+                                  sizeof(cmc_lateral_chromatic_aberration_correction),
+                                  sizeof(cmc_lateral_chromatic_aberration_correction), &created);
+    if (created) {
+        const cmc_lateral_chromatic_aberration_correction *lca = src->cmc_parsed_lca;
+        const size_t size = (size_t)lca->grid_width * lca->grid_height * sizeof(float);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_lateral_chromatic_aberration_correction, lca_grid_blue_x),
+                              lca->lca_grid_blue_x, size);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_lateral_chromatic_aberration_correction, lca_grid_blue_y),
+                              lca->lca_grid_blue_y, size);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_lateral_chromatic_aberration_correction, lca_grid_red_x),
+                              lca->lca_grid_red_x, size);
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_lateral_chromatic_aberration_correction, lca_grid_red_y),
+                              lca->lca_grid_red_y, size);
+    }
+
+    ia_cmc_snapshot_write_lens_shading(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_lens_shading), src->cmc_lens_shading);
+
+    offset = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_black_level_global), src->cmc_black_level_global,
+                                  sizeof(cmc_black_level_global), sizeof(cmc_black_level_global), &created);
+    if (created)
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_black_level_global, bl_values.ptr),
+                              src->cmc_black_level_global->bl_values.ptr,
+                              src->cmc_black_level_global->num_bl_luts * sizeof(cmc_black_level_values));
+
+    offset = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_valid_image_area), src->cmc_valid_image_area,
+                                  sizeof(cmc_valid_image_area), sizeof(cmc_valid_image_area), &created);
+    if (created)
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, cmc_valid_image_area, run_values.ptr),
+                              src->cmc_valid_image_area->run_values.ptr,
+                              src->cmc_valid_image_area->num_run_values * sizeof(cmc_run_value));
+
+    offset = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_analog_gain_conversions), src->cmc_analog_gain_conversions,
+                                  sizeof(cmc_analog_gain_conversions_t), sizeof(cmc_analog_gain_conversions_t), &created);
+    if (created) {
+        const cmc_analog_gain_conversions_t *conversions = src->cmc_analog_gain_conversions;
+        const size_t array = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(offset, cmc_analog_gain_conversions_t, conversions.ptr),
+                                                  conversions->conversions.ptr,
+                                                  conversions->num_exposures * sizeof(cmc_analog_gain_conversion2_t),
+                                                  conversions->num_exposures * sizeof(cmc_analog_gain_conversion2_t), &created);
+        unsigned int i;
+        for (i = 0; created && i < conversions->num_exposures; i++) {
+            const cmc_analog_gain_conversion2_t *conversion = &conversions->conversions.ptr[i];
+            const size_t item = array + i * sizeof(cmc_analog_gain_conversion2_t);
+            ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(item, cmc_analog_gain_conversion2_t, segments.ptr), conversion->segments.ptr,
+                                  conversion->num_segments * sizeof(cmc_analog_gain_segment2_t));
+            ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(item, cmc_analog_gain_conversion2_t, pairs.ptr), conversion->pairs.ptr,
+                                  conversion->num_pairs * sizeof(cmc_gain_code_pair_t));
+        }
+    }
+
+    ia_cmc_snapshot_write_lens_shading_ratio(w, IA_AIQ_RECORD_SLOT(c, ia_cmc_t, cmc_lens_shading_ratio), src->cmc_lens_shading_ratio);
+}
+
+/*!
+ * \brief Serializes parsed CMC into a relocatable image.
+ *
+ * \param[in]  ia_cmc  Mandatory. Parsed CMC, e.g. from ia_cmc_parser_init_v1.
+ * \param[in]  key     Mandatory. Key of the CMC, see ia_cmc_snapshot_key.
+ * \param[out] image   Mandatory. Image. Data is allocated with malloc and released by the caller with free.
+ * \return             Error code. ia_err_data, if CMC contains data in an unknown layout.
+ */
+static inline ia_err
+ia_cmc_serialize(const ia_cmc_t *ia_cmc,
+                 uint64_t key,
+                 ia_binary_data *image)
+{
+    ia_cmc_snapshot_writer w;
+    ia_cmc_snapshot_header header;
+    size_t cmc_offset, reloc_offset;
+
+    if (ia_cmc == NULL || image == NULL)
+        return ia_err_argument;
+    image->data = NULL;
+    image->size = 0;
+
+    memset(&w, 0, sizeof(w));
+    ia_aiq_record_put(&w.buffer, NULL, sizeof(header));
+    cmc_offset = w.buffer.size;
+    ia_cmc_snapshot_write_cmc(&w, 0, ia_cmc);
+    reloc_offset = ia_aiq_record_put(&w.buffer, w.buffer.relocs, w.buffer.num_relocs * sizeof(uint32_t));
+    free(w.spans);
+    if (w.buffer.err == ia_err_none && w.buffer.size > 0xFFFFFFFFULL)
+        w.buffer.err = ia_err_data;
+    if (w.buffer.err != ia_err_none) {
+        const ia_err err = w.buffer.err;
+        ia_aiq_record_buffer_free(&w.buffer);
+        return err;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = IA_CMC_SNAPSHOT_MAGIC;
+    header.version = IA_CMC_SNAPSHOT_VERSION;
+    header.pointer_size = sizeof(void *);
+    header.cmc_size = sizeof(ia_cmc_t);
+    header.key = key;
+    header.size = w.buffer.size;
+    header.cmc_offset = cmc_offset;
+    header.reloc_offset = reloc_offset;
+    header.num_relocs = w.buffer.num_relocs;
+    memcpy(w.buffer.data, &header, sizeof(header));
+
+    image->data = w.buffer.data;
+    image->size = (unsigned int)w.buffer.size;
+    free(w.buffer.relocs);
+    return ia_err_none;
+}
+
+/*!
+ * \brief Relocates pointers listed in the relocation table of an image to the address of the image.
+ * base is the address the pointers are relocated to (0 for offsets) and it is updated. Relocation table and, for an image
+ * with offsets, the stored offsets are validated before any pointer is changed.
+ *
+ * \return false, if the relocation table or a pointer is outside of the image.
+ */
+static inline bool
+ia_cmc_snapshot_relocate(unsigned char *data,
+                         size_t size,
+                         uint64_t reloc_offset,
+                         uint64_t num_relocs,
+                         uint64_t *base)
+{
+    const uint32_t *relocs;
+    uintptr_t delta;
+    uint64_t i;
+
+    if (reloc_offset > size || (reloc_offset & 3) != 0 || num_relocs > (size - reloc_offset) / sizeof(uint32_t))
+        return false;
+    relocs = (const uint32_t *)(data + reloc_offset);
+    delta = (uintptr_t)data - (uintptr_t)*base;
+    if (delta == 0)
+        return true;
+
+    for (i = 0; i < num_relocs; i++) {
+        uintptr_t value;
+        if (size < sizeof(value) || relocs[i] > size - sizeof(value))
+            return false;
+        memcpy(&value, data + relocs[i], sizeof(value));
+        if (*base == 0 && (value == 0 || value >= size))
+            return false;
+    }
+    for (i = 0; i < num_relocs; i++) {
+        uintptr_t value;
+        memcpy(&value, data + relocs[i], sizeof(value));
+        value += delta;
+        memcpy(data + relocs[i], &value, sizeof(value));
+    }
+    *base = (uint64_t)(uintptr_t)data;
+    return true;
+}
+
+/*!
+ * \brief Turns a serialized image into parsed CMC in place.
+ * Pointers in the image are relocated to the address of the image, so the image must be writable (e.g. mapped with
+ * MAP_PRIVATE). Calling again for the same image is cheap and an image moved in memory can be deserialized again.
+ *
+ * \param[in,out] image  Mandatory. Image created with ia_cmc_serialize. Must be aligned to 8 bytes.
+ * \param[in]     size   Mandatory. Size of the image.
+ * \param[in]     key    Mandatory. Expected key, see ia_cmc_snapshot_key.
+ * \return               CMC inside the image or NULL, if the image is invalid, created for another ABI or has another key.
+ */
+static inline ia_cmc_t *
+ia_cmc_deserialize(void *image,
+                   size_t size,
+                   uint64_t key)
+{
+    unsigned char *data = (unsigned char *)image;
+    ia_cmc_snapshot_header *header = (ia_cmc_snapshot_header *)image;
+
+    if (image == NULL || size < sizeof(*header) || ((uintptr_t)image & 7) != 0)
+        return NULL;
+    if (header->magic != IA_CMC_SNAPSHOT_MAGIC || header->version != IA_CMC_SNAPSHOT_VERSION ||
+        header->pointer_size != sizeof(void *) || header->cmc_size != sizeof(ia_cmc_t) ||
+        header->key != key || header->size != size ||
+        header->cmc_offset > size - sizeof(ia_cmc_t))
+        return NULL;
+    if (!ia_cmc_snapshot_relocate(data, size, header->reloc_offset, header->num_relocs, &header->base))
+        return NULL;
+    return (ia_cmc_t *)(data + header->cmc_offset);
+}
+
+/*!
+ * \brief Writes an image into a file.
+ * Image is written into a temporary file which then replaces the file, so that an existing file which is mapped by
+ * another snapshot is never modified in place.
+ */
+static inline ia_err
+ia_cmc_snapshot_write_file(const char *path, const void *data, size_t size)
+{
+    ia_err err = ia_err_none;
+    const size_t length = strlen(path);
+    char *temp_path = (char *)malloc(length + 5);
+    FILE *file;
+
+    if (temp_path == NULL)
+        return ia_err_nomemory;
+    memcpy(temp_path, path, length);
+    memcpy(temp_path + length, ".tmp", 5);
+
+    file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        free(temp_path);
+        return ia_err_general;
+    }
+    if (fwrite(data, size, 1, file) != 1)
+        err = ia_err_general;
+    if (fclose(file) != 0)
+        err = ia_err_general;
+#ifndef IA_CMC_SNAPSHOT_HAS_MMAP
+    if (err == ia_err_none)
+        remove(path);
+#endif
+    if (err == ia_err_none && rename(temp_path, path) != 0)
+        err = ia_err_general;
+    if (err != ia_err_none)
+        remove(temp_path);
+    free(temp_path);
+    return err;
+}
+
+/*!
+ * \brief Maps an image file copy-on-write into memory where supported and reads it into allocated memory otherwise.
+ * Release with ia_cmc_snapshot_unmap_file.
+ */
+static inline ia_err
+ia_cmc_snapshot_map_file(const char *path, void **data, size_t *size, bool *mapped)
+{
+    *data = NULL;
+    *size = 0;
+    *mapped = false;
+
+#ifdef IA_CMC_SNAPSHOT_HAS_MMAP
+    {
+        struct stat st;
+        void *map;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return ia_err_general;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            return ia_err_general;
+        }
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED)
+            return ia_err_general;
+        *data = map;
+        *size = (size_t)st.st_size;
+        *mapped = true;
+    }
+#else
+    {
+        long length;
+        FILE *file = fopen(path, "rb");
+        if (file == NULL)
+            return ia_err_general;
+        if (fseek(file, 0, SEEK_END) != 0 || (length = ftell(file)) <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+            fclose(file);
+            return ia_err_general;
+        }
+        *data = malloc((size_t)length);
+        if (*data == NULL) {
+            fclose(file);
+            return ia_err_nomemory;
+        }
+        if (fread(*data, (size_t)length, 1, file) != 1) {
+            fclose(file);
+            free(*data);
+            *data = NULL;
+            return ia_err_general;
+        }
+        fclose(file);
+        *size = (size_t)length;
+    }
+#endif
+    return ia_err_none;
+}
+
+/*!
+ * \brief Releases an image returned by ia_cmc_snapshot_map_file.
+ */
+static inline void
+ia_cmc_snapshot_unmap_file(void *data, size_t size, bool mapped)
+{
+    if (data == NULL)
+        return;
+#ifdef IA_CMC_SNAPSHOT_HAS_MMAP
+    if (mapped) {
+        munmap(data, size);
+        return;
+    }
+#endif
+    (void)size;
+    (void)mapped;
+    free(data);
+}
+
+/*!
+ * \brief Stores parsed CMC into a snapshot file.
+ *
+ * \param[in] path    Mandatory. Snapshot file.
+ * \param[in] ia_cmc  Mandatory. Parsed CMC.
+ * \param[in] key     Mandatory. Key of the CMC, see ia_cmc_snapshot_key.
+ * \return            Error code.
+ */
+static inline ia_err
+ia_cmc_snapshot_save(const char *path,
+                     const ia_cmc_t *ia_cmc,
+                     uint64_t key)
+{
+    ia_binary_data image;
+    ia_err err;
+
+    if (path == NULL)
+        return ia_err_argument;
+    err = ia_cmc_serialize(ia_cmc, key, &image);
+    if (err != ia_err_none)
+        return err;
+    err = ia_cmc_snapshot_write_file(path, image.data, image.size);
+    free(image.data);
+    return err;
+}
+
+/*!
+ * \brief Loaded snapshot.
+ */
+typedef struct
+{
+    void *data;         /*!< Image. */
+    size_t size;        /*!< Size of the image. */
+    bool mapped;        /*!< Image is memory mapped. Otherwise it has been read into allocated memory. */
+    ia_cmc_t *ia_cmc;   /*!< CMC inside the image. */
+} ia_cmc_snapshot;
+
+/*!
+ * \brief Closes a snapshot. CMC of the snapshot must not be used after this call.
+ */
+static inline void
+ia_cmc_snapshot_close(ia_cmc_snapshot *snapshot)
+{
+    if (snapshot == NULL)
+        return;
+    ia_cmc_snapshot_unmap_file(snapshot->data, snapshot->size, snapshot->mapped);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+/*!
+ * \brief Loads a snapshot file. File is mapped copy-on-write into memory where supported.
+ *
+ * \param[out] snapshot  Mandatory. Snapshot.
+ * \param[in]  path      Mandatory. Snapshot file.
+ * \param[in]  key       Mandatory. Expected key, see ia_cmc_snapshot_key.
+ * \return               Error code. ia_err_data, if the file is not a valid snapshot with the given key.
+ */
+static inline ia_err
+ia_cmc_snapshot_load(ia_cmc_snapshot *snapshot,
+                     const char *path,
+                     uint64_t key)
+{
+    ia_err err;
+
+    if (snapshot == NULL || path == NULL)
+        return ia_err_argument;
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    err = ia_cmc_snapshot_map_file(path, &snapshot->data, &snapshot->size, &snapshot->mapped);
+    if (err != ia_err_none)
+        return err;
+    snapshot->ia_cmc = ia_cmc_deserialize(snapshot->data, snapshot->size, key);
+    if (snapshot->ia_cmc == NULL) {
+        ia_cmc_snapshot_close(snapshot);
+        return ia_err_data;
+    }
+    return ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_CMC_SNAPSHOT_H_ */
@@ -0,0 +1,519 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_exc_lut.h
+ * \brief Batch and lookup table versions of exposure parameter conversions (see ia_exc.h).
+ *
+ * Batch functions convert arrays of exposure times and gains with one call.
+ *
+ * ia_exc_gain_lut is a gain conversion compiled from CMC analog or digital gain conversion: a dense table of gains
+ * indexed by code and a table of gain thresholds in which the code for a gain is found with bucketed binary search.
+ * The tables are built by calling the ia_exc conversion functions, so results of the lookup table are identical to
+ * results of ia_exc_analog_gain_to_sensor_units_v2 / ia_exc_digital_gain_to_sensor_units and their inverse functions.
+ * Threshold of each code is located by bisecting the conversion between the gains of adjacent codes, so compiling takes
+ * about a millisecond for conversions with thousands of codes. Compile once after CMC is parsed.
+ */
+
+#ifndef _IA_EXC_LUT_H_
+#define _IA_EXC_LUT_H_
+
+#include "ia_exc.h"
+#include "ia_abstraction.h"
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Converts exposure times from generic units to sensor units.
+ * \param[in]  exposure_range          Optional. See ia_exc_exposure_time_to_sensor_units.
+ * \param[in]  sensor_descriptor       Mandatory. See ia_exc_exposure_time_to_sensor_units.
+ * \param[in]  exposure_times_us       Mandatory. Exposure times to convert.
+ * \param[in]  count                   Mandatory. Number of exposure times.
+ * \param[out] coarse_integration_time Mandatory. Coarse integration times. Array of count values.
+ * \param[out] fine_integration_time   Mandatory. Fine integration times. Array of count values.
+ * \return                             Error code of the first failed conversion.
+ */
+static inline ia_err
+ia_exc_exposure_times_to_sensor_units(const cmc_exposure_range_t *exposure_range,
+                                      const ia_aiq_exposure_sensor_descriptor *sensor_descriptor,
+                                      const unsigned int *exposure_times_us,
+                                      unsigned int count,
+                                      unsigned short *coarse_integration_time,
+                                      unsigned short *fine_integration_time)
+{
+    ia_err err = ia_err_none;
+    unsigned int i;
+
+    if (exposure_times_us == NULL || coarse_integration_time == NULL || fine_integration_time == NULL)
+        return ia_err_argument;
+    for (i = 0; i < count; i++) {
+        ia_err ret = ia_exc_exposure_time_to_sensor_units(exposure_range, sensor_descriptor, exposure_times_us[i],
+                                                          &coarse_integration_time[i], &fine_integration_time[i]);
+        if (err == ia_err_none)
+            err = ret;
+    }
+    return err;
+}
+
+/*!
+ * \brief Converts exposure times from sensor units to generic units.
+ * \param[in]  sensor_descriptor       Mandatory. See ia_exc_sensor_units_to_exposure_time.
+ * \param[in]  coarse_integration_time Mandatory. Coarse integration times.
+ * \param[in]  fine_integration_time   Mandatory. Fine integration times.
+ * \param[in]  count                   Mandatory. Number of exposure times.
+ * \param[out] exposure_times_us       Mandatory. Exposure times in microseconds. Array of count values.
+ * \return                             Error code of the first failed conversion.
+ */
+static inline ia_err
+ia_exc_sensor_units_to_exposure_times(const ia_aiq_exposure_sensor_descriptor *sensor_descriptor,
+                                      const unsigned short *coarse_integration_time,
+                                      const unsigned short *fine_integration_time,
+                                      unsigned int count,
+                                      unsigned int *exposure_times_us)
+{
+    ia_err err = ia_err_none;
+    unsigned int i;
+
+    if (coarse_integration_time == NULL || fine_integration_time == NULL || exposure_times_us == NULL)
+        return ia_err_argument;
+    for (i = 0; i < count; i++) {
+        ia_err ret = ia_exc_sensor_units_to_exposure_time(sensor_descriptor, coarse_integration_time[i],
+                                                          fine_integration_time[i], &exposure_times_us[i]);
+        if (err == ia_err_none)
+            err = ret;
+    }
+    return err;
+}
+
+/*!
+ * \brief Converts analog gains from generic units to sensor units.
+ * \param[in]  gain_conversion   Mandatory. Analog gain conversion.
+ * \param[in]  analog_gains      Mandatory. Analog gains to convert.
+ * \param[in]  count             Mandatory. Number of gains.
+ * \param[out] analog_gain_codes Mandatory. Analog gain codes. Array of count values.
+ * \return                       Error code of the first failed conversion.
+ */
+static inline ia_err
+ia_exc_analog_gains_to_sensor_units_v2(const cmc_analog_gain_conversion2_t *gain_conversion,
+                                       const float *analog_gains,
+                                       unsigned int count,
+                                       unsigned short *analog_gain_codes)
+{
+    ia_err err = ia_err_none;
+    unsigned int i;
+
+    if (analog_gains == NULL || analog_gain_codes == NULL)
+        return ia_err_argument;
+    for (i = 0; i < count; i++) {
+        ia_err ret = ia_exc_analog_gain_to_sensor_units_v2(gain_conversion, analog_gains[i], &analog_gain_codes[i]);
+        if (err == ia_err_none)
+            err = ret;
+    }
+    return err;
+}
+
+/*!
+ * \brief Converts analog gains from sensor units to generic units.
+ * \param[in]  gain_conversion   Mandatory. Analog gain conversion.
+ * \param[in]  analog_gain_codes Mandatory. Analog gain codes to convert.
+ * \param[in]  count             Mandatory. Number of codes.
+ * \param[out] analog_gains      Mandatory. Analog gains. Array of count values.
+ * \return                       Error code of the first failed conversion.
+ */
+static inline ia_err
+ia_exc_sensor_units_to_analog_gains_v2(const cmc_analog_gain_conversion2_t *gain_conversion,
+                                       const unsigned short *analog_gain_codes,
+                                       unsigned int count,
+                                       float *analog_gains)
+{
+    ia_err err = ia_err_none;
+    unsigned int i;
+
+    if (analog_gain_codes == NULL || analog_gains == NULL)
+        return ia_err_argument;
+    for (i = 0; i < count; i++) {
+        ia_err ret = ia_exc_sensor_units_to_analog_gain_v2(gain_conversion, analog_gain_codes[i], &analog_gains[i]);
+        if (err == ia_err_none)
+            err = ret;
+    }
+    return err;
+}
+
+/*!
+ * \brief Converts digital gains from generic units to sensor units.
+ * \param[in]  gain_conversion    Mandatory. Digital gain conversion.
+ * \param[in]  digital_gains      Mandatory. Digital gains to convert.
+ * \param[in]  count              Mandatory. Number of gains.
+ * \param[out] digital_gain_codes Mandatory. Digital gain codes. Array of count values.
+ * \return                        Error code of the first failed conversion.
+ */
+static inline ia_err
+ia_exc_digital_gains_to_sensor_units(const cmc_parsed_digital_gain_t *gain_conversion,
+                                     const float *digital_gains,
+                                     unsigned int count,
+                                     unsigned short *digital_gain_codes)
+{
+    ia_err err = ia_err_none;
+    unsigned int i;
+
+    if (digital_gains == NULL || digital_gain_codes == NULL)
+        return ia_err_argument;
+    for (i = 0; i < count; i++) {
+        ia_err ret = ia_exc_digital_gain_to_sensor_units(gain_conversion, digital_gains[i], &digital_gain_codes[i]);
+        if (err == ia_err_none)
+            err = ret;
+    }
+    return err;
+}
+
+/*!
+ * \brief Converts digital gains from sensor units to generic units.
+ * \param[in]  gain_conversion    Mandatory. Digital gain conversion.
+ * \param[in]  digital_gain_codes Mandatory. Digital gain codes to convert.
+ * \param[in]  count              Mandatory. Number of codes.
+ * \param[out] digital_gains      Mandatory. Digital gains. Array of count values.
+ * \return                        Error code of the first failed conversion.
+ */
+static inline ia_err
+ia_exc_sensor_units_to_digital_gains(const cmc_parsed_digital_gain_t *gain_conversion,
+                                     const unsigned short *digital_gain_codes,
+                                     unsigned int count,
+                                     float *digital_gains)
+{
+    ia_err err = ia_err_none;
+    unsigned int i;
+
+    if (digital_gain_codes == NULL || digital_gains == NULL)
+        return ia_err_argument;
+    for (i = 0; i < count; i++) {
+        ia_err ret = ia_exc_sensor_units_to_digital_gain(gain_conversion, digital_gain_codes[i], &digital_gains[i]);
+        if (err == ia_err_none)
+            err = ret;
+    }
+    return err;
+}
+
+/*!
+ * \brief Compiled gain conversion.
+ */
+typedef struct
+{
+    unsigned short code_min;   /*!< Smallest code produced by the conversion. */
+    unsigned int num_codes;    /*!< Number of codes in range [code_min, code_min + num_codes - 1]. */
+    float *gains;              /*!< Gain of each code in the code range, indexed by code - code_min. */
+    unsigned int num_steps;    /*!< Number of codes produced by the conversion. */
+    unsigned short *step_codes; /*!< Codes produced by the conversion in ascending gain order. */
+    float *step_gains;         /*!< Smallest gain converted into each of step_codes. step_gains[0] is -FLT_MAX. */
+    float bucket_origin;       /*!< Gain of the beginning of the first bucket (step_gains[1]). */
+    float bucket_scale;        /*!< Number of buckets per unit of gain. */
+    unsigned int *buckets;     /*!< Last step below each of num_steps buckets of equal width. Search of a gain is limited
+                                    to steps between its bucket and the next bucket. */
+} ia_exc_gain_lut;
+
+typedef ia_err (*ia_exc_gain_to_code_func)(const void *gain_conversion, float gain, unsigned short *code);
+typedef ia_err (*ia_exc_code_to_gain_func)(const void *gain_conversion, unsigned short code, float *gain);
+
+static inline ia_err
+ia_exc_gain_lut_analog_to_code(const void *gain_conversion, float gain, unsigned short *code)
+{
+    return ia_exc_analog_gain_to_sensor_units_v2((const cmc_analog_gain_conversion2_t *)gain_conversion, gain, code);
+}
+
+static inline ia_err
+ia_exc_gain_lut_analog_to_gain(const void *gain_conversion, unsigned short code, float *gain)
+{
+    return ia_exc_sensor_units_to_analog_gain_v2((const cmc_analog_gain_conversion2_t *)gain_conversion, code, gain);
+}
+
+static inline ia_err
+ia_exc_gain_lut_digital_to_code(const void *gain_conversion, float gain, unsigned short *code)
+{
+    return ia_exc_digital_gain_to_sensor_units((const cmc_parsed_digital_gain_t *)gain_conversion, gain, code);
+}
+
+static inline ia_err
+ia_exc_gain_lut_digital_to_gain(const void *gain_conversion, unsigned short code, float *gain)
+{
+    return ia_exc_sensor_units_to_digital_gain((const cmc_parsed_digital_gain_t *)gain_conversion, code, gain);
+}
+
+/*!
+ * \brief Frees tables of compiled gain conversion.
+ * \param[in] lut Mandatory. Compiled gain conversion.
+ */
+static inline void
+ia_exc_gain_lut_free(ia_exc_gain_lut *lut)
+{
+    if (lut == NULL)
+        return;
+    IA_FREEZ(lut->gains);
+    IA_FREEZ(lut->step_codes);
+    IA_FREEZ(lut->step_gains);
+    IA_FREEZ(lut->buckets);
+    lut->num_codes = 0;
+    lut->num_steps = 0;
+}
+
+/*!
+ * \brief Orders positive and negative floats like their values when compared as unsigned integers.
+ */
+static inline unsigned int
+ia_exc_gain_lut_float_key(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+static inline float
+ia_exc_gain_lut_key_float(unsigned int key)
+{
+    unsigned int bits = (key & 0x80000000u) ? key & 0x7FFFFFFFu : ~key;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/*!
+ * \brief Index of the bucket of a gain at or above bucket_origin.
+ */
+static inline unsigned int
+ia_exc_gain_lut_bucket(const ia_exc_gain_lut *lut, float gain)
+{
+    float position = (gain - lut->bucket_origin) * lut->bucket_scale;
+    return position < (float)lut->num_steps ? (unsigned int)position : lut->num_steps;
+}
+
+/*!
+ * \brief Compiles gain conversion given as a pair of conversion functions.
+ * Code range is the range of codes of the smallest and largest gains. Codes which are converted back to themselves
+ * through their gain are steps of the conversion. The conversion must be monotonic in gain.
+ */
+static inline ia_err
+ia_exc_gain_lut_compile(ia_exc_gain_lut *lut,
+                        const void *gain_conversion,
+                        ia_exc_gain_to_code_func to_code,
+                        ia_exc_code_to_gain_func to_gain)
+{
+    unsigned short code_lo, code_hi, code;
+    unsigned int i, j;
+    ia_err err;
+
+    if (lut == NULL || gain_conversion == NULL)
+        return ia_err_argument;
+    memset(lut, 0, sizeof(*lut));
+
+    err = to_code(gain_conversion, -FLT_MAX, &code_lo);
+    if (err == ia_err_none)
+        err = to_code(gain_conversion, FLT_MAX, &code_hi);
+    if (err != ia_err_none)
+        return err;
+    if (code_lo > code_hi) {
+        code = code_lo;
+        code_lo = code_hi;
+        code_hi = code;
+    }
+
+    lut->code_min = code_lo;
+    lut->num_codes = (unsigned int)code_hi - code_lo + 1;
+    lut->gains = (float *)IA_ALLOC(lut->num_codes * sizeof(float));
+    lut->step_codes = (unsigned short *)IA_ALLOC(lut->num_codes * sizeof(unsigned short));
+    lut->step_gains = (float *)IA_ALLOC(lut->num_codes * sizeof(float));
+    if (lut->gains == NULL || lut->step_codes == NULL || lut->step_gains == NULL) {
+        ia_exc_gain_lut_free(lut);
+        return ia_err_nomemory;
+    }
+
+    /* Gains of all codes and the codes which the conversion produces. Steps are insertion sorted by gain. */
+    for (i = 0; i < lut->num_codes; i++) {
+        float gain;
+        code = (unsigned short)(code_lo + i);
+        err = to_gain(gain_conversion, code, &gain);
+        if (err == ia_err_none)
+            err = to_code(gain_conversion, gain, &code);
+        if (err != ia_err_none) {
+            ia_exc_gain_lut_free(lut);
+            return err;
+        }
+        lut->gains[i] = gain;
+        if (code != code_lo + i)
+            continue;
+        for (j = lut->num_steps; j > 0 && lut->step_gains[j - 1] > gain; j--) {
+            lut->step_codes[j] = lut->step_codes[j - 1];
+            lut->step_gains[j] = lut->step_gains[j - 1];
+        }
+        lut->step_codes[j] = code;
+        lut->step_gains[j] = gain;
+        lut->num_steps++;
+    }
+    if (lut->num_steps == 0) {
+        ia_exc_gain_lut_free(lut);
+        return ia_err_data;
+    }
+
+    /* Replace gain of each step with the smallest gain converted into the step code. */
+    for (i = 1; i < lut->num_steps; i++) {
+        unsigned int lo = ia_exc_gain_lut_float_key(lut->step_gains[i - 1]);
+        unsigned int hi = ia_exc_gain_lut_float_key(lut->step_gains[i]);
+        while (hi - lo > 1) {
+            unsigned int mid = lo + (hi - lo) / 2;
+            err = to_code(gain_conversion, ia_exc_gain_lut_key_float(mid), &code);
+            if (err != ia_err_none) {
+                ia_exc_gain_lut_free(lut);
+                return err;
+            }
+            if (code == lut->step_codes[i - 1])
+                lo = mid;
+            else
+                hi = mid;
+        }
+        lut->step_gains[i] = ia_exc_gain_lut_key_float(hi);
+    }
+    lut->step_gains[0] = -FLT_MAX;
+
+    lut->buckets = (unsigned int *)IA_ALLOC((lut->num_steps + 1) * sizeof(unsigned int));
+    if (lut->buckets == NULL) {
+        ia_exc_gain_lut_free(lut);
+        return ia_err_nomemory;
+    }
+    lut->bucket_origin = lut->num_steps > 1 ? lut->step_gains[1] : 0.0f;
+    lut->bucket_scale = lut->num_steps > 1 ?
+        (float)(lut->num_steps - 1) / (lut->step_gains[lut->num_steps - 1] - lut->bucket_origin) : 0.0f;
+    /* Bucket k starts after all steps whose gain falls into buckets before k. */
+    for (i = 0, j = 0; j <= lut->num_steps; j++) {
+        while (i + 1 < lut->num_steps && ia_exc_gain_lut_bucket(lut, lut->step_gains[i + 1]) < j)
+            i++;
+        lut->buckets[j] = i;
+    }
+    return ia_err_none;
+}
+
+/*!
+ * \brief Compiles analog gain conversion.
+ * \param[out] lut             Mandatory. Compiled gain conversion. Free with ia_exc_gain_lut_free.
+ * \param[in]  gain_conversion Mandatory. Analog gain conversion (from ia_cmc_t cmc_analog_gain_conversions).
+ * \return                     Error code.
+ */
+static inline ia_err
+ia_exc_gain_lut_compile_analog(ia_exc_gain_lut *lut, const cmc_analog_gain_conversion2_t *gain_conversion)
+{
+    return ia_exc_gain_lut_compile(lut, gain_conversion, ia_exc_gain_lut_analog_to_code, ia_exc_gain_lut_analog_to_gain);
+}
+
+/*!
+ * \brief Compiles digital gain conversion.
+ * \param[out] lut             Mandatory. Compiled gain conversion. Free with ia_exc_gain_lut_free.
+ * \param[in]  gain_conversion Mandatory. Digital gain conversion (ia_cmc_t cmc_parsed_digital_gain).
+ * \return                     Error code.
+ */
+static inline ia_err
+ia_exc_gain_lut_compile_digital(ia_exc_gain_lut *lut, const cmc_parsed_digital_gain_t *gain_conversion)
+{
+    return ia_exc_gain_lut_compile(lut, gain_conversion, ia_exc_gain_lut_digital_to_code, ia_exc_gain_lut_digital_to_gain);
+}
+
+/*!
+ * \brief Converts gain to code. Takes constant time for evenly spaced gain steps and logarithmic time at worst.
+ * \param[in]  lut  Mandatory. Compiled gain conversion.
+ * \param[in]  gain Mandatory. Gain to convert.
+ * \return          Gain code.
+ */
+static inline unsigned short
+ia_exc_gain_lut_to_code(const ia_exc_gain_lut *lut, float gain)
+{
+    const float *base;
+    unsigned int bucket, n;
+
+    if (!(gain >= lut->bucket_origin) || lut->num_steps == 1)
+        return lut->step_codes[0];
+
+    /* Last step whose smallest gain is not above the gain, searched between the steps of the bucket and the next
+     * bucket. The loop has no data dependent branches, so it doesn't suffer from branch mispredictions. */
+    bucket = ia_exc_gain_lut_bucket(lut, gain);
+    base = lut->step_gains + lut->buckets[bucket];
+    n = (bucket < lut->num_steps ? lut->buckets[bucket + 1] : lut->num_steps - 1) - lut->buckets[bucket] + 1;
+    while (n > 1) {
+        unsigned int half = n / 2;
+        base = base[half] <= gain ? base + half : base;
+        n -= half;
+    }
+    return lut->step_codes[base - lut->step_gains];
+}
+
+/*!
+ * \brief Converts code to gain.
+ * \param[in]  lut  Mandatory. Compiled gain conversion.
+ * \param[in]  code Mandatory. Gain code.
+ * \param[out] gain Mandatory. Gain of the code.
+ * \return          Error code. ia_err_argument if code is outside code range of the conversion.
+ */
+static inline ia_err
+ia_exc_gain_lut_to_gain(const ia_exc_gain_lut *lut, unsigned short code, float *gain)
+{
+    unsigned int index = (unsigned int)code - lut->code_min;
+
+    if (code < lut->code_min || index >= lut->num_codes)
+        return ia_err_argument;
+    *gain = lut->gains[index];
+    return ia_err_none;
+}
+
+/*!
+ * \brief Converts gains to codes with compiled gain conversion.
+ * \param[in]  lut   Mandatory. Compiled gain conversion.
+ * \param[in]  gains Mandatory. Gains to convert.
+ * \param[in]  count Mandatory. Number of gains.
+ * \param[out] codes Mandatory. Gain codes. Array of count values.
+ */
+static inline void
+ia_exc_gain_lut_to_codes(const ia_exc_gain_lut *lut, const float *gains, unsigned int count, unsigned short *codes)
+{
+    unsigned int i;
+    for (i = 0; i < count; i++)
+        codes[i] = ia_exc_gain_lut_to_code(lut, gains[i]);
+}
+
+/*!
+ * \brief Converts codes to gains with compiled gain conversion.
+ * \param[in]  lut   Mandatory. Compiled gain conversion.
+ * \param[in]  codes Mandatory. Gain codes to convert.
+ * \param[in]  count Mandatory. Number of codes.
+ * \param[out] gains Mandatory. Gains. Array of count values.
+ * \return           Error code. ia_err_argument if any of the codes is outside code range of the conversion.
+ */
+static inline ia_err
+ia_exc_gain_lut_to_gains(const ia_exc_gain_lut *lut, const unsigned short *codes, unsigned int count, float *gains)
+{
+    ia_err err = ia_err_none;
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        if (ia_exc_gain_lut_to_gain(lut, codes[i], &gains[i]) != ia_err_none)
+            err = ia_err_argument;
+    }
+    return err;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_EXC_LUT_H_ */
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_isp_bxt_changes.h
+ * \brief Report of kernels whose PAL parameters changed since the previous run.
+ *
+ * AIC keeps state in the output buffer and skips recomputation of some kernels (see run rate control in ia_isp_bxt.h),
+ * but ia_isp_bxt_run doesn't tell which kernel records changed. ia_isp_bxt_changes keeps a copy of the kernel records
+ * of the previous run on one output buffer and compares the new records against it. Clients which encode PAL output
+ * per kernel (P2P, process group wrappers, PSYS) can skip the kernels which are not reported as changed.
+ *
+ * Records are compared byte by byte, so the report is exact. Call info and debug info records are not reported, because
+ * their timestamp and run counter change every frame. If the record layout changes (e.g. program group changes), all
+ * kernels are reported as changed.
+ *
+ * Use one ia_isp_bxt_changes per output buffer (per program group):
+ * \code
+ * ia_isp_bxt_changes changes = { 0 };
+ * ...
+ * ia_isp_bxt_run_and_get_changes(isp, &input_params, &output, &changes);
+ * ia_isp_bxt_get_changed_kernels(&changes, &uuids, &num_uuids);
+ * ...
+ * ia_isp_bxt_changes_free(&changes);
+ * \endcode
+ */
+
+#ifndef _IA_ISP_BXT_CHANGES_H_
+#define _IA_ISP_BXT_CHANGES_H_
+
+#include "ia_isp_bxt.h"
+#include "ia_isp_bxt_parallel.h"
+#include "ia_abstraction.h"
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Kernel records of the previous run and kernels changed in the latest run.
+ * Zero initialize before the first update.
+ */
+typedef struct
+{
+    uint8_t *previous;                  /*!< Kernel records of the previous run. */
+    unsigned int previous_size;         /*!< Size of the kernel records of the previous run. 0 before the first run. */
+    unsigned int previous_capacity;     /*!< Size of the previous records buffer. */
+    uint32_t *changed_uuids;            /*!< UUIDs (ia_pal_uuid) of the kernels changed in the latest run, in output order. */
+    unsigned int num_changed;           /*!< Number of changed kernels. */
+    unsigned int changed_capacity;      /*!< Size of the changed UUID array. */
+} ia_isp_bxt_changes;
+
+/*!
+ * \brief Frees buffers of the change report.
+ */
+static inline void
+ia_isp_bxt_changes_free(ia_isp_bxt_changes *changes)
+{
+    if (changes == NULL)
+        return;
+    IA_FREEZ(changes->previous);
+    IA_FREEZ(changes->changed_uuids);
+    memset(changes, 0, sizeof(*changes));
+}
+
+/*!
+ * \brief Forgets the previous run, so all kernels of the next update are reported as changed.
+ * Needed e.g. when the client has lost the previously encoded payloads.
+ */
+static inline void
+ia_isp_bxt_changes_reset(ia_isp_bxt_changes *changes)
+{
+    if (changes == NULL)
+        return;
+    changes->previous_size = 0;
+    changes->num_changed = 0;
+}
+
+/*!
+ * \brief Compares PAL output of the latest run against the previous run.
+ *
+ * \param[in,out] changes     Mandatory. Change report of the output buffer.
+ * \param[in]     output_data Mandatory. PAL output of the latest run.
+ * \return                    Error code. ia_err_data if PAL output is corrupted.
+ */
+static inline ia_err
+ia_isp_bxt_changes_update(ia_isp_bxt_changes *changes, const ia_binary_data *output_data)
+{
+    const uint8_t *data;
+    unsigned int offset = 0, kernels_offset = 0, num_records = 0, kernels_size, previous_offset;
+    bool same_layout;
+
+    if (changes == NULL || output_data == NULL || (output_data->data == NULL && output_data->size > 0))
+        return ia_err_argument;
+    data = (const uint8_t *)output_data->data;
+
+    /* Validate the records and count the kernel records. */
+    while (offset + sizeof(ia_isp_bxt_pal_record_header) <= output_data->size) {
+        ia_isp_bxt_pal_record_header header;
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.size < sizeof(header) || header.size > output_data->size - offset)
+            return ia_err_data;
+        if (header.uuid == ia_pal_uuid_isp_call_info && offset == kernels_offset)
+            kernels_offset += header.size;
+        else if (header.uuid != ia_pal_uuid_isp_debug_info)
+            num_records++;
+        offset += header.size;
+    }
+    kernels_size = offset - kernels_offset;
+
+    if (num_records > changes->changed_capacity) {
+        IA_FREEZ(changes->changed_uuids);
+        changes->changed_capacity = 0;
+        changes->changed_uuids = (uint32_t *)IA_ALLOC(num_records * sizeof(uint32_t));
+        if (changes->changed_uuids == NULL) {
+            ia_isp_bxt_changes_reset(changes);
+            return ia_err_nomemory;
+        }
+        changes->changed_capacity = num_records;
+    }
+    if (kernels_size > changes->previous_capacity) {
+        IA_FREEZ(changes->previous);
+        changes->previous_size = 0;
+        changes->previous_capacity = 0;
+        changes->previous = (uint8_t *)IA_ALLOC(kernels_size);
+        if (changes->previous == NULL) {
+            ia_isp_bxt_changes_reset(changes);
+            return ia_err_nomemory;
+        }
+        changes->previous_capacity = kernels_size;
+    }
+
+    /* Records are compared in place while the layout is the same as in the previous run. */
+    same_layout = changes->previous_size == kernels_size;
+    changes->num_changed = 0;
+    for (offset = kernels_offset, previous_offset = 0; offset < kernels_offset + kernels_size; ) {
+        ia_isp_bxt_pal_record_header header;
+        memcpy(&header, data + offset, sizeof(header));
+        if (same_layout && IA_MEMCOMPARE(changes->previous + previous_offset, &header, sizeof(header)) != 0)
+            same_layout = false;
+        if (header.uuid == ia_pal_uuid_isp_debug_info) {
+            /* Kept for the layout comparison, but not reported. */
+            memcpy(changes->previous + previous_offset, data + offset, header.size);
+        } else if (!same_layout || IA_MEMCOMPARE(changes->previous + previous_offset, data + offset, header.size) != 0) {
+            changes->changed_uuids[changes->num_changed++] = header.uuid;
+            memcpy(changes->previous + previous_offset, data + offset, header.size);
+        }
+        offset += header.size;
+        previous_offset += header.size;
+    }
+    changes->previous_size = kernels_size;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Gets UUIDs of the kernels whose PAL parameters changed in the latest run.
+ *
+ * \param[in]  changes   Mandatory. Change report of the output buffer.
+ * \param[out] uuids     Mandatory. Pointer to the UUIDs (ia_pal_uuid) in output order. Valid until the next update.
+ * \param[out] num_uuids Mandatory. Number of changed kernels.
+ * \return               Error code.
+ */
+static inline ia_err
+ia_isp_bxt_get_changed_kernels(const ia_isp_bxt_changes *changes,
+                               const uint32_t **uuids,
+                               unsigned int *num_uuids)
+{
+    if (changes == NULL || uuids == NULL || num_uuids == NULL)
+        return ia_err_argument;
+    *uuids = changes->changed_uuids;
+    *num_uuids = changes->num_changed;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Checks whether PAL parameters of a kernel changed in the latest run.
+ * \return True if kernel record changed or if it is not in the output. False for debug info record.
+ */
+static inline bool
+ia_isp_bxt_changes_is_changed(const ia_isp_bxt_changes *changes, uint32_t uuid)
+{
+    const uint8_t *previous = changes->previous;
+    unsigned int i, offset;
+    ia_isp_bxt_pal_record_header header;
+
+    for (i = 0; i < changes->num_changed; i++) {
+        if (changes->changed_uuids[i] == uuid)
+            return true;
+    }
+    for (offset = 0; offset < changes->previous_size; offset += header.size) {
+        memcpy(&header, previous + offset, sizeof(header));
+        if (header.uuid == uuid)
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief ia_isp_bxt_run, which reports the kernels whose PAL parameters changed.
+ * Parameters are the same as in ia_isp_bxt_run. Kernels changed in this run are available with
+ * ia_isp_bxt_get_changed_kernels.
+ *
+ * \param[in,out] changes Mandatory. Change report of the output buffer.
+ * \return                Error code.
+ */
+static inline ia_err
+ia_isp_bxt_run_and_get_changes(ia_isp_bxt *ia_isp_bxt,
+                               const ia_isp_bxt_input_params *input_params,
+                               ia_binary_data *output_data,
+                               ia_isp_bxt_changes *changes)
+{
+    ia_err err;
+
+    if (changes == NULL)
+        return ia_err_argument;
+    err = ia_isp_bxt_run(ia_isp_bxt, input_params, output_data);
+    if (err != ia_err_none) {
+        ia_isp_bxt_changes_reset(changes);
+        return err;
+    }
+    return ia_isp_bxt_changes_update(changes, output_data);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_ISP_BXT_CHANGES_H_ */
@@ -0,0 +1,754 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_isp_bxt_parallel.h
+ * \brief Computing PAL parameters of one program group concurrently.
+ *
+ * ia_isp_bxt_run computes PAL parameters of the kernels of a program group one after another. PAL output is a
+ * sequence of records: call info record followed by one record per kernel in program group order. Each record starts
+ * with ia_isp_bxt_pal_record_header.
+ *
+ * ia_isp_bxt_parallel splits the kernel list into contiguous parts, runs each part with ia_isp_bxt_run on its own
+ * ia_isp_bxt instance (worker) in parallel (see ia_task.h), and concatenates the kernel records of the parts.
+ *
+ * PAL parameters of most kernels depend only on the input parameters and the tunings, but some kernels look at other
+ * kernels of the program group (e.g. applycorrection depends on which correction kernels are in the program group).
+ * Therefore the split is calibrated: the parts are run on fresh ISP instances and their output is compared with
+ * ia_isp_bxt_run output of the whole program group on another fresh instance. A part which contains the kernel of the
+ * first differing record (looked up by record UUID) is merged with its neighbour until the outputs are equal. Fresh
+ * instances are used, because some kernels keep state from earlier frames (e.g. temporal noise reduction), so an
+ * instance that hasn't run every frame doesn't give a valid reference, and the extra runs would disturb the state of
+ * the workers. Output is the same binary as ia_isp_bxt_run output for the whole program group, except for padding bytes
+ * of the records, which PAL doesn't write, and the run count in the debug info record, which counts the runs of the
+ * worker instance.
+ *
+ * A split is calibrated for one kernel list, kernel enable controls, operation mode, stream id, media format, custom
+ * controls and PAL override. PAL override is the run-time way to change tunings, including the run rate tuning record,
+ * so a tuning or run rate change needs another split. Up to IA_ISP_BXT_PARALLEL_MAX_SPLITS splits are kept, the least
+ * recently used one is replaced, so switching between program groups (e.g. preview and still) doesn't calibrate again.
+ *
+ * Calibration costs a few runs of the whole program group and ISP instance creations, which is much more than one
+ * ia_isp_bxt_run, so it is not done by ia_isp_bxt_parallel_run. A frame which has no calibrated split is computed with
+ * ia_isp_bxt_run on the first worker. Client calibrates the split with ia_isp_bxt_parallel_prepare outside of the
+ * latency critical part, e.g. after PAL output of the frame has been passed on, with the same input parameters.
+ *
+ * Equality of the outputs is verified only on the frames where it is computed: the calibration frame and, if
+ * ia_isp_bxt_parallel_set_verify_interval is used, the frames of ia_isp_bxt_parallel_prepare calls after every Nth run
+ * of the split. If other input parameters make kernels depend on each other differently, a mismatch is found only by
+ * the periodic verification, which then merges the parts further. A kernel which is computed by another worker than
+ * on the previous frame (another split, or ia_isp_bxt_run on the first worker) doesn't have the state it had in its
+ * previous worker.
+ *
+ * Each worker keeps its own output buffer, so run rate control of the AIC (see ia_isp_bxt.h) works per worker. Kernels
+ * are split the same way as long as the same split is used, so each kernel is computed by the same worker.
+ *
+ * Each worker is a full ia_isp_bxt instance with its own PAL output buffer, so memory use grows linearly with the
+ * number of workers. Calibration and verification create (and delete) one instance per part and one for the reference,
+ * which costs an ia_isp_bxt_init each. Speedup depends on the number of CPU cores available to the workers; on a single
+ * core the split only adds overhead. Measure on the target before choosing the number of workers.
+ */
+
+#ifndef _IA_ISP_BXT_PARALLEL_H_
+#define _IA_ISP_BXT_PARALLEL_H_
+
+#include "ia_isp_bxt.h"
+#include "ia_pal_types_isp_ids_autogen.h"
+#include "ia_task.h"
+#include "ia_abstraction.h"
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Header of a record in PAL output.
+ */
+typedef struct
+{
+    uint32_t uuid;    /*!< ia_pal_uuid of the record. */
+    uint32_t size;    /*!< Size of the record including the header. */
+} ia_isp_bxt_pal_record_header;
+
+/*!
+ * \brief Maximum number of workers.
+ */
+#define IA_ISP_BXT_PARALLEL_MAX_WORKERS IA_TASK_MAX_DEFAULT_THREADS
+
+/*!
+ * \brief Maximum number of calibrated splits kept by the handle.
+ */
+#define IA_ISP_BXT_PARALLEL_MAX_SPLITS 4
+
+/*!
+ * \brief Calibrated split of one program group.
+ */
+typedef struct
+{
+    uint32_t *kernel_uuids;                                      /*!< Kernel UUIDs of the program group. */
+    int32_t *kernel_enables;                                     /*!< Kernel enable controls of the program group. */
+    unsigned int kernel_count;                                   /*!< Number of kernels in the program group. 0 if not calibrated. */
+    unsigned int kernel_capacity;                                /*!< Size of the kernel arrays. */
+    unsigned int part_first[IA_ISP_BXT_PARALLEL_MAX_WORKERS + 1]; /*!< Index of the first kernel of each part, followed by kernel_count. */
+    unsigned int num_parts;                                      /*!< Number of parts. */
+    uint64_t settings_key;                                       /*!< Hash of the tuning related input parameters. */
+    uint64_t last_run;                                           /*!< Run counter of the handle when the split was last used. */
+    unsigned int runs_since_verify;                              /*!< Number of runs since calibration or the last verification. */
+} ia_isp_bxt_parallel_split;
+
+/*!
+ * \brief Parallel ISP of one camera.
+ */
+typedef struct
+{
+    ia_isp_bxt *workers[IA_ISP_BXT_PARALLEL_MAX_WORKERS];        /*!< ISP instance per worker. */
+    unsigned int num_workers;                                    /*!< Number of workers. */
+    ia_binary_data outputs[IA_ISP_BXT_PARALLEL_MAX_WORKERS];     /*!< PAL output buffer per worker. */
+    unsigned int capacities[IA_ISP_BXT_PARALLEL_MAX_WORKERS];    /*!< Sizes of the PAL output buffers. */
+    ia_binary_data output;                                       /*!< Combined PAL output, if client doesn't give output buffer. */
+    unsigned int output_capacity;                                /*!< Size of the combined PAL output buffer. */
+    ia_binary_data aiqb_data;                                    /*!< AIQB data for creating calibration instances. */
+    const ia_cmc_t *ia_cmc;                                      /*!< CMC for creating calibration instances. */
+    unsigned int max_stats_width;                                /*!< Maximum width of statistics grids. */
+    unsigned int max_stats_height;                               /*!< Maximum height of statistics grids. */
+    unsigned int max_num_stats_in;                               /*!< Maximum number of input statistics for one frame. */
+    ia_isp_bxt_parallel_split splits[IA_ISP_BXT_PARALLEL_MAX_SPLITS]; /*!< Calibrated splits. */
+    uint64_t run_count;                                          /*!< Number of parallel runs. */
+    unsigned int verify_interval;                                /*!< Number of runs between verifications of a split. 0 if not verified. */
+} ia_isp_bxt_parallel;
+
+/*!
+ * \brief Deletes worker instances and the handle.
+ */
+static inline void
+ia_isp_bxt_parallel_deinit(ia_isp_bxt_parallel *parallel)
+{
+    unsigned int i;
+
+    if (parallel == NULL)
+        return;
+    for (i = 0; i < parallel->num_workers; i++) {
+        if (parallel->workers[i] != NULL)
+            ia_isp_bxt_deinit(parallel->workers[i]);
+        IA_FREEZ(parallel->outputs[i].data);
+    }
+    IA_FREEZ(parallel->output.data);
+    for (i = 0; i < IA_ISP_BXT_PARALLEL_MAX_SPLITS; i++) {
+        IA_FREEZ(parallel->splits[i].kernel_uuids);
+        IA_FREEZ(parallel->splits[i].kernel_enables);
+    }
+    IA_FREEZ(parallel);
+}
+
+/*!
+ * \brief Creates ISP instances for each worker.
+ * Parameters are the same as in ia_isp_bxt_init.
+ *
+ * \param[in] aiqb_data         Mandatory. AIQB data. Must outlive the handle, because calibration creates ISP instances.
+ * \param[in] ia_cmc            Mandatory. Parsed camera module characterization structure. Must outlive the handle.
+ * \param[in] max_stats_width   Mandatory. Maximum width of statistics grids.
+ * \param[in] max_stats_height  Mandatory. Maximum height of statistics grids.
+ * \param[in] max_num_stats_in  Mandatory. Maximum number of input statistics for one frame.
+ * \param[in] ia_mkns           Optional. Makernote handle of each worker (see ia_mkn_local.h). NULL if not used.
+ * \param[in] num_workers       Mandatory. Number of workers [1, IA_ISP_BXT_PARALLEL_MAX_WORKERS].
+ * \return                      Handle or NULL in case of an error.
+ */
+static inline ia_isp_bxt_parallel *
+ia_isp_bxt_parallel_init(const ia_binary_data *aiqb_data,
+                         const ia_cmc_t *ia_cmc,
+                         unsigned int max_stats_width,
+                         unsigned int max_stats_height,
+                         unsigned int max_num_stats_in,
+                         ia_mkn *const *ia_mkns,
+                         unsigned int num_workers)
+{
+    ia_isp_bxt_parallel *parallel;
+    unsigned int i;
+
+    if (aiqb_data == NULL || ia_cmc == NULL || num_workers == 0 || num_workers > IA_ISP_BXT_PARALLEL_MAX_WORKERS)
+        return NULL;
+    parallel = (ia_isp_bxt_parallel *)IA_CALLOC(sizeof(ia_isp_bxt_parallel));
+    if (parallel == NULL)
+        return NULL;
+    parallel->aiqb_data = *aiqb_data;
+    parallel->ia_cmc = ia_cmc;
+    parallel->max_stats_width = max_stats_width;
+    parallel->max_stats_height = max_stats_height;
+    parallel->max_num_stats_in = max_num_stats_in;
+    for (i = 0; i < num_workers; i++) {
+        parallel->num_workers = i + 1;
+        parallel->workers[i] = ia_isp_bxt_init(aiqb_data, ia_cmc, max_stats_width, max_stats_height, max_num_stats_in,
+                                               ia_mkns != NULL ? ia_mkns[i] : NULL);
+        if (parallel->workers[i] == NULL) {
+            ia_isp_bxt_parallel_deinit(parallel);
+            return NULL;
+        }
+    }
+    return parallel;
+}
+
+/*!
+ * \brief Drops all calibrated splits, so that runs are serial until ia_isp_bxt_parallel_prepare is called again.
+ * Needed when kernels of the program group are changed in ways other than kernel list or enable controls,
+ * e.g. when resolution info of a kernel changes.
+ */
+static inline void
+ia_isp_bxt_parallel_invalidate(ia_isp_bxt_parallel *parallel)
+{
+    unsigned int i;
+
+    if (parallel == NULL)
+        return;
+    for (i = 0; i < IA_ISP_BXT_PARALLEL_MAX_SPLITS; i++)
+        parallel->splits[i].kernel_count = 0;
+}
+
+/*!
+ * \brief Sets how often calibrated splits are verified against the output of the reference instance.
+ * Verification is done by ia_isp_bxt_parallel_prepare when the split has been run at least the given number of times
+ * since calibration or the last verification. It runs the whole program group and the parts of the split on fresh
+ * instances (see ia_isp_bxt_parallel_merge). If the outputs differ, parts are merged.
+ *
+ * \param[in,out] parallel  Mandatory. Parallel ISP handle.
+ * \param[in]     interval  Number of runs between verifications. 0 disables verification (default).
+ */
+static inline void
+ia_isp_bxt_parallel_set_verify_interval(ia_isp_bxt_parallel *parallel, unsigned int interval)
+{
+    unsigned int i;
+
+    if (parallel == NULL)
+        return;
+    parallel->verify_interval = interval;
+    for (i = 0; i < IA_ISP_BXT_PARALLEL_MAX_SPLITS; i++)
+        parallel->splits[i].runs_since_verify = 0;
+}
+
+/*!
+ * \brief Adds data to 64 bit FNV-1a hash.
+ */
+static inline uint64_t
+ia_isp_bxt_parallel_hash(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*!
+ * \brief Calculates hash of the input parameters which select or change the tunings of the kernels.
+ */
+static inline uint64_t
+ia_isp_bxt_parallel_settings_key(const ia_isp_bxt_input_params *input_params)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    hash = ia_isp_bxt_parallel_hash(hash, &input_params->program_group->operation_mode,
+                                    sizeof(input_params->program_group->operation_mode));
+    hash = ia_isp_bxt_parallel_hash(hash, &input_params->stream_id, sizeof(input_params->stream_id));
+    hash = ia_isp_bxt_parallel_hash(hash, &input_params->media_format, sizeof(input_params->media_format));
+    if (input_params->custom_controls != NULL && input_params->custom_controls->parameters != NULL &&
+        input_params->custom_controls->count > 0)
+        hash = ia_isp_bxt_parallel_hash(hash, input_params->custom_controls->parameters,
+                                        (size_t)input_params->custom_controls->count * sizeof(float));
+    if (input_params->pal_override != NULL && input_params->pal_override->data != NULL)
+        hash = ia_isp_bxt_parallel_hash(hash, input_params->pal_override->data, input_params->pal_override->size);
+    return hash;
+}
+
+/*!
+ * \brief Makes sure that the buffer has at least the given size.
+ */
+static inline ia_err
+ia_isp_bxt_parallel_reserve(ia_binary_data *buffer, unsigned int *capacity, unsigned int size)
+{
+    if (size <= *capacity)
+        return ia_err_none;
+    IA_FREEZ(buffer->data);
+    *capacity = 0;
+    /* Zeroed, so that padding bytes of the records, which PAL doesn't write, are deterministic. */
+    buffer->data = IA_CALLOC(size);
+    if (buffer->data == NULL)
+        return ia_err_nomemory;
+    *capacity = size;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Work of one parallel run.
+ */
+typedef struct
+{
+    const ia_isp_bxt_parallel_split *split;
+    const ia_isp_bxt_input_params *input_params;
+    ia_isp_bxt *const *instances;
+    ia_binary_data *outputs;
+    unsigned int *capacities;
+    bool clear;
+    ia_err err[IA_ISP_BXT_PARALLEL_MAX_WORKERS];
+} ia_isp_bxt_parallel_work;
+
+static inline void
+ia_isp_bxt_parallel_run_worker(void *arg, unsigned int index)
+{
+    ia_isp_bxt_parallel_work *work = (ia_isp_bxt_parallel_work *)arg;
+    const ia_isp_bxt_parallel_split *split = work->split;
+    ia_isp_bxt_input_params input_params = *work->input_params;
+    ia_isp_bxt_program_group group;
+    ia_binary_data *output = &work->outputs[index];
+
+    group.kernel_count = split->part_first[index + 1] - split->part_first[index];
+    group.run_kernels = input_params.program_group->run_kernels + split->part_first[index];
+    group.operation_mode = input_params.program_group->operation_mode;
+    work->err[index] = ia_isp_bxt_parallel_reserve(output, &work->capacities[index],
+                                                   (unsigned int)ia_isp_bxt_get_output_size(&group));
+    if (work->err[index] != ia_err_none)
+        return;
+    /* Padding bytes of the records are not written by PAL. */
+    if (work->clear)
+        IA_MEMSET(output->data, 0, work->capacities[index]);
+    output->size = work->capacities[index];
+    input_params.program_group = &group;
+    work->err[index] = ia_isp_bxt_run(work->instances[index], &input_params, output);
+}
+
+/*!
+ * \brief Appends records of PAL output of a worker into the combined output.
+ * \return Size of the combined output after appending or 0 if PAL output is corrupted or doesn't fit.
+ */
+static inline unsigned int
+ia_isp_bxt_parallel_append(uint8_t *dst,
+                           unsigned int dst_size,
+                           unsigned int dst_capacity,
+                           const ia_binary_data *src,
+                           bool skip_call_info)
+{
+    const uint8_t *data = (const uint8_t *)src->data;
+    unsigned int offset = 0;
+
+    while (offset + sizeof(ia_isp_bxt_pal_record_header) <= src->size) {
+        ia_isp_bxt_pal_record_header header;
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.size < sizeof(header) || header.size > src->size - offset)
+            return 0;
+        if (!(skip_call_info && header.uuid == ia_pal_uuid_isp_call_info)) {
+            if (header.size > dst_capacity - dst_size)
+                return 0;
+            memcpy(dst + dst_size, data + offset, header.size);
+            dst_size += header.size;
+        }
+        offset += header.size;
+    }
+    return dst_size;
+}
+
+/*!
+ * \brief Runs the parts of the split on the given instances and combines their outputs.
+ */
+static inline ia_err
+ia_isp_bxt_parallel_run_split(ia_isp_bxt_parallel *parallel,
+                              const ia_isp_bxt_parallel_split *split,
+                              const ia_task_env *env,
+                              const ia_isp_bxt_input_params *input_params,
+                              ia_isp_bxt *const *instances,
+                              ia_binary_data *outputs,
+                              unsigned int *capacities,
+                              bool clear,
+                              ia_binary_data *output_data)
+{
+    ia_isp_bxt_parallel_work work;
+    unsigned int i, size, capacity;
+    uint8_t *dst;
+
+    memset(&work, 0, sizeof(work));
+    work.split = split;
+    work.input_params = input_params;
+    work.instances = instances;
+    work.outputs = outputs;
+    work.capacities = capacities;
+    work.clear = clear;
+    ia_task_run(env, ia_isp_bxt_parallel_run_worker, &work, split->num_parts);
+    for (i = 0; i < split->num_parts; i++)
+        if (work.err[i] != ia_err_none)
+            return work.err[i];
+
+    /* Call info record of the first part followed by kernel records of all parts. */
+    for (i = 0, size = 0; i < split->num_parts; i++)
+        size += outputs[i].size;
+    if (output_data->data != NULL) {
+        dst = (uint8_t *)output_data->data;
+        capacity = output_data->size;
+    } else {
+        if (ia_isp_bxt_parallel_reserve(&parallel->output, &parallel->output_capacity, size) != ia_err_none)
+            return ia_err_nomemory;
+        dst = (uint8_t *)parallel->output.data;
+        capacity = parallel->output_capacity;
+    }
+    for (i = 0, size = 0; i < split->num_parts; i++) {
+        size = ia_isp_bxt_parallel_append(dst, size, capacity, &outputs[i], i > 0);
+        if (size == 0)
+            return output_data->data != NULL ? ia_err_nomemory : ia_err_data;
+    }
+    output_data->data = dst;
+    output_data->size = size;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Runs the parts of the calibrated split on the workers and combines their outputs.
+ */
+static inline ia_err
+ia_isp_bxt_parallel_run_parts(ia_isp_bxt_parallel *parallel,
+                              const ia_isp_bxt_parallel_split *split,
+                              const ia_task_env *env,
+                              const ia_isp_bxt_input_params *input_params,
+                              ia_binary_data *output_data)
+{
+    return ia_isp_bxt_parallel_run_split(parallel, split, env, input_params, parallel->workers, parallel->outputs,
+                                         parallel->capacities, false, output_data);
+}
+
+/*!
+ * \brief Finds the split calibrated for the program group and settings.
+ * \return Split or NULL if none is calibrated.
+ */
+static inline ia_isp_bxt_parallel_split *
+ia_isp_bxt_parallel_find_split(ia_isp_bxt_parallel *parallel,
+                               const ia_isp_bxt_program_group *group,
+                               uint64_t settings_key)
+{
+    ia_isp_bxt_parallel_split *split;
+    unsigned int i, j;
+
+    for (i = 0; i < IA_ISP_BXT_PARALLEL_MAX_SPLITS; i++) {
+        split = &parallel->splits[i];
+        if (split->kernel_count == 0 || split->kernel_count != group->kernel_count ||
+            split->settings_key != settings_key)
+            continue;
+        for (j = 0; j < group->kernel_count; j++) {
+            if (split->kernel_uuids[j] != group->run_kernels[j].kernel_uuid ||
+                split->kernel_enables[j] != group->run_kernels[j].enable)
+                break;
+        }
+        if (j == group->kernel_count)
+            return split;
+    }
+    return NULL;
+}
+
+/*!
+ * \brief Finds the first record which differs between two PAL outputs.
+ * \param[out] uuid        UUID of the first differing record of output a. ia_pal_uuid_isp_call_info, if output a has no
+ *                         more records but output b has.
+ * \param[out] occurrence  Number of records with the same UUID before the differing record in output a.
+ * \return                 true, if the outputs differ.
+ */
+static inline bool
+ia_isp_bxt_parallel_find_difference(const ia_binary_data *a,
+                                    const ia_binary_data *b,
+                                    uint32_t *uuid,
+                                    unsigned int *occurrence)
+{
+    const uint8_t *data_a = (const uint8_t *)a->data;
+    const uint8_t *data_b = (const uint8_t *)b->data;
+    ia_isp_bxt_pal_record_header header = { 0, 0 };
+    unsigned int offset = 0, end;
+
+    *uuid = ia_pal_uuid_isp_call_info;
+    *occurrence = 0;
+    while (offset + sizeof(ia_isp_bxt_pal_record_header) <= a->size) {
+        memcpy(&header, data_a + offset, sizeof(header));
+        if (header.size < sizeof(header) || header.size > a->size - offset || header.size > b->size - offset)
+            break;
+        /* Debug info record contains the run count of the ISP instance. */
+        if (header.uuid != ia_pal_uuid_isp_debug_info &&
+            IA_MEMCOMPARE(data_a + offset, data_b + offset, header.size) != 0)
+            break;
+        offset += header.size;
+    }
+    if (offset + sizeof(ia_isp_bxt_pal_record_header) > a->size)
+        return a->size != b->size;
+
+    *uuid = header.uuid;
+    for (end = offset, offset = 0; offset < end; offset += header.size) {
+        memcpy(&header, data_a + offset, sizeof(header));
+        if (header.uuid == *uuid)
+            (*occurrence)++;
+    }
+    return true;
+}
+
+/*!
+ * \brief Finds the kernel which writes the given record.
+ * Kernel records are in program group order, so the Nth record of a UUID is written by the Nth kernel of the UUID.
+ * \return Index of the kernel or -1 if no kernel writes the record (e.g. call info record).
+ */
+static inline int
+ia_isp_bxt_parallel_find_kernel(const ia_isp_bxt_program_group *group, uint32_t uuid, unsigned int occurrence)
+{
+    unsigned int i;
+
+    for (i = 0; i < group->kernel_count; i++) {
+        if (group->run_kernels[i].kernel_uuid == uuid && occurrence-- == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+/*!
+ * \brief Creates an ISP instance with the initialization parameters of the workers, without makernote.
+ */
+static inline ia_isp_bxt *
+ia_isp_bxt_parallel_create_instance(const ia_isp_bxt_parallel *parallel)
+{
+    return ia_isp_bxt_init(&parallel->aiqb_data, parallel->ia_cmc, parallel->max_stats_width,
+                           parallel->max_stats_height, parallel->max_num_stats_in, NULL);
+}
+
+/*!
+ * \brief Runs the parts of the split on fresh instances and compares the output with the reference output.
+ * \param[out] kernel  Index of the kernel of the first differing record, -1 if the record belongs to no kernel.
+ * \return             ia_err_none if the outputs are equal, ia_err_data if they differ, or another error code.
+ */
+static inline ia_err
+ia_isp_bxt_parallel_check(ia_isp_bxt_parallel *parallel,
+                          const ia_isp_bxt_parallel_split *split,
+                          const ia_task_env *env,
+                          const ia_isp_bxt_input_params *input_params,
+                          const ia_binary_data *reference_output,
+                          int *kernel)
+{
+    ia_isp_bxt *instances[IA_ISP_BXT_PARALLEL_MAX_WORKERS];
+    ia_binary_data outputs[IA_ISP_BXT_PARALLEL_MAX_WORKERS];
+    unsigned int capacities[IA_ISP_BXT_PARALLEL_MAX_WORKERS];
+    ia_binary_data output = { NULL, 0 };
+    ia_err err = ia_err_none;
+    unsigned int i, occurrence;
+    uint32_t uuid;
+
+    memset(instances, 0, sizeof(instances));
+    memset(outputs, 0, sizeof(outputs));
+    memset(capacities, 0, sizeof(capacities));
+    for (i = 0; i < split->num_parts && err == ia_err_none; i++) {
+        instances[i] = ia_isp_bxt_parallel_create_instance(parallel);
+        if (instances[i] == NULL)
+            err = ia_err_nomemory;
+    }
+    if (err == ia_err_none)
+        err = ia_isp_bxt_parallel_run_split(parallel, split, env, input_params, instances, outputs, capacities, true,
+                                            &output);
+    if (err == ia_err_none &&
+        ia_isp_bxt_parallel_find_difference(reference_output, &output, &uuid, &occurrence)) {
+        *kernel = ia_isp_bxt_parallel_find_kernel(input_params->program_group, uuid, occurrence);
+        err = ia_err_data;
+    }
+    for (i = 0; i < split->num_parts; i++) {
+        if (instances[i] != NULL)
+            ia_isp_bxt_deinit(instances[i]);
+        IA_FREEZ(outputs[i].data);
+    }
+    return err;
+}
+
+/*!
+ * \brief Merges parts of the split until their output on fresh instances is equal to the reference output.
+ * Reference output is computed with ia_isp_bxt_run of the whole program group on a fresh instance. Part which contains
+ * the kernel of the first differing record is merged with the next part (the last part with the previous one). If the
+ * record doesn't belong to any kernel, all parts are merged into one.
+ */
+static inline ia_err
+ia_isp_bxt_parallel_merge(ia_isp_bxt_parallel *parallel,
+                          ia_isp_bxt_parallel_split *split,
+                          const ia_task_env *env,
+                          const ia_isp_bxt_input_params *input_params)
+{
+    const ia_isp_bxt_program_group *group = input_params->program_group;
+    ia_binary_data reference_output = { NULL, 0 };
+    ia_isp_bxt *reference;
+    ia_err err;
+    unsigned int i, part;
+    int kernel;
+
+    reference = ia_isp_bxt_parallel_create_instance(parallel);
+    if (reference == NULL)
+        return ia_err_nomemory;
+    reference_output.size = (unsigned int)ia_isp_bxt_get_output_size((ia_isp_bxt_program_group *)group);
+    reference_output.data = IA_CALLOC(reference_output.size);
+    err = reference_output.data != NULL ? ia_isp_bxt_run(reference, input_params, &reference_output) : ia_err_nomemory;
+    ia_isp_bxt_deinit(reference);
+
+    while (err == ia_err_none && split->num_parts > 1) {
+        err = ia_isp_bxt_parallel_check(parallel, split, env, input_params, &reference_output, &kernel);
+        if (err != ia_err_data)
+            break;
+        err = ia_err_none;
+        if (kernel < 0) {
+            split->part_first[1] = group->kernel_count;
+            split->num_parts = 1;
+            break;
+        }
+        for (part = 0; part + 1 < split->num_parts && split->part_first[part + 1] <= (unsigned int)kernel; part++)
+            ;
+        if (part + 1 == split->num_parts)
+            part--;
+        /* Merge parts part and part + 1. */
+        for (i = part + 1; i < split->num_parts; i++)
+            split->part_first[i] = split->part_first[i + 1];
+        split->num_parts--;
+    }
+    IA_FREEZ(reference_output.data);
+    return err;
+}
+
+/*!
+ * \brief Calibrates the split for the program group.
+ * Starts from contiguous parts of (nearly) equal number of kernels and merges them (see ia_isp_bxt_parallel_merge).
+ */
+static inline ia_err
+ia_isp_bxt_parallel_calibrate(ia_isp_bxt_parallel *parallel,
+                              ia_isp_bxt_parallel_split *split,
+                              const ia_task_env *env,
+                              const ia_isp_bxt_input_params *input_params)
+{
+    const ia_isp_bxt_program_group *group = input_params->program_group;
+    ia_err err;
+    unsigned int i, first;
+
+    split->kernel_count = 0;
+    if (group->kernel_count > split->kernel_capacity) {
+        IA_FREEZ(split->kernel_uuids);
+        IA_FREEZ(split->kernel_enables);
+        split->kernel_capacity = 0;
+        split->kernel_uuids = (uint32_t *)IA_ALLOC(group->kernel_count * sizeof(uint32_t));
+        split->kernel_enables = (int32_t *)IA_ALLOC(group->kernel_count * sizeof(int32_t));
+        if (split->kernel_uuids == NULL || split->kernel_enables == NULL)
+            return ia_err_nomemory;
+        split->kernel_capacity = group->kernel_count;
+    }
+
+    split->num_parts = IA_MIN(parallel->num_workers, group->kernel_count);
+    for (i = 0, first = 0; i <= split->num_parts; i++) {
+        split->part_first[i] = first;
+        if (i < split->num_parts)
+            first += group->kernel_count / split->num_parts + (i < group->kernel_count % split->num_parts ? 1 : 0);
+    }
+    err = ia_isp_bxt_parallel_merge(parallel, split, env, input_params);
+    if (err != ia_err_none)
+        return err;
+
+    for (i = 0; i < group->kernel_count; i++) {
+        split->kernel_uuids[i] = group->run_kernels[i].kernel_uuid;
+        split->kernel_enables[i] = group->run_kernels[i].enable;
+    }
+    split->kernel_count = group->kernel_count;
+    split->settings_key = ia_isp_bxt_parallel_settings_key(input_params);
+    split->last_run = parallel->run_count;
+    split->runs_since_verify = 0;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Calibrates or verifies the split of the program group, outside of the latency critical part of the frame.
+ * If no split is calibrated for the program group and tuning related input parameters, a split is calibrated, replacing
+ * the least recently used one. Otherwise, if verification is enabled (see ia_isp_bxt_parallel_set_verify_interval) and
+ * due, the split is verified. Both run the program group on fresh instances only, so state and output of the workers
+ * are not touched. Cost is a few runs of the whole program group and one ia_isp_bxt_init per part; nothing is done if
+ * the split is calibrated and no verification is due.
+ *
+ * Typically called after ia_isp_bxt_parallel_run with the same input parameters, once the PAL output has been passed
+ * on. Can also be called before the first run of a program group, if its input parameters are known.
+ *
+ * \param[in,out] parallel      Mandatory. Parallel ISP handle.
+ * \param[in]     env           Optional. Worker pool. If NULL, default executor of ia_task_run is used.
+ * \param[in]     input_params  Mandatory. Input parameters for ISP calculations.
+ * \return                      Error code.
+ */
+static inline ia_err
+ia_isp_bxt_parallel_prepare(ia_isp_bxt_parallel *parallel,
+                            const ia_task_env *env,
+                            const ia_isp_bxt_input_params *input_params)
+{
+    const ia_isp_bxt_program_group *group;
+    ia_isp_bxt_parallel_split *split;
+    unsigned int i;
+
+    if (parallel == NULL || input_params == NULL)
+        return ia_err_argument;
+    group = input_params->program_group;
+    if (group == NULL || group->kernel_count < 2 || parallel->num_workers < 2)
+        return ia_err_none;
+    split = ia_isp_bxt_parallel_find_split(parallel, group, ia_isp_bxt_parallel_settings_key(input_params));
+    if (split == NULL) {
+        split = &parallel->splits[0];
+        for (i = 1; i < IA_ISP_BXT_PARALLEL_MAX_SPLITS && split->kernel_count > 0; i++) {
+            if (parallel->splits[i].kernel_count == 0 || parallel->splits[i].last_run < split->last_run)
+                split = &parallel->splits[i];
+        }
+        return ia_isp_bxt_parallel_calibrate(parallel, split, env, input_params);
+    }
+    if (parallel->verify_interval == 0 || split->runs_since_verify < parallel->verify_interval)
+        return ia_err_none;
+    split->runs_since_verify = 0;
+    return ia_isp_bxt_parallel_merge(parallel, split, env, input_params);
+}
+
+/*!
+ * \brief ISP configuration for the next frame, computed in parallel.
+ * If program group is not given, it has only one kernel, or no split is calibrated for it (see
+ * ia_isp_bxt_parallel_prepare), ia_isp_bxt_run is called on the first worker. Otherwise the parts of the calibrated
+ * split are run on the workers. Calibration and verification are never done here.
+ *
+ * \param[in,out] parallel      Mandatory. Parallel ISP handle.
+ * \param[in]     env           Optional. Worker pool. If NULL, default executor of ia_task_run is used.
+ * \param[in]     input_params  Mandatory. Input parameters for ISP calculations.
+ * \param[in,out] output_data   Mandatory. Output data structure. If output_data->data is given, PAL output is written into
+ *                              the buffer of output_data->size bytes. Otherwise output_data points to a buffer owned by
+ *                              the handle (or by the first worker, if ia_isp_bxt_run is used), which is valid until the
+ *                              next call.
+ * \return                      Error code of the first failed worker.
+ */
+static inline ia_err
+ia_isp_bxt_parallel_run(ia_isp_bxt_parallel *parallel,
+                        const ia_task_env *env,
+                        const ia_isp_bxt_input_params *input_params,
+                        ia_binary_data *output_data)
+{
+    const ia_isp_bxt_program_group *group;
+    ia_isp_bxt_parallel_split *split = NULL;
+
+    if (parallel == NULL || input_params == NULL || output_data == NULL)
+        return ia_err_argument;
+    group = input_params->program_group;
+    if (group != NULL && group->kernel_count >= 2 && parallel->num_workers >= 2)
+        split = ia_isp_bxt_parallel_find_split(parallel, group, ia_isp_bxt_parallel_settings_key(input_params));
+    if (split == NULL)
+        return ia_isp_bxt_run(parallel->workers[0], input_params, output_data);
+    split->last_run = ++parallel->run_count;
+    split->runs_since_verify++;
+    return ia_isp_bxt_parallel_run_parts(parallel, split, env, input_params, output_data);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_ISP_BXT_PARALLEL_H_ */
@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_isp_bxt_statistics_compact.h
+ * \brief Compact statistics layout sized to the actual grid.
+ *
+ * Grid records of ia_isp_bxt_statistics_types.h are sized for the maximum grid. For example ia_isp_bxt_hdr_rgby_grid_t
+ * is over 1 MB even if the actual grid is a fraction of the maximum. Compact statistics contain the same records, but
+ * each grid record (RGBS, filter response, HDR RGBS, HDR RGBY and HDR YV grids) is replaced with
+ * ia_isp_bxt_compact_grid_t, which is followed by its data planes sized to grid_width x grid_height. Other records are
+ * copied as they are. Records follow each other with their size rounded up to multiple of 8 bytes, as in statistics
+ * binary, so ia_isp_bxt_statistics_find_record works on compact statistics too.
+ *
+ * Compact statistics are converted with the same converters of ia_isp_bxt.h which take the grid data as arrays, and
+ * given to LTM through ia_ltm_run_from_compact.
+ */
+
+#ifndef IA_ISP_BXT_STATISTICS_COMPACT_H_
+#define IA_ISP_BXT_STATISTICS_COMPACT_H_
+
+#include "ia_types.h"
+#include "ia_isp_bxt.h"
+#include "ia_isp_bxt_statistics_types.h"
+#include "ia_isp_bxt_statistics_utils.h"
+#include "ia_ltm.h"
+#include "ia_abstraction.h"
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*!
+ * \brief Flag in the UUID of a compact grid record. The other bits are the UUID of the original record.
+ */
+#define IA_ISP_BXT_STATISTICS_UUID_COMPACT    0x10000
+
+/*!
+ * \brief Maximum number of data planes in a grid record.
+ */
+#define IA_ISP_BXT_COMPACT_GRID_MAX_PLANES    12
+
+/*!
+ * \brief Grid record in compact statistics. Data planes follow the record header.
+ */
+typedef struct
+{
+    ia_isp_bxt_statistics_header_t header;                      /*!< Header data. UUID of the original record with IA_ISP_BXT_STATISTICS_UUID_COMPACT flag. Size includes data planes. */
+    int32_t grid_width;                                         /*!< The actual grid width. */
+    int32_t grid_height;                                        /*!< The actual grid height. */
+    int32_t num_planes;                                         /*!< Number of data planes. */
+    int32_t reserved;                                           /*!< Reserved. */
+    uint32_t plane_offsets[IA_ISP_BXT_COMPACT_GRID_MAX_PLANES]; /*!< Offsets of the data planes from the beginning of the record. */
+} ia_isp_bxt_compact_grid_t;
+
+/*!
+ * \brief Data plane of a grid record.
+ */
+typedef struct
+{
+    unsigned int offset;         /*!< Offset of the array in the original record. */
+    unsigned int element_size;   /*!< Size of an array element in bytes. */
+    unsigned int divisor;        /*!< Number of elements is grid_width * grid_height / divisor rounded up. */
+} ia_isp_bxt_compact_plane_layout;
+
+/*!
+ * \brief Data planes of a grid record type.
+ */
+typedef struct
+{
+    ia_isp_bxt_statistics_uuid uuid;                                        /*!< UUID of the original record. */
+    unsigned int record_size;                                               /*!< Size of the original record. */
+    unsigned int max_num_elements;                                          /*!< Maximum grid_width * grid_height. */
+    unsigned int num_planes;                                                /*!< Number of data planes. */
+    ia_isp_bxt_compact_plane_layout planes[IA_ISP_BXT_COMPACT_GRID_MAX_PLANES]; /*!< Data planes in order. */
+} ia_isp_bxt_compact_grid_layout;
+
+/*!
+ * \brief Gets data plane layout of a grid record type.
+ * \return Layout or NULL, if the record is not a grid record.
+ */
+static inline const ia_isp_bxt_compact_grid_layout *
+ia_isp_bxt_compact_grid_get_layout(int32_t uuid)
+{
+#define IA_ISP_BXT_COMPACT_PLANE(type, array, divisor) { (unsigned int)offsetof(type, array), (unsigned int)sizeof(((type *)0)->array[0]), divisor }
+    static const ia_isp_bxt_compact_grid_layout layouts[] = {
+        { ia_isp_bxt_statistics_uuid_rgbs_grid, sizeof(ia_isp_bxt_rgbs_grid_t), BXT_RGBS_GRID_MAX_NUM_ELEMENTS, 12, {
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, c0_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, c1_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, c2_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, c3_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, c4_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, c5_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, c6_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, c7_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, sat_ratio_0, 4),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, sat_ratio_1, 4),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, sat_ratio_2, 4),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_rgbs_grid_t, sat_ratio_3, 4) } },
+        { ia_isp_bxt_statistics_uuid_filter_response_grid, sizeof(ia_isp_bxt_filter_response_grid_t), BXT_FILTER_RESPONSE_GRID_MAX_NUM_ELEMENTS, 7, {
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_filter_response_grid_t, y00_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_filter_response_grid_t, y01_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_filter_response_grid_t, y10_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_filter_response_grid_t, y11_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_filter_response_grid_t, r_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_filter_response_grid_t, g_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_filter_response_grid_t, b_avg, 1) } },
+        { ia_isp_bxt_statistics_uuid_hdr_rgbs_grid, sizeof(ia_isp_bxt_hdr_rgbs_grid_t), BXT_RGBS_GRID_MAX_NUM_ELEMENTS, 4, {
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_rgbs_grid_t, r_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_rgbs_grid_t, g_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_rgbs_grid_t, b_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_rgbs_grid_t, sat, 1) } },
+        { ia_isp_bxt_statistics_uuid_hdr_rgby_grid, sizeof(ia_isp_bxt_hdr_rgby_grid_t), BXT_HDR_RGBY_GRID_MAX_NUM_ELEMENTS, 4, {
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_rgby_grid_t, r_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_rgby_grid_t, b_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_rgby_grid_t, g_avg, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_rgby_grid_t, y_avg, 1) } },
+        { ia_isp_bxt_statistics_uuid_hdr_yv_grid, sizeof(ia_isp_bxt_hdr_yv_grid_t), BXT_HDR_RGBY_GRID_MAX_NUM_ELEMENTS, 2, {
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_yv_grid_t, v_max, 1),
+            IA_ISP_BXT_COMPACT_PLANE(ia_isp_bxt_hdr_yv_grid_t, y_avg, 1) } }
+    };
+#undef IA_ISP_BXT_COMPACT_PLANE
+    unsigned int i;
+
+    for (i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        if ((int32_t)layouts[i].uuid == uuid)
+            return &layouts[i];
+    }
+    return NULL;
+}
+
+/*!
+ * \brief Size of a data plane in bytes.
+ */
+static inline unsigned int
+ia_isp_bxt_compact_plane_size(const ia_isp_bxt_compact_plane_layout *plane, unsigned int num_elements)
+{
+    return (num_elements + plane->divisor - 1) / plane->divisor * plane->element_size;
+}
+
+/*!
+ * \brief Size of a compact grid record.
+ * \return Size of the record including data planes or 0 if grid size is not valid for the record type.
+ */
+static inline unsigned int
+ia_isp_bxt_compact_grid_get_size(const ia_isp_bxt_compact_grid_layout *layout,
+                                 int32_t grid_width,
+                                 int32_t grid_height)
+{
+    unsigned int i, size = sizeof(ia_isp_bxt_compact_grid_t), num_elements;
+
+    if (grid_width <= 0 || grid_height <= 0 ||
+        (unsigned int)grid_width * (unsigned int)grid_height > layout->max_num_elements)
+        return 0;
+    num_elements = (unsigned int)grid_width * (unsigned int)grid_height;
+    for (i = 0; i < layout->num_planes; i++)
+        size += (ia_isp_bxt_compact_plane_size(&layout->planes[i], num_elements) + 7) & ~7u;
+    return size;
+}
+
+/*!
+ * \brief Gets a data plane of a compact grid record.
+ *
+ * \param[in] grid  Mandatory. Compact grid record.
+ * \param[in] plane Mandatory. Index of the plane in the order of the arrays of the original record.
+ * \return          Pointer to the plane inside the record or NULL if plane doesn't exist.
+ */
+static inline const void *
+ia_isp_bxt_compact_grid_get_plane(const ia_isp_bxt_compact_grid_t *grid, unsigned int plane)
+{
+    if (grid == NULL || plane >= (unsigned int)grid->num_planes)
+        return NULL;
+    return (const char *)grid + grid->plane_offsets[plane];
+}
+
+/*!
+ * \brief Finds a compact grid record from compact statistics.
+ *
+ * \param[in] compact_statistics Mandatory. Compact statistics.
+ * \param[in] uuid               Mandatory. UUID of the original grid record. See ia_isp_bxt_statistics_uuid.
+ * \return                       Pointer to the record inside the statistics or NULL, if record is not found or is corrupted.
+ */
+static inline const ia_isp_bxt_compact_grid_t *
+ia_isp_bxt_statistics_find_compact_grid(const ia_binary_data *compact_statistics,
+                                        ia_isp_bxt_statistics_uuid uuid)
+{
+    const ia_isp_bxt_compact_grid_layout *layout = ia_isp_bxt_compact_grid_get_layout((int32_t)uuid);
+    const ia_isp_bxt_statistics_header_t *header;
+    const ia_isp_bxt_compact_grid_t *grid;
+    unsigned int i;
+
+    if (layout == NULL)
+        return NULL;
+    header = ia_isp_bxt_statistics_find_record(compact_statistics,
+                                               (ia_isp_bxt_statistics_uuid)(uuid | IA_ISP_BXT_STATISTICS_UUID_COMPACT));
+    if (header == NULL || (size_t)header->size < sizeof(ia_isp_bxt_compact_grid_t))
+        return NULL;
+    grid = (const ia_isp_bxt_compact_grid_t *)header;
+    if (grid->num_planes != (int32_t)layout->num_planes ||
+        ia_isp_bxt_compact_grid_get_size(layout, grid->grid_width, grid->grid_height) != (unsigned int)header->size)
+        return NULL;
+    for (i = 0; i < layout->num_planes; i++) {
+        if (grid->plane_offsets[i] < sizeof(ia_isp_bxt_compact_grid_t) ||
+            grid->plane_offsets[i] + ia_isp_bxt_compact_plane_size(&layout->planes[i],
+                (unsigned int)(grid->grid_width * grid->grid_height)) > (unsigned int)header->size)
+            return NULL;
+    }
+    return grid;
+}
+
+/*!
+ * \brief Converts statistics binary into compact statistics.
+ *
+ * \param[in]     statistics         Mandatory. Statistics in ISP specific format.
+ * \param[in,out] compact_statistics Mandatory. Output buffer in data and its size in size. If data is NULL, only the
+ *                                   needed size is returned in size.
+ * \return                           Error code. ia_err_nomemory, if output buffer is too small. ia_err_data, if
+ *                                   statistics are corrupted.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_compact(const ia_binary_data *statistics,
+                              ia_binary_data *compact_statistics)
+{
+    const char *src;
+    char *dst;
+    unsigned int offset = 0, dst_offset = 0, capacity, i;
+
+    if (statistics == NULL || statistics->data == NULL || compact_statistics == NULL)
+        return ia_err_argument;
+    src = (const char *)statistics->data;
+    dst = (char *)compact_statistics->data;
+    capacity = compact_statistics->size;
+
+    while (offset + sizeof(ia_isp_bxt_statistics_header_t) <= statistics->size) {
+        const ia_isp_bxt_statistics_header_t *header = (const ia_isp_bxt_statistics_header_t *)(src + offset);
+        const ia_isp_bxt_compact_grid_layout *layout = ia_isp_bxt_compact_grid_get_layout(header->uuid);
+        unsigned int size;
+
+        if (header->size < (int32_t)sizeof(ia_isp_bxt_statistics_header_t) ||
+            (unsigned int)header->size > statistics->size - offset)
+            return ia_err_data;
+
+        if (layout == NULL || (unsigned int)header->size < layout->record_size) {
+            /* Not a grid record: copy as it is. */
+            size = (unsigned int)header->size;
+            if (dst != NULL) {
+                if (((size + 7) & ~7u) > capacity - dst_offset)
+                    return ia_err_nomemory;
+                memcpy(dst + dst_offset, header, size);
+            }
+        } else {
+            const int32_t *dims = (const int32_t *)(header + 1);
+            unsigned int num_elements, plane_offset;
+
+            size = ia_isp_bxt_compact_grid_get_size(layout, dims[0], dims[1]);
+            if (size == 0)
+                return ia_err_data;
+            if (dst != NULL) {
+                ia_isp_bxt_compact_grid_t *grid = (ia_isp_bxt_compact_grid_t *)(dst + dst_offset);
+
+                if (size > capacity - dst_offset)
+                    return ia_err_nomemory;
+                memset(grid, 0, sizeof(*grid));
+                grid->header.uuid = header->uuid | IA_ISP_BXT_STATISTICS_UUID_COMPACT;
+                grid->header.size = (int32_t)size;
+                grid->grid_width = dims[0];
+                grid->grid_height = dims[1];
+                grid->num_planes = (int32_t)layout->num_planes;
+                num_elements = (unsigned int)(dims[0] * dims[1]);
+                plane_offset = sizeof(ia_isp_bxt_compact_grid_t);
+                for (i = 0; i < layout->num_planes; i++) {
+                    unsigned int plane_size = ia_isp_bxt_compact_plane_size(&layout->planes[i], num_elements);
+                    grid->plane_offsets[i] = plane_offset;
+                    memcpy((char *)grid + plane_offset, (const char *)header + layout->planes[i].offset, plane_size);
+                    memset((char *)grid + plane_offset + plane_size, 0, ((plane_size + 7) & ~7u) - plane_size);
+                    plane_offset += (plane_size + 7) & ~7u;
+                }
+            }
+        }
+        dst_offset += (size + 7) & ~7u;
+        offset += ((unsigned int)header->size + 7) & ~7u;
+    }
+    compact_statistics->size = dst_offset;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Expands a compact grid record into the original record.
+ * Only the data of the actual grid is written. Rest of the arrays are not touched.
+ *
+ * \param[in]  grid          Mandatory. Compact grid record.
+ * \param[out] record        Mandatory. Original record, e.g. ia_isp_bxt_hdr_yv_grid_t.
+ * \param[in]  record_size   Mandatory. Size of the original record buffer.
+ * \return                   Error code.
+ */
+static inline ia_err
+ia_isp_bxt_compact_grid_expand(const ia_isp_bxt_compact_grid_t *grid, void *record, unsigned int record_size)
+{
+    const ia_isp_bxt_compact_grid_layout *layout;
+    ia_isp_bxt_statistics_header_t *header = (ia_isp_bxt_statistics_header_t *)record;
+    int32_t *dims = (int32_t *)(header + 1);
+    unsigned int i, num_elements;
+
+    if (grid == NULL || record == NULL)
+        return ia_err_argument;
+    layout = ia_isp_bxt_compact_grid_get_layout(grid->header.uuid & ~IA_ISP_BXT_STATISTICS_UUID_COMPACT);
+    if (layout == NULL || record_size < layout->record_size ||
+        ia_isp_bxt_compact_grid_get_size(layout, grid->grid_width, grid->grid_height) == 0)
+        return ia_err_data;
+    header->uuid = (int32_t)layout->uuid;
+    header->size = (int32_t)layout->record_size;
+    dims[0] = grid->grid_width;
+    dims[1] = grid->grid_height;
+    num_elements = (unsigned int)(grid->grid_width * grid->grid_height);
+    for (i = 0; i < layout->num_planes; i++)
+        memcpy((char *)record + layout->planes[i].offset, ia_isp_bxt_compact_grid_get_plane(grid, i),
+               ia_isp_bxt_compact_plane_size(&layout->planes[i], num_elements));
+    return ia_err_none;
+}
+
+/*!
+ * \brief Describes compact RGBS grid record in place as AIQ RGBS grid view.
+ *
+ * \param[in]  compact_statistics Mandatory. Compact statistics.
+ * \param[out] view               Mandatory. View to the record data. Valid as long as the statistics are.
+ * \return                        Error code. ia_err_data, if statistics don't contain RGBS grid.
+ */
+static inline ia_err
+ia_isp_bxt_compact_statistics_get_rgbs_grid_view(const ia_binary_data *compact_statistics,
+                                                 ia_aiq_rgbs_grid_view *view)
+{
+    const ia_isp_bxt_compact_grid_t *grid =
+        ia_isp_bxt_statistics_find_compact_grid(compact_statistics, ia_isp_bxt_statistics_uuid_rgbs_grid);
+    unsigned int i;
+
+    if (view == NULL)
+        return ia_err_argument;
+    if (grid == NULL)
+        return ia_err_data;
+    view->avg_gr = (const int32_t *)ia_isp_bxt_compact_grid_get_plane(grid, 0);
+    view->avg_r = (const int32_t *)ia_isp_bxt_compact_grid_get_plane(grid, 1);
+    view->avg_b = (const int32_t *)ia_isp_bxt_compact_grid_get_plane(grid, 2);
+    view->avg_gb = (const int32_t *)ia_isp_bxt_compact_grid_get_plane(grid, 3);
+    for (i = 0; i < 4; i++)
+        view->sat[i] = (const int32_t *)ia_isp_bxt_compact_grid_get_plane(grid, 8 + i);
+    view->row_stride = (unsigned int)grid->grid_width;
+    view->grid_width = (unsigned short)grid->grid_width;
+    view->grid_height = (unsigned short)grid->grid_height;
+    view->shading_correction = false;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Converts compact RGBS grid to IA_AIQ format.
+ * Same as ia_isp_bxt_statistics_convert_awb_from_binary_v2, but statistics are compact.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_convert_awb_from_compact(ia_isp_bxt *ia_isp_bxt,
+                                               const ia_binary_data *compact_statistics,
+                                               const ia_aiq_ir_weight_t *ir_weight,
+                                               const ia_aiq_ae_results *ae_results,
+                                               ia_aiq_rgbs_grid **out_rgbs_grid,
+                                               ia_aiq_grid **out_ir_grid)
+{
+    const ia_isp_bxt_compact_grid_t *grid =
+        ia_isp_bxt_statistics_find_compact_grid(compact_statistics, ia_isp_bxt_statistics_uuid_rgbs_grid);
+    void *planes[IA_ISP_BXT_COMPACT_GRID_MAX_PLANES];
+    unsigned int i;
+
+    if (grid == NULL)
+        return ia_err_data;
+    for (i = 0; i < 12; i++)
+        planes[i] = (void *)ia_isp_bxt_compact_grid_get_plane(grid, i);
+    return ia_isp_bxt_statistics_convert_awb_v2(ia_isp_bxt, (unsigned int)grid->grid_width, (unsigned int)grid->grid_height,
+                                                planes[0], planes[1], planes[2], planes[3],
+                                                planes[4], planes[5], planes[6], planes[7],
+                                                planes[8], planes[9], planes[10], planes[11],
+                                                ir_weight, ae_results, out_rgbs_grid, out_ir_grid);
+}
+
+/*!
+ * \brief Converts compact HDR RGBS grid to IA_AIQ format.
+ * Same as ia_isp_bxt_statistics_convert_awb_hdr_from_binary_v2, but statistics are compact.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_convert_awb_hdr_from_compact(ia_isp_bxt *ia_isp_bxt,
+                                                   const ia_binary_data *compact_statistics,
+                                                   const ia_aiq_ae_results *ae_results,
+                                                   const ia_isp_bxt_hdr_compression_t *hdr_compression,
+                                                   unsigned int stats_rgbs_hdr_block_pixel_width,
+                                                   unsigned int stats_rgbs_hdr_block_pixel_height,
+                                                   float r_gain,
+                                                   float g_gain,
+                                                   float b_gain,
+                                                   ia_aiq_rgbs_grid **out_rgbs_grid,
+                                                   ia_aiq_hdr_rgbs_grid **out_hdr_rgbs_grid)
+{
+    const ia_isp_bxt_compact_grid_t *grid =
+        ia_isp_bxt_statistics_find_compact_grid(compact_statistics, ia_isp_bxt_statistics_uuid_hdr_rgbs_grid);
+
+    if (grid == NULL)
+        return ia_err_data;
+    return ia_isp_bxt_statistics_convert_awb_hdr_v2(ia_isp_bxt, (unsigned int)grid->grid_width, (unsigned int)grid->grid_height,
+                                                    (void *)ia_isp_bxt_compact_grid_get_plane(grid, 0),
+                                                    (void *)ia_isp_bxt_compact_grid_get_plane(grid, 1),
+                                                    (void *)ia_isp_bxt_compact_grid_get_plane(grid, 2),
+                                                    (void *)ia_isp_bxt_compact_grid_get_plane(grid, 3),
+                                                    ae_results, hdr_compression,
+                                                    stats_rgbs_hdr_block_pixel_width, stats_rgbs_hdr_block_pixel_height,
+                                                    r_gain, g_gain, b_gain, out_rgbs_grid, out_hdr_rgbs_grid);
+}
+
+/*!
+ * \brief Converts compact filter response grid to IA_AIQ format.
+ * Same as ia_isp_bxt_statistics_convert_af_from_binary, but statistics are compact.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_convert_af_from_compact(ia_isp_bxt *ia_isp_bxt,
+                                              const ia_binary_data *compact_statistics,
+                                              ia_aiq_af_grid **out_af_grid)
+{
+    const ia_isp_bxt_compact_grid_t *grid =
+        ia_isp_bxt_statistics_find_compact_grid(compact_statistics, ia_isp_bxt_statistics_uuid_filter_response_grid);
+
+    if (grid == NULL)
+        return ia_err_data;
+    return ia_isp_bxt_statistics_convert_af(ia_isp_bxt, (unsigned int)grid->grid_width, (unsigned int)grid->grid_height,
+                                            (void *)ia_isp_bxt_compact_grid_get_plane(grid, 0),
+                                            (void *)ia_isp_bxt_compact_grid_get_plane(grid, 1),
+                                            (void *)ia_isp_bxt_compact_grid_get_plane(grid, 2),
+                                            (void *)ia_isp_bxt_compact_grid_get_plane(grid, 3),
+                                            out_af_grid);
+}
+
+/*!
+ * \brief LTM calculation with HDR YV grid from compact statistics.
+ * ia_ltm_run takes HDR YV grid in the original record, so the actual grid is expanded into yv_grid before running LTM.
+ * Only grid_width x grid_height elements of yv_grid are written, so the rest of the record stays cold in cache.
+ *
+ * \param[in]  ia_ltm             Mandatory. LTM instance handle.
+ * \param[in]  ltm_input_params   Mandatory. Input parameters for LTM calculations. yv_grid is ignored.
+ * \param[in]  compact_statistics Optional. Compact statistics. If NULL or they don't contain HDR YV grid, LTM is run
+ *                                without yv_grid.
+ * \param[in]  yv_grid            Mandatory if compact statistics contain HDR YV grid. Buffer for the expanded grid.
+ *                                Can be reused from frame to frame.
+ * \param[out] ltm_results        Mandatory. Same as in ia_ltm_run.
+ * \param[out] ltm_results_drc    Mandatory. Same as in ia_ltm_run.
+ * \return                        Error code.
+ */
+static inline ia_err
+ia_ltm_run_from_compact(ia_ltm *ia_ltm,
+                        const ia_ltm_input_params *ltm_input_params,
+                        const ia_binary_data *compact_statistics,
+                        ia_isp_bxt_hdr_yv_grid_t *yv_grid,
+                        ia_ltm_results **ltm_results,
+                        ia_ltm_drc_params **ltm_results_drc)
+{
+    ia_ltm_input_params input_params;
+    const ia_isp_bxt_compact_grid_t *grid = NULL;
+    ia_err err;
+
+    if (ltm_input_params == NULL)
+        return ia_err_argument;
+    input_params = *ltm_input_params;
+    input_params.yv_grid = NULL;
+    if (compact_statistics != NULL)
+        grid = ia_isp_bxt_statistics_find_compact_grid(compact_statistics, ia_isp_bxt_statistics_uuid_hdr_yv_grid);
+    if (grid != NULL) {
+        err = ia_isp_bxt_compact_grid_expand(grid, yv_grid, sizeof(ia_isp_bxt_hdr_yv_grid_t));
+        if (err != ia_err_none)
+            return err;
+        input_params.yv_grid = yv_grid;
+    }
+    return ia_ltm_run(ia_ltm, &input_params, ltm_results, ltm_results_drc);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IA_ISP_BXT_STATISTICS_COMPACT_H_ */
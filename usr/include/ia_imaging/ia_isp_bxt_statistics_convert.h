@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_isp_bxt_statistics_convert.h
+ * \brief Conversion of all statistics of a BXT ISP statistics binary in one pass.
+ *
+ * ia_isp_bxt_statistics_query followed by the convert functions of ia_isp_bxt.h walks the statistics records once per
+ * call. ia_isp_bxt_statistics_convert_all walks the records once and converts every record it finds:
+ * - RGBS grid: ia_isp_bxt_rgbs_grid_pack (ia_isp_bxt_statistics_simd.h). RGB-IR and multi-exposure statistics
+ *   (ir_weight or ae_results with more than one exposure given) with ia_isp_bxt_statistics_convert_awb_v2.
+ * - HDR RGBS grid: ia_isp_bxt_statistics_convert_awb_hdr_v2.
+ * - Filter response grid and histograms: ia_isp_bxt_filter_response_grid_pack and ia_isp_bxt_statistics_simd.h histogram copy.
+ * - Motion vectors and PAF grid: ia_isp_bxt_statistics_convert_dvs_from_binary and
+ *   ia_isp_bxt_statistics_convert_paf_from_binary with the record alone, so the library finds it at once.
+ * - HDR RGBY and YV grids: pointers to the records.
+ *
+ * Results are collected to a client owned ia_isp_bxt_statistics_bundle, which can be reused for every frame:
+ * \code
+ * ia_isp_bxt_statistics_bundle *bundle = (ia_isp_bxt_statistics_bundle *)IA_ALLOC(sizeof(ia_isp_bxt_statistics_bundle));
+ * ia_isp_bxt_statistics_bundle_init(bundle);
+ * ...
+ * ia_isp_bxt_statistics_convert_all(isp, &statistics, &convert_params, bundle);
+ * ia_isp_bxt_statistics_bundle_get_aiq_params(bundle, &statistics_input_params);
+ * ia_aiq_statistics_set_v1(aiq, &statistics_input_params);
+ * if (bundle->dvs_statistics != NULL)
+ *     ia_dvs_set_statistics(dvs, bundle->dvs_statistics, ae_results, af_results, NULL, readout_start, readout_end);
+ * ia_isp_bxt_statistics_bundle_get_ltm_params(bundle, &ltm_input_params);
+ * \endcode
+ */
+
+#ifndef IA_ISP_BXT_STATISTICS_CONVERT_H_
+#define IA_ISP_BXT_STATISTICS_CONVERT_H_
+
+#include "ia_types.h"
+#include "ia_abstraction.h"
+#include "ia_aiq.h"
+#include "ia_dvs_types.h"
+#include "ia_isp_bxt.h"
+#include "ia_isp_bxt_statistics_types.h"
+#include "ia_isp_bxt_statistics_utils.h"
+#include "ia_isp_bxt_statistics_simd.h"
+#include "ia_ltm.h"
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*!
+ * \brief Frame parameters needed by the converters. Zero initialize the fields which are not used.
+ */
+typedef struct
+{
+    const ia_aiq_ir_weight_t *ir_weight;                    /*!< Mandatory for RGB-IR sensors, NULL otherwise. IR contamination grid. */
+    const ia_aiq_ae_results *ae_results;                    /*!< Mandatory for 2DP-SVE sensors and HDR statistics. Exposure parameters of the frame. */
+    const ia_isp_bxt_hdr_compression_t *hdr_compression;    /*!< Optional. NULL, if HDR statistics are in linear space. */
+    unsigned int stats_rgbs_hdr_block_pixel_width;          /*!< Mandatory for HDR statistics. Width of HDR RGBS block in pixels. */
+    unsigned int stats_rgbs_hdr_block_pixel_height;         /*!< Mandatory for HDR statistics. Height of HDR RGBS block in pixels. */
+    float r_gain;                                           /*!< Mandatory for HDR statistics. Gain applied to R before HDR statistics collection. */
+    float g_gain;                                           /*!< Mandatory for HDR statistics. Gain applied to G before HDR statistics collection. */
+    float b_gain;                                           /*!< Mandatory for HDR statistics. Gain applied to B before HDR statistics collection. */
+    unsigned int dvs_statistics_input_width;                /*!< Mandatory for motion vectors. 0 to skip DVS statistics. */
+    unsigned int dvs_statistics_input_height;               /*!< Mandatory for motion vectors. 0 to skip DVS statistics. */
+    unsigned int paf_statistics_input_width;                /*!< Mandatory for PAF grid. 0 to skip PAF statistics. */
+    unsigned int paf_statistics_input_height;               /*!< Mandatory for PAF grid. 0 to skip PAF statistics. */
+} ia_isp_bxt_statistics_convert_params;
+
+/*!
+ * \brief Converted statistics of one statistics binary. Counts are 0 and pointers NULL for statistics not present.
+ * Pointers are valid until the next conversion (to the bundle, ia_isp_bxt instance or statistics binary).
+ */
+typedef struct
+{
+    ia_isp_bxt_statistics_output output;                                /*!< Storage of the statistics converted in place. */
+    const ia_aiq_rgbs_grid *rgbs_grids[IA_AIQ_MAX_NUM_EXPOSURES];       /*!< RGBS grids, one per exposure. */
+    unsigned int num_rgbs_grids;                                        /*!< Number of RGBS grids. */
+    ia_aiq_hdr_rgbs_grid *hdr_rgbs_grid;                                /*!< HDR RGBS grid. */
+    const ia_aiq_af_grid *af_grids[1];                                  /*!< AF grid. */
+    unsigned int num_af_grids;                                          /*!< Number of AF grids. */
+    const ia_aiq_histogram *external_histograms[1];                     /*!< Histogram. */
+    unsigned int num_external_histograms;                               /*!< Number of histograms. */
+    const ia_aiq_depth_grid *depth_grids[1];                            /*!< PAF depth grid. */
+    unsigned int num_depth_grids;                                       /*!< Number of depth grids. */
+    ia_aiq_grid *ir_grid;                                               /*!< IR grid of RGB-IR sensors. */
+    ia_dvs_statistics *dvs_statistics;                                  /*!< DVS statistics for ia_dvs_set_statistics. */
+    const ia_isp_bxt_hdr_rgby_grid_t *hdr_rgby_grid;                    /*!< HDR RGBY grid record inside the statistics binary. */
+    const ia_isp_bxt_hdr_yv_grid_t *hdr_yv_grid;                        /*!< HDR YV grid record inside the statistics binary. */
+} ia_isp_bxt_statistics_bundle;
+
+/*!
+ * \brief Initializes statistics bundle. See ia_isp_bxt_statistics_output_init.
+ */
+static inline void
+ia_isp_bxt_statistics_bundle_init(ia_isp_bxt_statistics_bundle *bundle)
+{
+    memset(bundle, 0, sizeof(*bundle));
+    ia_isp_bxt_statistics_output_init(&bundle->output);
+}
+
+/*!
+ * \brief Sets converted RGBS grids to the bundle, up to one grid per exposure of ae_results (one grid if ae_results is NULL).
+ * Library converters return the grids as an array of pointers. Grids up to the first NULL pointer are set: sensors
+ * without multi-exposure statistics produce one grid also for multiple exposures.
+ */
+static inline void
+ia_isp_bxt_statistics_bundle_set_rgbs_grids(ia_isp_bxt_statistics_bundle *bundle,
+                                            const ia_aiq_ae_results *ae_results,
+                                            ia_aiq_rgbs_grid *const *rgbs_grids)
+{
+    unsigned int i, num_grids = 1;
+
+    if (ae_results != NULL && ae_results->num_exposures > 1)
+        num_grids = IA_MIN(ae_results->num_exposures, IA_AIQ_MAX_NUM_EXPOSURES);
+    for (i = 0; i < num_grids && rgbs_grids[i] != NULL; i++)
+        bundle->rgbs_grids[i] = rgbs_grids[i];
+    bundle->num_rgbs_grids = i;
+}
+
+/*!
+ * \brief Checks that the exposure count fits the grid pointer array given to the library converters.
+ */
+static inline bool
+ia_isp_bxt_statistics_num_exposures_valid(const ia_aiq_ae_results *ae_results)
+{
+    return ae_results == NULL || ae_results->num_exposures <= IA_AIQ_MAX_NUM_EXPOSURES;
+}
+
+/*!
+ * \brief Converts all statistics of a statistics binary.
+ * Walks the records once and dispatches every known record to its converter. Unknown records are skipped.
+ *
+ * \param[in]  ia_isp_bxt  Mandatory. ia_isp_bxt instance handle.
+ * \param[in]  statistics  Mandatory. Statistics in ISP specific format.
+ * \param[in]  params      Mandatory. Frame parameters needed by the converters.
+ * \param[out] bundle      Mandatory. Converted statistics. Initialized with ia_isp_bxt_statistics_bundle_init.
+ * \return                 Error code of the first failed conversion. ia_err_data, if a record is corrupted.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_convert_all(ia_isp_bxt *ia_isp_bxt,
+                                  const ia_binary_data *statistics,
+                                  const ia_isp_bxt_statistics_convert_params *params,
+                                  ia_isp_bxt_statistics_bundle *bundle)
+{
+    ia_isp_bxt_statistics_output *output;
+    const ia_isp_bxt_statistics_header_t *header;
+    unsigned int offset = 0;
+    ia_err err = ia_err_none;
+
+    if (ia_isp_bxt == NULL || statistics == NULL || params == NULL || bundle == NULL)
+        return ia_err_argument;
+    output = &bundle->output;
+    memset(bundle->rgbs_grids, 0, sizeof(bundle->rgbs_grids));
+    bundle->num_rgbs_grids = 0;
+    bundle->hdr_rgbs_grid = NULL;
+    bundle->num_af_grids = 0;
+    bundle->num_external_histograms = 0;
+    bundle->num_depth_grids = 0;
+    bundle->ir_grid = NULL;
+    bundle->dvs_statistics = NULL;
+    bundle->hdr_rgby_grid = NULL;
+    bundle->hdr_yv_grid = NULL;
+
+    while (err == ia_err_none && (header = ia_isp_bxt_statistics_next_record(statistics, &offset)) != NULL) {
+        ia_binary_data record;
+        record.data = (void *)header;
+        record.size = (unsigned int)header->size;
+
+        switch (header->uuid) {
+        case ia_isp_bxt_statistics_uuid_rgbs_grid:
+            if (record.size < sizeof(ia_isp_bxt_rgbs_grid_t)) {
+                err = ia_err_data;
+            } else if (params->ir_weight == NULL && (params->ae_results == NULL || params->ae_results->num_exposures <= 1)) {
+                const ia_isp_bxt_rgbs_grid_t *grid = (const ia_isp_bxt_rgbs_grid_t *)header;
+                err = ia_isp_bxt_rgbs_grid_pack(output->simd, grid, output->rgbs_blocks);
+                if (err == ia_err_none) {
+                    output->rgbs_grid.blocks_ptr = output->rgbs_blocks;
+                    output->rgbs_grid.grid_width = (unsigned short)grid->grid_width;
+                    output->rgbs_grid.grid_height = (unsigned short)grid->grid_height;
+                    output->rgbs_grid.shading_correction = true;
+                    ia_aiq_rgbs_grid *rgbs_grid = &output->rgbs_grid;
+                    ia_isp_bxt_statistics_bundle_set_rgbs_grids(bundle, NULL, &rgbs_grid);
+                }
+            } else if (!ia_isp_bxt_statistics_num_exposures_valid(params->ae_results)) {
+                err = ia_err_argument;
+            } else {
+                ia_isp_bxt_rgbs_grid_t *grid = (ia_isp_bxt_rgbs_grid_t *)record.data;
+                ia_aiq_rgbs_grid *rgbs_grids[IA_AIQ_MAX_NUM_EXPOSURES] = { NULL };
+                err = ia_isp_bxt_statistics_convert_awb_v2(ia_isp_bxt, (unsigned int)grid->grid_width, (unsigned int)grid->grid_height,
+                                                           grid->c0_avg, grid->c1_avg, grid->c2_avg, grid->c3_avg,
+                                                           grid->c4_avg, grid->c5_avg, grid->c6_avg, grid->c7_avg,
+                                                           grid->sat_ratio_0, grid->sat_ratio_1, grid->sat_ratio_2, grid->sat_ratio_3,
+                                                           params->ir_weight, params->ae_results, rgbs_grids,
+                                                           params->ir_weight != NULL ? &bundle->ir_grid : NULL);
+                if (err == ia_err_none)
+                    ia_isp_bxt_statistics_bundle_set_rgbs_grids(bundle, params->ae_results, rgbs_grids);
+            }
+            break;
+        case ia_isp_bxt_statistics_uuid_hdr_rgbs_grid:
+            if (record.size < sizeof(ia_isp_bxt_hdr_rgbs_grid_t)) {
+                err = ia_err_data;
+            } else if (!ia_isp_bxt_statistics_num_exposures_valid(params->ae_results)) {
+                err = ia_err_argument;
+            } else {
+                ia_isp_bxt_hdr_rgbs_grid_t *grid = (ia_isp_bxt_hdr_rgbs_grid_t *)record.data;
+                ia_aiq_rgbs_grid *rgbs_grids[IA_AIQ_MAX_NUM_EXPOSURES] = { NULL };
+                err = ia_isp_bxt_statistics_convert_awb_hdr_v2(ia_isp_bxt, (unsigned int)grid->grid_width, (unsigned int)grid->grid_height,
+                                                               grid->r_avg, grid->g_avg, grid->b_avg, grid->sat,
+                                                               params->ae_results, params->hdr_compression,
+                                                               params->stats_rgbs_hdr_block_pixel_width,
+                                                               params->stats_rgbs_hdr_block_pixel_height,
+                                                               params->r_gain, params->g_gain, params->b_gain,
+                                                               rgbs_grids, &bundle->hdr_rgbs_grid);
+                if (err == ia_err_none)
+                    ia_isp_bxt_statistics_bundle_set_rgbs_grids(bundle, params->ae_results, rgbs_grids);
+            }
+            break;
+        case ia_isp_bxt_statistics_uuid_filter_response_grid:
+            if (record.size < sizeof(ia_isp_bxt_filter_response_grid_t)) {
+                err = ia_err_data;
+            } else {
+                const ia_isp_bxt_filter_response_grid_t *grid = (const ia_isp_bxt_filter_response_grid_t *)header;
+                err = ia_isp_bxt_filter_response_grid_pack(output->simd, grid, output->filter_response_1, output->filter_response_2);
+                if (err == ia_err_none) {
+                    output->af_grid.grid_width = (unsigned short)grid->grid_width;
+                    output->af_grid.grid_height = (unsigned short)grid->grid_height;
+                    output->af_grid.block_width = 0;
+                    output->af_grid.block_height = 0;
+                    output->af_grid.filter_response_1 = output->filter_response_1;
+                    output->af_grid.filter_response_2 = output->filter_response_2;
+                    bundle->af_grids[0] = &output->af_grid;
+                    bundle->num_af_grids = 1;
+                }
+            }
+            break;
+        case ia_isp_bxt_statistics_uuid_histograms:
+        {
+            ia_aiq_histogram *histogram = NULL;
+            err = ia_isp_bxt_statistics_convert_ae_simd(&record, output, &histogram);
+            if (err == ia_err_none) {
+                bundle->external_histograms[0] = histogram;
+                bundle->num_external_histograms = 1;
+            }
+            break;
+        }
+        case ia_isp_bxt_statistics_uuid_motion_vectors:
+            if (params->dvs_statistics_input_width > 0 && params->dvs_statistics_input_height > 0)
+                err = ia_isp_bxt_statistics_convert_dvs_from_binary(ia_isp_bxt, &record,
+                                                                    params->dvs_statistics_input_width,
+                                                                    params->dvs_statistics_input_height,
+                                                                    &bundle->dvs_statistics);
+            break;
+        case ia_isp_bxt_statistics_uuid_paf_grid:
+            if (params->paf_statistics_input_width > 0 && params->paf_statistics_input_height > 0) {
+                ia_aiq_depth_grid *depth_grid = NULL;
+                err = ia_isp_bxt_statistics_convert_paf_from_binary(ia_isp_bxt, &record,
+                                                                    params->paf_statistics_input_width,
+                                                                    params->paf_statistics_input_height,
+                                                                    &depth_grid);
+                if (err == ia_err_none && depth_grid != NULL) {
+                    bundle->depth_grids[0] = depth_grid;
+                    bundle->num_depth_grids = 1;
+                }
+            }
+            break;
+        case ia_isp_bxt_statistics_uuid_hdr_rgby_grid:
+            if (record.size < sizeof(ia_isp_bxt_hdr_rgby_grid_t))
+                err = ia_err_data;
+            else
+                bundle->hdr_rgby_grid = (const ia_isp_bxt_hdr_rgby_grid_t *)header;
+            break;
+        case ia_isp_bxt_statistics_uuid_hdr_yv_grid:
+            if (record.size < sizeof(ia_isp_bxt_hdr_yv_grid_t))
+                err = ia_err_data;
+            else
+                bundle->hdr_yv_grid = (const ia_isp_bxt_hdr_yv_grid_t *)header;
+            break;
+        default:
+            break;
+        }
+    }
+    /* Records end before the data, if a record is corrupted. */
+    if (err == ia_err_none && offset < statistics->size)
+        return ia_err_data;
+    return err;
+}
+
+/*!
+ * \brief Sets the converted statistics to AIQ statistics input parameters.
+ * Statistics fields (rgbs_grids, hdr_rgbs_grid, af_grids, external_histograms, depth_grids and ir_grid) are replaced,
+ * other fields are left as they are.
+ */
+static inline void
+ia_isp_bxt_statistics_bundle_get_aiq_params(const ia_isp_bxt_statistics_bundle *bundle,
+                                            ia_aiq_statistics_input_params_v1 *statistics_input_params)
+{
+    statistics_input_params->rgbs_grids = bundle->num_rgbs_grids > 0 ? (const ia_aiq_rgbs_grid **)bundle->rgbs_grids : NULL;
+    statistics_input_params->num_rgbs_grids = bundle->num_rgbs_grids;
+    statistics_input_params->hdr_rgbs_grid = bundle->hdr_rgbs_grid;
+    statistics_input_params->af_grids = bundle->num_af_grids > 0 ? (const ia_aiq_af_grid **)bundle->af_grids : NULL;
+    statistics_input_params->num_af_grids = bundle->num_af_grids;
+    statistics_input_params->external_histograms =
+        bundle->num_external_histograms > 0 ? (const ia_aiq_histogram **)bundle->external_histograms : NULL;
+    statistics_input_params->num_external_histograms = bundle->num_external_histograms;
+    statistics_input_params->depth_grids = bundle->num_depth_grids > 0 ? (const ia_aiq_depth_grid **)bundle->depth_grids : NULL;
+    statistics_input_params->num_depth_grids = bundle->num_depth_grids;
+    statistics_input_params->ir_grid = bundle->ir_grid;
+}
+
+/*!
+ * \brief Sets the converted statistics to LTM input parameters.
+ * Statistics fields (yv_grid, rgbs_grid_ptr and hdr_rgbs_grid_ptr) are replaced, other fields are left as they are.
+ */
+static inline void
+ia_isp_bxt_statistics_bundle_get_ltm_params(const ia_isp_bxt_statistics_bundle *bundle,
+                                            ia_ltm_input_params *ltm_input_params)
+{
+    ltm_input_params->yv_grid = (ia_isp_bxt_hdr_yv_grid_t *)bundle->hdr_yv_grid;
+    ltm_input_params->rgbs_grid_ptr = bundle->num_rgbs_grids > 0 ? (ia_aiq_rgbs_grid *)bundle->rgbs_grids[0] : NULL;
+    ltm_input_params->hdr_rgbs_grid_ptr = bundle->hdr_rgbs_grid;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IA_ISP_BXT_STATISTICS_CONVERT_H_ */
@@ -0,0 +1,1046 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_isp_bxt_statistics_simd.h
+ * \brief Vectorized conversion of BXT ISP statistics to IA_AIQ format.
+ *
+ * Same conversions as ia_isp_bxt_statistics_convert_awb_from_binary_v2, ia_isp_bxt_statistics_convert_af_from_binary
+ * and ia_isp_bxt_statistics_convert_ae_from_binary for single exposure statistics, with bit exact results:
+ * - RGBS grid: averages and saturation ratios are clamped to [0, 255] and packed into rgbs_grid_block.
+ *   Saturation ratios of block i are in sat_ratio_(i % 4)[i / 4].
+ * - Filter response grid: filter responses 1 and 2 are the 12 bit Y10 and Y11 responses. Saturated response (4095)
+ *   is replaced with eight times the 12 bit Y00 or Y01 response.
+ * - Histograms: C0, C1, C2 and C3 histograms are R, G, B and Y histograms. Element counts are the sums of the bins.
+ *
+ * - HDR RGBS grid: same conversion as ia_isp_bxt_statistics_convert_awb_hdr_from_binary_v2. Averages are decompressed,
+ *   gains are reverted and the result is de-stitched into one 8 bit RGBS grid per exposure.
+ *
+ * Instruction set is selected at run time (ia_isp_bxt_simd_detect): AVX2 (32 blocks per iteration), SSE2 (16 blocks
+ * per iteration) or plain C. All give the same output. RGB-IR and multi-exposure (2DP-SVE) statistics are converted
+ * with ia_isp_bxt.h.
+ *
+ * Converted statistics are stored in client owned ia_isp_bxt_statistics_output (ia_isp_bxt_hdr_statistics_output for
+ * HDR statistics), which can be reused for every frame.
+ */
+
+#ifndef IA_ISP_BXT_STATISTICS_SIMD_H_
+#define IA_ISP_BXT_STATISTICS_SIMD_H_
+
+#include "ia_types.h"
+#include "ia_aiq_types.h"
+#include "ia_cmc_types.h"
+#include "ia_aiq_statistics_view.h"
+#include "ia_isp_bxt_statistics_types.h"
+#include "ia_isp_bxt_statistics_utils.h"
+#include "ia_isp_bxt_types.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IA_ISP_BXT_SIMD_HAS_SSE2
+#include <emmintrin.h>
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))) || defined(_MSC_VER)
+#define IA_ISP_BXT_SIMD_HAS_AVX2
+#include <immintrin.h>
+#if defined(__GNUC__)
+#define IA_ISP_BXT_SIMD_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#include <intrin.h>
+#define IA_ISP_BXT_SIMD_AVX2_TARGET
+#endif
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*!
+ * \brief Instruction sets of the conversions.
+ */
+typedef enum
+{
+    ia_isp_bxt_simd_none,    /*!< Plain C. */
+    ia_isp_bxt_simd_sse2,    /*!< SSE2. */
+    ia_isp_bxt_simd_avx2     /*!< AVX2. */
+} ia_isp_bxt_simd;
+
+/*!
+ * \brief Detects the best instruction set supported by the CPU.
+ */
+static inline ia_isp_bxt_simd
+ia_isp_bxt_simd_detect(void)
+{
+#if defined(IA_ISP_BXT_SIMD_HAS_AVX2)
+#if defined(__GNUC__)
+    if (__builtin_cpu_supports("avx2"))
+        return ia_isp_bxt_simd_avx2;
+#else
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        /* AVX with OSXSAVE, and YMM state enabled by the OS. */
+        if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(info, 7, 0);
+            if (info[1] & (1 << 5))
+                return ia_isp_bxt_simd_avx2;
+        }
+    }
+#endif
+#endif
+#if defined(IA_ISP_BXT_SIMD_HAS_SSE2)
+    return ia_isp_bxt_simd_sse2;
+#else
+    return ia_isp_bxt_simd_none;
+#endif
+}
+
+/*!
+ * \brief Converted statistics. Client allocates the structure and initializes it with ia_isp_bxt_statistics_output_init.
+ */
+typedef struct
+{
+    ia_isp_bxt_simd simd;                                                   /*!< Instruction set used in conversions. Detected at init, can be overridden. */
+    ia_aiq_rgbs_grid rgbs_grid;                                             /*!< Converted RGBS grid. */
+    rgbs_grid_block rgbs_blocks[BXT_RGBS_GRID_MAX_NUM_ELEMENTS];            /*!< Blocks of the converted RGBS grid. */
+    ia_aiq_af_grid af_grid;                                                 /*!< Converted AF grid. */
+    int filter_response_1[BXT_FILTER_RESPONSE_GRID_MAX_NUM_ELEMENTS];       /*!< Filter response 1 of the converted AF grid. */
+    int filter_response_2[BXT_FILTER_RESPONSE_GRID_MAX_NUM_ELEMENTS];       /*!< Filter response 2 of the converted AF grid. */
+    ia_aiq_histogram histogram;                                             /*!< Converted histogram. */
+    unsigned int histogram_r[BXT_HISTOGRAM_BINS];                           /*!< R histogram. */
+    unsigned int histogram_g[BXT_HISTOGRAM_BINS];                           /*!< G histogram. */
+    unsigned int histogram_b[BXT_HISTOGRAM_BINS];                           /*!< B histogram. */
+    unsigned int histogram_y[BXT_HISTOGRAM_BINS];                           /*!< Y histogram. */
+} ia_isp_bxt_statistics_output;
+
+/*!
+ * \brief Initializes converted statistics and selects the instruction set.
+ */
+static inline void
+ia_isp_bxt_statistics_output_init(ia_isp_bxt_statistics_output *output)
+{
+    memset(output, 0, sizeof(*output));
+    output->simd = ia_isp_bxt_simd_detect();
+}
+
+/*!
+ * \brief Converted HDR statistics. Client allocates the structure and initializes it with ia_isp_bxt_hdr_statistics_output_init.
+ */
+typedef struct
+{
+    ia_isp_bxt_simd simd;                                                                   /*!< Instruction set used in conversions. Detected at init, can be overridden. */
+    ia_aiq_hdr_rgbs_grid hdr_rgbs_grid;                                                     /*!< Combined HDR RGBS grid. */
+    hdr_rgbs_grid_block hdr_rgbs_blocks[BXT_RGBS_GRID_MAX_NUM_ELEMENTS];                    /*!< Blocks of the combined HDR RGBS grid. */
+    ia_aiq_rgbs_grid rgbs_grids[IA_AIQ_MAX_NUM_EXPOSURES];                                  /*!< De-stitched RGBS grids, one per exposure. */
+    rgbs_grid_block rgbs_blocks[IA_AIQ_MAX_NUM_EXPOSURES][BXT_RGBS_GRID_MAX_NUM_ELEMENTS];  /*!< Blocks of the de-stitched RGBS grids. */
+} ia_isp_bxt_hdr_statistics_output;
+
+/*!
+ * \brief Initializes converted HDR statistics and selects the instruction set.
+ */
+static inline void
+ia_isp_bxt_hdr_statistics_output_init(ia_isp_bxt_hdr_statistics_output *output)
+{
+    memset(output, 0, sizeof(*output));
+    output->simd = ia_isp_bxt_simd_detect();
+}
+
+/*!
+ * \brief Parameters of HDR RGBS grid de-stitching, resolved once per frame.
+ */
+typedef struct
+{
+    const ia_isp_bxt_hdr_rgbs_grid_t *grid;                     /*!< HDR RGBS grid record. */
+    bool compressed;                                            /*!< If true, averages are decompressed. */
+    ia_isp_bxt_hdr_y_compression_method_t method;               /*!< Decompression method. */
+    unsigned int shift;                                         /*!< Decompression shift, 2 * output_bpp - input_bpp. */
+    float inv_r_gain;                                           /*!< Reciprocal of the R gain. */
+    float inv_g_gain;                                           /*!< Reciprocal of the G gain. */
+    float inv_b_gain;                                           /*!< Reciprocal of the B gain. */
+    unsigned int num_exposures;                                 /*!< Number of de-stitched grids. */
+    float thresholds[IA_AIQ_MAX_NUM_EXPOSURES];                 /*!< Saturation level of each exposure in HDR values. */
+    hdr_rgbs_grid_block *hdr_blocks;                            /*!< Blocks of the combined HDR RGBS grid. */
+    rgbs_grid_block *blocks[IA_AIQ_MAX_NUM_EXPOSURES];          /*!< Blocks of the de-stitched grids. */
+} ia_isp_bxt_hdr_destitch_params;
+
+static inline void
+ia_isp_bxt_rgbs_grid_pack_c(const ia_isp_bxt_rgbs_grid_t *grid,
+                            unsigned int first,
+                            unsigned int count,
+                            rgbs_grid_block *blocks)
+{
+    const int32_t *sat[4] = { grid->sat_ratio_0, grid->sat_ratio_1, grid->sat_ratio_2, grid->sat_ratio_3 };
+    unsigned int i;
+
+    for (i = first; i < count; i++) {
+        blocks[i].avg_gr = ia_aiq_rgbs_view_clamp(grid->c0_avg[i]);
+        blocks[i].avg_r = ia_aiq_rgbs_view_clamp(grid->c1_avg[i]);
+        blocks[i].avg_b = ia_aiq_rgbs_view_clamp(grid->c2_avg[i]);
+        blocks[i].avg_gb = ia_aiq_rgbs_view_clamp(grid->c3_avg[i]);
+        blocks[i].sat = ia_aiq_rgbs_view_clamp(sat[i & 3][i >> 2]);
+    }
+}
+
+static inline void
+ia_isp_bxt_filter_response_grid_pack_c(const ia_isp_bxt_filter_response_grid_t *grid,
+                                       unsigned int first,
+                                       unsigned int count,
+                                       int *filter_response_1,
+                                       int *filter_response_2)
+{
+    unsigned int i;
+
+    for (i = first; i < count; i++) {
+        int32_t y10 = grid->y10_avg[i] & 0xFFF;
+        int32_t y11 = grid->y11_avg[i] & 0xFFF;
+        filter_response_1[i] = y10 == 0xFFF ? (grid->y00_avg[i] & 0xFFF) * 8 : y10;
+        filter_response_2[i] = y11 == 0xFFF ? (grid->y01_avg[i] & 0xFFF) * 8 : y11;
+    }
+}
+
+/*!
+ * \brief Reverts the gain of a decompressed HDR average. Truncated to 64 bits as in the library: out of range and NaN
+ * give 0 in the low 32 bits.
+ */
+static inline uint32_t
+ia_isp_bxt_hdr_revert_gain(int32_t value, float inv_gain)
+{
+    float x = (float)value * inv_gain;
+    return x >= -9223372036854775808.0f && x < 9223372036854775808.0f ? (uint32_t)(int64_t)x : 0u;
+}
+
+/*!
+ * \brief Scales an HDR value to [0, 255] of one exposure. Out of range (NaN) gives 0, as the low byte of cvttss2si.
+ */
+static inline unsigned char
+ia_isp_bxt_hdr_destitch_value(uint32_t value, float threshold)
+{
+    float v = (float)value;
+    float y = (v > threshold ? threshold : v) * 255.0f / threshold;
+    return y >= -2147483648.0f && y < 2147483648.0f ? (unsigned char)(int32_t)y : 0;
+}
+
+static inline void
+ia_isp_bxt_hdr_rgbs_grid_destitch_c(const ia_isp_bxt_hdr_destitch_params *params, unsigned int first, unsigned int count)
+{
+    const ia_isp_bxt_hdr_rgbs_grid_t *grid = params->grid;
+    unsigned int i, e;
+
+    for (i = first; i < count; i++) {
+        int32_t r = grid->r_avg[i];
+        int32_t g = grid->g_avg[i];
+        int32_t b = grid->b_avg[i];
+        uint32_t hdr_r, hdr_g, hdr_b;
+
+        if (params->compressed) {
+            int32_t m;
+            if (params->method == ia_isp_bxt_hdr_y_decompression_max_rgb) {
+                m = r > g ? r : g;
+                m = m > b ? m : b;
+            } else {
+                m = (int32_t)((uint32_t)r + 2u * (uint32_t)g + (uint32_t)b) >> 2;
+            }
+            /* 32 bit products, arithmetic shift. */
+            r = (int32_t)((uint32_t)r * (uint32_t)m) >> params->shift;
+            g = (int32_t)((uint32_t)g * (uint32_t)m) >> params->shift;
+            b = (int32_t)((uint32_t)b * (uint32_t)m) >> params->shift;
+        }
+        hdr_r = ia_isp_bxt_hdr_revert_gain(r, params->inv_r_gain);
+        hdr_g = ia_isp_bxt_hdr_revert_gain(g, params->inv_g_gain);
+        hdr_b = ia_isp_bxt_hdr_revert_gain(b, params->inv_b_gain);
+        params->hdr_blocks[i].avg_gr = hdr_g;
+        params->hdr_blocks[i].avg_r = hdr_r;
+        params->hdr_blocks[i].avg_b = hdr_b;
+        params->hdr_blocks[i].avg_gb = hdr_g;
+        params->hdr_blocks[i].sat = 0;
+        for (e = 0; e < params->num_exposures; e++) {
+            rgbs_grid_block *block = &params->blocks[e][i];
+            block->avg_gr = ia_isp_bxt_hdr_destitch_value(hdr_g, params->thresholds[e]);
+            block->avg_r = ia_isp_bxt_hdr_destitch_value(hdr_r, params->thresholds[e]);
+            block->avg_b = ia_isp_bxt_hdr_destitch_value(hdr_b, params->thresholds[e]);
+            block->avg_gb = block->avg_gr;
+            block->sat = 0;
+        }
+    }
+}
+
+#if defined(IA_ISP_BXT_SIMD_HAS_SSE2)
+/*!
+ * \brief Packs 16 values to bytes clamped to [0, 255]. Saturating packs are monotonic, so the result equals clamping.
+ */
+static inline __m128i
+ia_isp_bxt_simd_pack_sse2(__m128i v0, __m128i v1, __m128i v2, __m128i v3)
+{
+    return _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3));
+}
+
+/*!
+ * \brief Clamps 16 values to [0, 255].
+ */
+static inline __m128i
+ia_isp_bxt_simd_clamp_sse2(const int32_t *values)
+{
+    return ia_isp_bxt_simd_pack_sse2(_mm_loadu_si128((const __m128i *)values), _mm_loadu_si128((const __m128i *)(values + 4)),
+                                     _mm_loadu_si128((const __m128i *)(values + 8)), _mm_loadu_si128((const __m128i *)(values + 12)));
+}
+
+/*!
+ * \brief Clamps saturation ratios of blocks [4 * k, 4 * k + 15] to [0, 255] in block order.
+ */
+static inline __m128i
+ia_isp_bxt_simd_clamp_sat_sse2(const int32_t *const sat[4], unsigned int k)
+{
+    __m128i p0 = _mm_loadu_si128((const __m128i *)(sat[0] + k));
+    __m128i p1 = _mm_loadu_si128((const __m128i *)(sat[1] + k));
+    __m128i p2 = _mm_loadu_si128((const __m128i *)(sat[2] + k));
+    __m128i p3 = _mm_loadu_si128((const __m128i *)(sat[3] + k));
+    __m128i t0 = _mm_unpacklo_epi32(p0, p1);
+    __m128i t1 = _mm_unpacklo_epi32(p2, p3);
+    __m128i t2 = _mm_unpackhi_epi32(p0, p1);
+    __m128i t3 = _mm_unpackhi_epi32(p2, p3);
+    return _mm_packus_epi16(_mm_packs_epi32(_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1)),
+                            _mm_packs_epi32(_mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)));
+}
+
+static inline void
+ia_isp_bxt_rgbs_grid_pack_sse2(const ia_isp_bxt_rgbs_grid_t *grid,
+                               unsigned int first,
+                               unsigned int count,
+                               rgbs_grid_block *blocks)
+{
+    const int32_t *const sat[4] = { grid->sat_ratio_0, grid->sat_ratio_1, grid->sat_ratio_2, grid->sat_ratio_3 };
+    uint8_t channels[5][16];
+    unsigned int i, j;
+
+    for (i = first; i + 16 <= count; i += 16) {
+        _mm_storeu_si128((__m128i *)channels[0], ia_isp_bxt_simd_clamp_sse2(grid->c0_avg + i));
+        _mm_storeu_si128((__m128i *)channels[1], ia_isp_bxt_simd_clamp_sse2(grid->c1_avg + i));
+        _mm_storeu_si128((__m128i *)channels[2], ia_isp_bxt_simd_clamp_sse2(grid->c2_avg + i));
+        _mm_storeu_si128((__m128i *)channels[3], ia_isp_bxt_simd_clamp_sse2(grid->c3_avg + i));
+        _mm_storeu_si128((__m128i *)channels[4], ia_isp_bxt_simd_clamp_sat_sse2(sat, i >> 2));
+        for (j = 0; j < 16; j++) {
+            blocks[i + j].avg_gr = channels[0][j];
+            blocks[i + j].avg_r = channels[1][j];
+            blocks[i + j].avg_b = channels[2][j];
+            blocks[i + j].avg_gb = channels[3][j];
+            blocks[i + j].sat = channels[4][j];
+        }
+    }
+    ia_isp_bxt_rgbs_grid_pack_c(grid, i, count, blocks);
+}
+
+static inline __m128i
+ia_isp_bxt_simd_af_response_sse2(const int32_t *response, const int32_t *fallback)
+{
+    const __m128i mask = _mm_set1_epi32(0xFFF);
+    __m128i value = _mm_and_si128(_mm_loadu_si128((const __m128i *)response), mask);
+    __m128i scaled = _mm_slli_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i *)fallback), mask), 3);
+    __m128i saturated = _mm_cmpeq_epi32(value, mask);
+    return _mm_or_si128(_mm_and_si128(saturated, scaled), _mm_andnot_si128(saturated, value));
+}
+
+static inline void
+ia_isp_bxt_filter_response_grid_pack_sse2(const ia_isp_bxt_filter_response_grid_t *grid,
+                                          unsigned int count,
+                                          int *filter_response_1,
+                                          int *filter_response_2)
+{
+    unsigned int i;
+
+    for (i = 0; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i *)(filter_response_1 + i), ia_isp_bxt_simd_af_response_sse2(grid->y10_avg + i, grid->y00_avg + i));
+        _mm_storeu_si128((__m128i *)(filter_response_2 + i), ia_isp_bxt_simd_af_response_sse2(grid->y11_avg + i, grid->y01_avg + i));
+    }
+    ia_isp_bxt_filter_response_grid_pack_c(grid, i, count, filter_response_1, filter_response_2);
+}
+
+/*!
+ * \brief Low 32 bits of 32 bit products. SSE2 has only the 32 x 32 -> 64 bit multiply of even lanes.
+ */
+static inline __m128i
+ia_isp_bxt_simd_mullo_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i
+ia_isp_bxt_simd_max_sse2(__m128i a, __m128i b)
+{
+    __m128i greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+}
+
+/*!
+ * \brief Exact conversion of unsigned 32 bit values to float. Both halves are exact, so the sum is rounded once.
+ */
+static inline __m128
+ia_isp_bxt_simd_u32_to_ps_sse2(__m128i values)
+{
+    __m128 hi = _mm_cvtepi32_ps(_mm_srli_epi32(values, 16));
+    __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(values, _mm_set1_epi32(0xFFFF)));
+    return _mm_add_ps(_mm_mul_ps(hi, _mm_set1_ps(65536.0f)), lo);
+}
+
+/*!
+ * \brief Scales HDR values to [0, 255] of one exposure. min(threshold, v) keeps v for NaN threshold, as the library.
+ * Results are in [0, 255] or 0x80000000 (NaN), which packs to 0 as its low byte.
+ */
+static inline __m128i
+ia_isp_bxt_simd_hdr_destitch_sse2(__m128 values, __m128 threshold)
+{
+    return _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(_mm_min_ps(threshold, values), _mm_set1_ps(255.0f)), threshold));
+}
+
+static inline void
+ia_isp_bxt_hdr_rgbs_grid_destitch_sse2(const ia_isp_bxt_hdr_destitch_params *params, unsigned int first, unsigned int count)
+{
+    const ia_isp_bxt_hdr_rgbs_grid_t *grid = params->grid;
+    const __m128i invalid = _mm_set1_epi32((int)0x80000000);
+    const __m128i shift = _mm_cvtsi32_si128((int)params->shift);
+    const __m128 inv_gains[3] = { _mm_set1_ps(params->inv_g_gain), _mm_set1_ps(params->inv_r_gain), _mm_set1_ps(params->inv_b_gain) };
+    const int32_t *const avgs[3] = { grid->g_avg, grid->r_avg, grid->b_avg };
+    uint32_t values[3][16];
+    uint8_t channels[3][16];
+    __m128 floats[3][4];
+    unsigned int i, j, q, c, e;
+
+    /* Channels in order G, R, B. G is written to both Gr and Gb. */
+    for (i = first; i + 16 <= count; i += 16) {
+        __m128i failed = _mm_setzero_si128();
+        for (q = 0; q < 4; q++) {
+            __m128i avg[3], multiplier = _mm_setzero_si128();
+            for (c = 0; c < 3; c++)
+                avg[c] = _mm_loadu_si128((const __m128i *)(avgs[c] + i + 4 * q));
+            if (params->compressed) {
+                if (params->method == ia_isp_bxt_hdr_y_decompression_max_rgb)
+                    multiplier = ia_isp_bxt_simd_max_sse2(ia_isp_bxt_simd_max_sse2(avg[0], avg[1]), avg[2]);
+                else
+                    multiplier = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(avg[1], _mm_slli_epi32(avg[0], 1)), avg[2]), 2);
+            }
+            for (c = 0; c < 3; c++) {
+                __m128i value = avg[c];
+                if (params->compressed)
+                    value = _mm_sra_epi32(ia_isp_bxt_simd_mullo_sse2(value, multiplier), shift);
+                value = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(value), inv_gains[c]));
+                failed = _mm_or_si128(failed, _mm_cmpeq_epi32(value, invalid));
+                _mm_storeu_si128((__m128i *)(values[c] + 4 * q), value);
+                floats[c][q] = ia_isp_bxt_simd_u32_to_ps_sse2(value);
+            }
+        }
+        /* Beyond int32, the library keeps the low 32 bits of a 64 bit conversion. Rare, done in C. */
+        if (_mm_movemask_epi8(failed) != 0) {
+            ia_isp_bxt_hdr_rgbs_grid_destitch_c(params, i, i + 16);
+            continue;
+        }
+        for (j = 0; j < 16; j++) {
+            params->hdr_blocks[i + j].avg_gr = values[0][j];
+            params->hdr_blocks[i + j].avg_r = values[1][j];
+            params->hdr_blocks[i + j].avg_b = values[2][j];
+            params->hdr_blocks[i + j].avg_gb = values[0][j];
+            params->hdr_blocks[i + j].sat = 0;
+        }
+        for (e = 0; e < params->num_exposures; e++) {
+            const __m128 threshold = _mm_set1_ps(params->thresholds[e]);
+            rgbs_grid_block *blocks = params->blocks[e];
+            for (c = 0; c < 3; c++) {
+                _mm_storeu_si128((__m128i *)channels[c],
+                                 ia_isp_bxt_simd_pack_sse2(ia_isp_bxt_simd_hdr_destitch_sse2(floats[c][0], threshold),
+                                                           ia_isp_bxt_simd_hdr_destitch_sse2(floats[c][1], threshold),
+                                                           ia_isp_bxt_simd_hdr_destitch_sse2(floats[c][2], threshold),
+                                                           ia_isp_bxt_simd_hdr_destitch_sse2(floats[c][3], threshold)));
+            }
+            for (j = 0; j < 16; j++) {
+                blocks[i + j].avg_gr = channels[0][j];
+                blocks[i + j].avg_r = channels[1][j];
+                blocks[i + j].avg_b = channels[2][j];
+                blocks[i + j].avg_gb = channels[0][j];
+                blocks[i + j].sat = 0;
+            }
+        }
+    }
+    ia_isp_bxt_hdr_rgbs_grid_destitch_c(params, i, count);
+}
+#endif
+
+#if defined(IA_ISP_BXT_SIMD_HAS_AVX2)
+/*!
+ * \brief Packs 32 values to bytes clamped to [0, 255]. Packs work within 128 bit lanes, so the result is permuted back to order.
+ */
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline __m256i
+ia_isp_bxt_simd_pack_avx2(__m256i v0, __m256i v1, __m256i v2, __m256i v3)
+{
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    return _mm256_permutevar8x32_epi32(_mm256_packus_epi16(_mm256_packs_epi32(v0, v1), _mm256_packs_epi32(v2, v3)), order);
+}
+
+/*!
+ * \brief Clamps 32 values to [0, 255].
+ */
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline __m256i
+ia_isp_bxt_simd_clamp_avx2(const int32_t *values)
+{
+    return ia_isp_bxt_simd_pack_avx2(_mm256_loadu_si256((const __m256i *)values), _mm256_loadu_si256((const __m256i *)(values + 8)),
+                                     _mm256_loadu_si256((const __m256i *)(values + 16)), _mm256_loadu_si256((const __m256i *)(values + 24)));
+}
+
+/*!
+ * \brief Clamps saturation ratios of blocks [4 * k, 4 * k + 31] to [0, 255] in block order.
+ */
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline __m256i
+ia_isp_bxt_simd_clamp_sat_avx2(const int32_t *const sat[4], unsigned int k)
+{
+    __m256i p0 = _mm256_loadu_si256((const __m256i *)(sat[0] + k));
+    __m256i p1 = _mm256_loadu_si256((const __m256i *)(sat[1] + k));
+    __m256i p2 = _mm256_loadu_si256((const __m256i *)(sat[2] + k));
+    __m256i p3 = _mm256_loadu_si256((const __m256i *)(sat[3] + k));
+    __m256i t0 = _mm256_unpacklo_epi32(p0, p1);
+    __m256i t1 = _mm256_unpacklo_epi32(p2, p3);
+    __m256i t2 = _mm256_unpackhi_epi32(p0, p1);
+    __m256i t3 = _mm256_unpackhi_epi32(p2, p3);
+    return _mm256_packus_epi16(_mm256_packs_epi32(_mm256_unpacklo_epi64(t0, t1), _mm256_unpackhi_epi64(t0, t1)),
+                               _mm256_packs_epi32(_mm256_unpacklo_epi64(t2, t3), _mm256_unpackhi_epi64(t2, t3)));
+}
+
+/*!
+ * \brief Interleaves 16 blocks of the five channels into 80 bytes of rgbs_grid_block.
+ */
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline void
+ia_isp_bxt_simd_interleave_avx2(const __m128i channels[5], const __m128i masks[5][5], uint8_t *dst)
+{
+    unsigned int v;
+
+    for (v = 0; v < 5; v++) {
+        __m128i out = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(channels[0], masks[v][0]),
+                                                _mm_shuffle_epi8(channels[1], masks[v][1])),
+                                   _mm_or_si128(_mm_shuffle_epi8(channels[2], masks[v][2]),
+                                                _mm_shuffle_epi8(channels[3], masks[v][3])));
+        _mm_storeu_si128((__m128i *)(dst + 16 * v), _mm_or_si128(out, _mm_shuffle_epi8(channels[4], masks[v][4])));
+    }
+}
+
+/*!
+ * \brief Shuffle masks of ia_isp_bxt_simd_interleave_avx2.
+ */
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline void
+ia_isp_bxt_simd_interleave_masks_avx2(__m128i masks[5][5])
+{
+    uint8_t mask_bytes[5][5][16];
+    unsigned int v, c, b;
+
+    /* Byte b of output vector v is component (16 * v + b) % 5 of block (16 * v + b) / 5. */
+    for (v = 0; v < 5; v++) {
+        for (c = 0; c < 5; c++) {
+            for (b = 0; b < 16; b++)
+                mask_bytes[v][c][b] = (16 * v + b) % 5 == c ? (uint8_t)((16 * v + b) / 5) : 0x80;
+            masks[v][c] = _mm_loadu_si128((const __m128i *)mask_bytes[v][c]);
+        }
+    }
+}
+
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline void
+ia_isp_bxt_rgbs_grid_pack_avx2(const ia_isp_bxt_rgbs_grid_t *grid, unsigned int count, rgbs_grid_block *blocks)
+{
+    const int32_t *const sat[4] = { grid->sat_ratio_0, grid->sat_ratio_1, grid->sat_ratio_2, grid->sat_ratio_3 };
+    __m128i masks[5][5], lo[5], hi[5];
+    __m256i channels[5];
+    unsigned int i, c;
+
+    ia_isp_bxt_simd_interleave_masks_avx2(masks);
+    for (i = 0; i + 32 <= count; i += 32) {
+        channels[0] = ia_isp_bxt_simd_clamp_avx2(grid->c0_avg + i);
+        channels[1] = ia_isp_bxt_simd_clamp_avx2(grid->c1_avg + i);
+        channels[2] = ia_isp_bxt_simd_clamp_avx2(grid->c2_avg + i);
+        channels[3] = ia_isp_bxt_simd_clamp_avx2(grid->c3_avg + i);
+        channels[4] = ia_isp_bxt_simd_clamp_sat_avx2(sat, i >> 2);
+        for (c = 0; c < 5; c++) {
+            lo[c] = _mm256_castsi256_si128(channels[c]);
+            hi[c] = _mm256_extracti128_si256(channels[c], 1);
+        }
+        ia_isp_bxt_simd_interleave_avx2(lo, (const __m128i (*)[5])masks, (uint8_t *)(blocks + i));
+        ia_isp_bxt_simd_interleave_avx2(hi, (const __m128i (*)[5])masks, (uint8_t *)(blocks + i + 16));
+    }
+    ia_isp_bxt_rgbs_grid_pack_sse2(grid, i, count, blocks);
+}
+
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline __m256i
+ia_isp_bxt_simd_af_response_avx2(const int32_t *response, const int32_t *fallback)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFFF);
+    __m256i value = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)response), mask);
+    __m256i scaled = _mm256_slli_epi32(_mm256_and_si256(_mm256_loadu_si256((const __m256i *)fallback), mask), 3);
+    return _mm256_blendv_epi8(value, scaled, _mm256_cmpeq_epi32(value, mask));
+}
+
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline void
+ia_isp_bxt_filter_response_grid_pack_avx2(const ia_isp_bxt_filter_response_grid_t *grid,
+                                          unsigned int count,
+                                          int *filter_response_1,
+                                          int *filter_response_2)
+{
+    unsigned int i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i *)(filter_response_1 + i), ia_isp_bxt_simd_af_response_avx2(grid->y10_avg + i, grid->y00_avg + i));
+        _mm256_storeu_si256((__m256i *)(filter_response_2 + i), ia_isp_bxt_simd_af_response_avx2(grid->y11_avg + i, grid->y01_avg + i));
+    }
+    ia_isp_bxt_filter_response_grid_pack_c(grid, i, count, filter_response_1, filter_response_2);
+}
+
+/*!
+ * \brief Exact conversion of unsigned 32 bit values to float. Both halves are exact, so the sum is rounded once.
+ */
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline __m256
+ia_isp_bxt_simd_u32_to_ps_avx2(__m256i values)
+{
+    __m256 hi = _mm256_cvtepi32_ps(_mm256_srli_epi32(values, 16));
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_and_si256(values, _mm256_set1_epi32(0xFFFF)));
+    return _mm256_add_ps(_mm256_mul_ps(hi, _mm256_set1_ps(65536.0f)), lo);
+}
+
+/*!
+ * \brief Scales HDR values to [0, 255] of one exposure, as ia_isp_bxt_simd_hdr_destitch_sse2.
+ */
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline __m256i
+ia_isp_bxt_simd_hdr_destitch_avx2(__m256 values, __m256 threshold)
+{
+    return _mm256_cvttps_epi32(_mm256_div_ps(_mm256_mul_ps(_mm256_min_ps(threshold, values), _mm256_set1_ps(255.0f)), threshold));
+}
+
+IA_ISP_BXT_SIMD_AVX2_TARGET static inline void
+ia_isp_bxt_hdr_rgbs_grid_destitch_avx2(const ia_isp_bxt_hdr_destitch_params *params, unsigned int count)
+{
+    const ia_isp_bxt_hdr_rgbs_grid_t *grid = params->grid;
+    const __m256i invalid = _mm256_set1_epi32((int)0x80000000);
+    const __m128i shift = _mm_cvtsi32_si128((int)params->shift);
+    const __m256 inv_gains[3] = { _mm256_set1_ps(params->inv_g_gain), _mm256_set1_ps(params->inv_r_gain), _mm256_set1_ps(params->inv_b_gain) };
+    const int32_t *const avgs[3] = { grid->g_avg, grid->r_avg, grid->b_avg };
+    uint32_t values[3][32];
+    __m128i masks[5][5], lo[5], hi[5];
+    __m256 floats[3][4];
+    unsigned int i, j, q, c, e;
+
+    ia_isp_bxt_simd_interleave_masks_avx2(masks);
+    /* Saturation of the de-stitched grids is 0. */
+    lo[4] = _mm_setzero_si128();
+    hi[4] = _mm_setzero_si128();
+    for (i = 0; i + 32 <= count; i += 32) {
+        __m256i failed = _mm256_setzero_si256();
+        for (q = 0; q < 4; q++) {
+            __m256i avg[3], multiplier = _mm256_setzero_si256();
+            for (c = 0; c < 3; c++)
+                avg[c] = _mm256_loadu_si256((const __m256i *)(avgs[c] + i + 8 * q));
+            if (params->compressed) {
+                if (params->method == ia_isp_bxt_hdr_y_decompression_max_rgb)
+                    multiplier = _mm256_max_epi32(_mm256_max_epi32(avg[0], avg[1]), avg[2]);
+                else
+                    multiplier = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(avg[1], _mm256_slli_epi32(avg[0], 1)), avg[2]), 2);
+            }
+            for (c = 0; c < 3; c++) {
+                __m256i value = avg[c];
+                if (params->compressed)
+                    value = _mm256_sra_epi32(_mm256_mullo_epi32(value, multiplier), shift);
+                value = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(value), inv_gains[c]));
+                failed = _mm256_or_si256(failed, _mm256_cmpeq_epi32(value, invalid));
+                _mm256_storeu_si256((__m256i *)(values[c] + 8 * q), value);
+                floats[c][q] = ia_isp_bxt_simd_u32_to_ps_avx2(value);
+            }
+        }
+        if (_mm256_movemask_epi8(failed) != 0) {
+            ia_isp_bxt_hdr_rgbs_grid_destitch_c(params, i, i + 32);
+            continue;
+        }
+        for (j = 0; j < 32; j++) {
+            params->hdr_blocks[i + j].avg_gr = values[0][j];
+            params->hdr_blocks[i + j].avg_r = values[1][j];
+            params->hdr_blocks[i + j].avg_b = values[2][j];
+            params->hdr_blocks[i + j].avg_gb = values[0][j];
+            params->hdr_blocks[i + j].sat = 0;
+        }
+        for (e = 0; e < params->num_exposures; e++) {
+            const __m256 threshold = _mm256_set1_ps(params->thresholds[e]);
+            for (c = 0; c < 3; c++) {
+                __m256i channel = ia_isp_bxt_simd_pack_avx2(ia_isp_bxt_simd_hdr_destitch_avx2(floats[c][0], threshold),
+                                                            ia_isp_bxt_simd_hdr_destitch_avx2(floats[c][1], threshold),
+                                                            ia_isp_bxt_simd_hdr_destitch_avx2(floats[c][2], threshold),
+                                                            ia_isp_bxt_simd_hdr_destitch_avx2(floats[c][3], threshold));
+                lo[c] = _mm256_castsi256_si128(channel);
+                hi[c] = _mm256_extracti128_si256(channel, 1);
+            }
+            /* Gb equals Gr. */
+            lo[3] = lo[0];
+            hi[3] = hi[0];
+            ia_isp_bxt_simd_interleave_avx2(lo, (const __m128i (*)[5])masks, (uint8_t *)(params->blocks[e] + i));
+            ia_isp_bxt_simd_interleave_avx2(hi, (const __m128i (*)[5])masks, (uint8_t *)(params->blocks[e] + i + 16));
+        }
+    }
+    ia_isp_bxt_hdr_rgbs_grid_destitch_sse2(params, i, count);
+}
+#endif
+
+/*!
+ * \brief Packs RGBS grid record into AIQ RGBS blocks.
+ *
+ * \param[in]  simd       Mandatory. Instruction set. Must be supported by the CPU.
+ * \param[in]  grid       Mandatory. RGBS grid record.
+ * \param[out] blocks     Mandatory. Storage of at least grid_width * grid_height blocks.
+ * \return                Error code.
+ */
+static inline ia_err
+ia_isp_bxt_rgbs_grid_pack(ia_isp_bxt_simd simd, const ia_isp_bxt_rgbs_grid_t *grid, rgbs_grid_block *blocks)
+{
+    unsigned int count;
+
+    if (grid == NULL || blocks == NULL)
+        return ia_err_argument;
+    if (grid->grid_width <= 0 || grid->grid_height <= 0 ||
+        grid->grid_width * grid->grid_height > BXT_RGBS_GRID_MAX_NUM_ELEMENTS)
+        return ia_err_data;
+    count = (unsigned int)(grid->grid_width * grid->grid_height);
+#if defined(IA_ISP_BXT_SIMD_HAS_AVX2)
+    if (simd == ia_isp_bxt_simd_avx2) {
+        ia_isp_bxt_rgbs_grid_pack_avx2(grid, count, blocks);
+        return ia_err_none;
+    }
+#endif
+#if defined(IA_ISP_BXT_SIMD_HAS_SSE2)
+    if (simd != ia_isp_bxt_simd_none) {
+        ia_isp_bxt_rgbs_grid_pack_sse2(grid, 0, count, blocks);
+        return ia_err_none;
+    }
+#endif
+    (void)simd;
+    ia_isp_bxt_rgbs_grid_pack_c(grid, 0, count, blocks);
+    return ia_err_none;
+}
+
+/*!
+ * \brief Packs filter response grid record into AIQ filter responses.
+ *
+ * \param[in]  simd              Mandatory. Instruction set. Must be supported by the CPU.
+ * \param[in]  grid              Mandatory. Filter response grid record.
+ * \param[out] filter_response_1 Mandatory. Storage of at least grid_width * grid_height values.
+ * \param[out] filter_response_2 Mandatory. Storage of at least grid_width * grid_height values.
+ * \return                       Error code.
+ */
+static inline ia_err
+ia_isp_bxt_filter_response_grid_pack(ia_isp_bxt_simd simd,
+                                     const ia_isp_bxt_filter_response_grid_t *grid,
+                                     int *filter_response_1,
+                                     int *filter_response_2)
+{
+    unsigned int count;
+
+    if (grid == NULL || filter_response_1 == NULL || filter_response_2 == NULL)
+        return ia_err_argument;
+    if (grid->grid_width <= 0 || grid->grid_height <= 0 ||
+        grid->grid_width * grid->grid_height > BXT_FILTER_RESPONSE_GRID_MAX_NUM_ELEMENTS)
+        return ia_err_data;
+    count = (unsigned int)(grid->grid_width * grid->grid_height);
+#if defined(IA_ISP_BXT_SIMD_HAS_AVX2)
+    if (simd == ia_isp_bxt_simd_avx2) {
+        ia_isp_bxt_filter_response_grid_pack_avx2(grid, count, filter_response_1, filter_response_2);
+        return ia_err_none;
+    }
+#endif
+#if defined(IA_ISP_BXT_SIMD_HAS_SSE2)
+    if (simd != ia_isp_bxt_simd_none) {
+        ia_isp_bxt_filter_response_grid_pack_sse2(grid, count, filter_response_1, filter_response_2);
+        return ia_err_none;
+    }
+#endif
+    (void)simd;
+    ia_isp_bxt_filter_response_grid_pack_c(grid, 0, count, filter_response_1, filter_response_2);
+    return ia_err_none;
+}
+
+/*!
+ * \brief Converts RGBS grid of BXT ISP statistics to IA_AIQ format.
+ *
+ * \param[in]  statistics    Mandatory. Statistics in ISP specific format.
+ * \param[in]  output        Mandatory. Converted statistics.
+ * \param[out] out_rgbs_grid Mandatory. Pointer to the converted RGBS grid inside output.
+ * \return                   Error code. ia_err_data, if statistics don't contain RGBS grid.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_convert_awb_simd(const ia_binary_data *statistics,
+                                       ia_isp_bxt_statistics_output *output,
+                                       ia_aiq_rgbs_grid **out_rgbs_grid)
+{
+    const ia_isp_bxt_statistics_header_t *header;
+    const ia_isp_bxt_rgbs_grid_t *grid;
+    ia_err err;
+
+    if (output == NULL || out_rgbs_grid == NULL)
+        return ia_err_argument;
+    header = ia_isp_bxt_statistics_find_record(statistics, ia_isp_bxt_statistics_uuid_rgbs_grid);
+    if (header == NULL || (size_t)header->size < sizeof(ia_isp_bxt_rgbs_grid_t))
+        return ia_err_data;
+    grid = (const ia_isp_bxt_rgbs_grid_t *)header;
+    err = ia_isp_bxt_rgbs_grid_pack(output->simd, grid, output->rgbs_blocks);
+    if (err != ia_err_none)
+        return err;
+    output->rgbs_grid.blocks_ptr = output->rgbs_blocks;
+    output->rgbs_grid.grid_width = (unsigned short)grid->grid_width;
+    output->rgbs_grid.grid_height = (unsigned short)grid->grid_height;
+    output->rgbs_grid.shading_correction = true;
+    *out_rgbs_grid = &output->rgbs_grid;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Converts filter response grid of BXT ISP statistics to IA_AIQ format.
+ *
+ * \param[in]  statistics  Mandatory. Statistics in ISP specific format.
+ * \param[in]  output      Mandatory. Converted statistics.
+ * \param[out] out_af_grid Mandatory. Pointer to the converted AF grid inside output.
+ * \return                 Error code. ia_err_data, if statistics don't contain filter response grid.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_convert_af_simd(const ia_binary_data *statistics,
+                                      ia_isp_bxt_statistics_output *output,
+                                      ia_aiq_af_grid **out_af_grid)
+{
+    const ia_isp_bxt_statistics_header_t *header;
+    const ia_isp_bxt_filter_response_grid_t *grid;
+    ia_err err;
+
+    if (output == NULL || out_af_grid == NULL)
+        return ia_err_argument;
+    header = ia_isp_bxt_statistics_find_record(statistics, ia_isp_bxt_statistics_uuid_filter_response_grid);
+    if (header == NULL || (size_t)header->size < sizeof(ia_isp_bxt_filter_response_grid_t))
+        return ia_err_data;
+    grid = (const ia_isp_bxt_filter_response_grid_t *)header;
+    err = ia_isp_bxt_filter_response_grid_pack(output->simd, grid, output->filter_response_1, output->filter_response_2);
+    if (err != ia_err_none)
+        return err;
+    output->af_grid.grid_width = (unsigned short)grid->grid_width;
+    output->af_grid.grid_height = (unsigned short)grid->grid_height;
+    output->af_grid.block_width = 0;
+    output->af_grid.block_height = 0;
+    output->af_grid.filter_response_1 = output->filter_response_1;
+    output->af_grid.filter_response_2 = output->filter_response_2;
+    *out_af_grid = &output->af_grid;
+    return ia_err_none;
+}
+
+static inline unsigned int
+ia_isp_bxt_histogram_copy(const int32_t *src, unsigned int *dst)
+{
+    unsigned int i, sum = 0;
+
+    memcpy(dst, src, BXT_HISTOGRAM_BINS * sizeof(unsigned int));
+    for (i = 0; i < BXT_HISTOGRAM_BINS; i++)
+        sum += dst[i];
+    return sum;
+}
+
+/*!
+ * \brief Converts histograms of BXT ISP statistics to IA_AIQ format.
+ * Combined RGB histograms are not available (NULL), as in ia_isp_bxt_statistics_convert_ae_from_binary.
+ *
+ * \param[in]  statistics        Mandatory. Statistics in ISP specific format.
+ * \param[in]  output            Mandatory. Converted statistics.
+ * \param[out] out_aiq_histogram Mandatory. Pointer to the converted histogram inside output.
+ * \return                       Error code. ia_err_data, if statistics don't contain histograms.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_convert_ae_simd(const ia_binary_data *statistics,
+                                      ia_isp_bxt_statistics_output *output,
+                                      ia_aiq_histogram **out_aiq_histogram)
+{
+    const ia_isp_bxt_statistics_header_t *header;
+    const ia_isp_bxt_histograms_t *histograms;
+    ia_aiq_histogram *histogram;
+
+    if (output == NULL || out_aiq_histogram == NULL)
+        return ia_err_argument;
+    header = ia_isp_bxt_statistics_find_record(statistics, ia_isp_bxt_statistics_uuid_histograms);
+    if (header == NULL || (size_t)header->size < sizeof(ia_isp_bxt_histograms_t))
+        return ia_err_data;
+    histograms = (const ia_isp_bxt_histograms_t *)header;
+    histogram = &output->histogram;
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->num_bins = BXT_HISTOGRAM_BINS;
+    histogram->r = output->histogram_r;
+    histogram->g = output->histogram_g;
+    histogram->b = output->histogram_b;
+    histogram->y = output->histogram_y;
+    histogram->num_r_elements = ia_isp_bxt_histogram_copy(histograms->hist_c0, output->histogram_r);
+    /* Element counts of G and B are swapped in ia_isp_bxt_statistics_convert_ae_from_binary. Kept for exact results. */
+    histogram->num_b_elements = ia_isp_bxt_histogram_copy(histograms->hist_c1, output->histogram_g);
+    histogram->num_g_elements = ia_isp_bxt_histogram_copy(histograms->hist_c2, output->histogram_b);
+    histogram->num_y_elements = ia_isp_bxt_histogram_copy(histograms->hist_c3, output->histogram_y);
+    *out_aiq_histogram = histogram;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Calculates the saturation level of each exposure in HDR values, as ia_isp_bxt_statistics_convert_awb_hdr_v2.
+ * Exposure ratio of exposure i is the total target exposure of the longest (last) exposure divided by that of exposure i.
+ *
+ * \param[in]  ae_results    Mandatory. Exposure parameters of the frame.
+ * \param[in]  bit_depth     Mandatory. Bit depth of the HDR data.
+ * \param[out] thresholds    Mandatory. Saturation level of each exposure.
+ * \return                   Error code. ia_err_argument, if exposure parameters are missing or there are too many exposures.
+ */
+static inline ia_err
+ia_isp_bxt_hdr_destitch_thresholds(const ia_aiq_ae_results *ae_results,
+                                   unsigned int bit_depth,
+                                   float thresholds[IA_AIQ_MAX_NUM_EXPOSURES])
+{
+    float ratios[IA_AIQ_MAX_NUM_EXPOSURES];
+    float longest;
+    unsigned int i;
+
+    if (ae_results == NULL || ae_results->exposures == NULL ||
+        ae_results->num_exposures == 0 || ae_results->num_exposures > IA_AIQ_MAX_NUM_EXPOSURES)
+        return ia_err_argument;
+    for (i = 0; i < ae_results->num_exposures; i++) {
+        if (ae_results->exposures[i].exposure == NULL)
+            return ia_err_argument;
+    }
+    longest = (float)ae_results->exposures[ae_results->num_exposures - 1].exposure->total_target_exposure;
+    for (i = 0; i < ae_results->num_exposures; i++)
+        ratios[i] = longest / (float)ae_results->exposures[i].exposure->total_target_exposure;
+    for (i = 0; i < ae_results->num_exposures; i++)
+        thresholds[i] = ((float)(1u << (bit_depth & 31)) - 1.0f) * ratios[i] / ratios[0];
+    return ia_err_none;
+}
+
+/*!
+ * \brief De-stitches HDR RGBS grid record into AIQ RGBS blocks, one grid per exposure.
+ *
+ * \param[in]  simd          Mandatory. Instruction set. Must be supported by the CPU.
+ * \param[in]  params        Mandatory. De-stitching parameters.
+ * \return                   Error code.
+ */
+static inline ia_err
+ia_isp_bxt_hdr_rgbs_grid_destitch(ia_isp_bxt_simd simd, const ia_isp_bxt_hdr_destitch_params *params)
+{
+    const ia_isp_bxt_hdr_rgbs_grid_t *grid;
+    unsigned int count;
+
+    if (params == NULL || params->grid == NULL || params->hdr_blocks == NULL ||
+        params->num_exposures > IA_AIQ_MAX_NUM_EXPOSURES)
+        return ia_err_argument;
+    grid = params->grid;
+    if (grid->grid_width <= 0 || grid->grid_height <= 0 ||
+        grid->grid_width * grid->grid_height > BXT_RGBS_GRID_MAX_NUM_ELEMENTS)
+        return ia_err_data;
+    count = (unsigned int)(grid->grid_width * grid->grid_height);
+#if defined(IA_ISP_BXT_SIMD_HAS_AVX2)
+    if (simd == ia_isp_bxt_simd_avx2) {
+        ia_isp_bxt_hdr_rgbs_grid_destitch_avx2(params, count);
+        return ia_err_none;
+    }
+#endif
+#if defined(IA_ISP_BXT_SIMD_HAS_SSE2)
+    if (simd != ia_isp_bxt_simd_none) {
+        ia_isp_bxt_hdr_rgbs_grid_destitch_sse2(params, 0, count);
+        return ia_err_none;
+    }
+#endif
+    (void)simd;
+    ia_isp_bxt_hdr_rgbs_grid_destitch_c(params, 0, count);
+    return ia_err_none;
+}
+
+/*!
+ * \brief Converts HDR RGBS grid of BXT ISP statistics to IA_AIQ format.
+ * Same results as ia_isp_bxt_statistics_convert_awb_hdr_from_binary_v2 with the ia_isp_bxt instance initialized with
+ * ia_cmc. Saturation of all blocks is 0, as in the library.
+ *
+ * \param[in]  statistics        Mandatory. Statistics in ISP specific format.
+ * \param[in]  ia_cmc            Mandatory. Parsed camera module characterization. Bit depth of the HDR data is cmc_general_data->bit_depth.
+ * \param[in]  ae_results        Mandatory. Exposure parameters of the frame. One de-stitched grid per exposure.
+ * \param[in]  hdr_compression   Optional. NULL, if HDR statistics are already in linear space (no compression).
+ * \param[in]  r_gain            Mandatory. Gain applied to the R color channel before HDR statistic collection.
+ * \param[in]  g_gain            Mandatory. Gain applied to the G color channel before HDR statistic collection.
+ * \param[in]  b_gain            Mandatory. Gain applied to the B color channel before HDR statistic collection.
+ * \param[in]  output            Mandatory. Converted statistics.
+ * \param[out] out_rgbs_grids    Mandatory. Pointer to the array of de-stitched grids inside output, one per exposure.
+ * \param[out] out_hdr_rgbs_grid Optional. Pointer to the combined HDR RGBS grid inside output.
+ * \return                       Error code. ia_err_data, if statistics don't contain HDR RGBS grid.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_convert_awb_hdr_simd(const ia_binary_data *statistics,
+                                           const ia_cmc_t *ia_cmc,
+                                           const ia_aiq_ae_results *ae_results,
+                                           const ia_isp_bxt_hdr_compression_t *hdr_compression,
+                                           float r_gain,
+                                           float g_gain,
+                                           float b_gain,
+                                           ia_isp_bxt_hdr_statistics_output *output,
+                                           ia_aiq_rgbs_grid **out_rgbs_grids,
+                                           ia_aiq_hdr_rgbs_grid **out_hdr_rgbs_grid)
+{
+    const ia_isp_bxt_statistics_header_t *header;
+    ia_isp_bxt_hdr_destitch_params params;
+    unsigned int bit_depth, e;
+    ia_err err;
+
+    if (ia_cmc == NULL || ia_cmc->cmc_general_data == NULL || output == NULL || out_rgbs_grids == NULL)
+        return ia_err_argument;
+    header = ia_isp_bxt_statistics_find_record(statistics, ia_isp_bxt_statistics_uuid_hdr_rgbs_grid);
+    if (header == NULL || (size_t)header->size < sizeof(ia_isp_bxt_hdr_rgbs_grid_t))
+        return ia_err_data;
+    bit_depth = ia_cmc->cmc_general_data->bit_depth;
+    err = ia_isp_bxt_hdr_destitch_thresholds(ae_results, bit_depth, params.thresholds);
+    if (err != ia_err_none)
+        return err;
+    params.grid = (const ia_isp_bxt_hdr_rgbs_grid_t *)header;
+    params.compressed = hdr_compression != NULL;
+    params.method = hdr_compression != NULL ? hdr_compression->y_compression_method : ia_isp_bxt_hdr_y_decompression_max_rgb;
+    params.shift = hdr_compression != NULL ?
+        (unsigned int)(2 * hdr_compression->bpp_info.output_bpp - hdr_compression->bpp_info.input_bpp) & 31 : 0;
+    params.inv_r_gain = 1.0f / r_gain;
+    params.inv_g_gain = 1.0f / g_gain;
+    params.inv_b_gain = 1.0f / b_gain;
+    params.num_exposures = ae_results->num_exposures;
+    params.hdr_blocks = output->hdr_rgbs_blocks;
+    for (e = 0; e < params.num_exposures; e++)
+        params.blocks[e] = output->rgbs_blocks[e];
+    err = ia_isp_bxt_hdr_rgbs_grid_destitch(output->simd, &params);
+    if (err != ia_err_none)
+        return err;
+    output->hdr_rgbs_grid.blocks_ptr = output->hdr_rgbs_blocks;
+    output->hdr_rgbs_grid.grid_width = (unsigned int)params.grid->grid_width;
+    output->hdr_rgbs_grid.grid_height = (unsigned int)params.grid->grid_height;
+    output->hdr_rgbs_grid.grid_data_bit_depth = bit_depth;
+    output->hdr_rgbs_grid.shading_correction = true;
+    for (e = 0; e < params.num_exposures; e++) {
+        output->rgbs_grids[e].blocks_ptr = output->rgbs_blocks[e];
+        output->rgbs_grids[e].grid_width = (unsigned short)params.grid->grid_width;
+        output->rgbs_grids[e].grid_height = (unsigned short)params.grid->grid_height;
+        output->rgbs_grids[e].shading_correction = true;
+    }
+    *out_rgbs_grids = output->rgbs_grids;
+    if (out_hdr_rgbs_grid != NULL)
+        *out_hdr_rgbs_grid = &output->hdr_rgbs_grid;
+    return ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IA_ISP_BXT_STATISTICS_SIMD_H_ */
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_isp_bxt_statistics_utils.h
+ * \brief In place access to records of BXT ISP statistics binary.
+ *
+ * Statistics binary is a chain of records, each starting with ia_isp_bxt_statistics_header_t. Records follow each other
+ * with their size rounded up to multiple of 8 bytes.
+ */
+
+#ifndef IA_ISP_BXT_STATISTICS_UTILS_H_
+#define IA_ISP_BXT_STATISTICS_UTILS_H_
+
+#include "ia_types.h"
+#include "ia_aiq_statistics_view.h"
+#include "ia_isp_bxt_statistics_types.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*!
+ * \brief Iterates records of statistics binary.
+ * Note! Returned pointer always points inside the given statistics buffer.
+ *
+ * \param[in]     statistics  Mandatory. Statistics in ISP specific format.
+ * \param[in,out] offset      Mandatory. Offset of the record, 0 for the first record. Advanced to the next record.
+ * \return                    Pointer to the record header or NULL at the end of statistics (or if statistics are corrupted).
+ */
+static inline const ia_isp_bxt_statistics_header_t *
+ia_isp_bxt_statistics_next_record(const ia_binary_data *statistics,
+                                  unsigned int *offset)
+{
+    const ia_isp_bxt_statistics_header_t *header;
+
+    if (statistics == NULL || statistics->data == NULL || offset == NULL ||
+        *offset + sizeof(ia_isp_bxt_statistics_header_t) > statistics->size)
+        return NULL;
+
+    header = (const ia_isp_bxt_statistics_header_t *)((const char *)statistics->data + *offset);
+    if (header->size < (int32_t)sizeof(ia_isp_bxt_statistics_header_t) ||
+        (unsigned int)header->size > statistics->size - *offset)
+        return NULL;
+    *offset += ((unsigned int)header->size + 7) & ~7u;
+    return header;
+}
+
+/*!
+ * \brief Finds a record from statistics binary.
+ * Note! Returned pointer always points inside the given statistics buffer.
+ *
+ * \param[in] statistics  Mandatory. Statistics in ISP specific format.
+ * \param[in] uuid        Mandatory. Record to find. See ia_isp_bxt_statistics_uuid.
+ * \return                Pointer to the record header or NULL, if record is not found.
+ */
+static inline const ia_isp_bxt_statistics_header_t *
+ia_isp_bxt_statistics_find_record(const ia_binary_data *statistics,
+                                  ia_isp_bxt_statistics_uuid uuid)
+{
+    const ia_isp_bxt_statistics_header_t *header;
+    unsigned int offset = 0;
+
+    while ((header = ia_isp_bxt_statistics_next_record(statistics, &offset)) != NULL) {
+        if (header->uuid == (int32_t)uuid)
+            return header;
+    }
+    return NULL;
+}
+
+/*!
+ * \brief Describes RGBS grid record in place as AIQ RGBS grid view.
+ *
+ * \param[in]  rgbs_grid  Mandatory. RGBS grid record.
+ * \param[out] view       Mandatory. View to the record data. Valid as long as the record is.
+ * \return                Error code.
+ */
+static inline ia_err
+ia_isp_bxt_rgbs_grid_get_view(const ia_isp_bxt_rgbs_grid_t *rgbs_grid,
+                              ia_aiq_rgbs_grid_view *view)
+{
+    if (rgbs_grid == NULL || view == NULL ||
+        rgbs_grid->grid_width <= 0 || rgbs_grid->grid_height <= 0 ||
+        rgbs_grid->grid_width * rgbs_grid->grid_height > BXT_RGBS_GRID_MAX_NUM_ELEMENTS)
+        return ia_err_data;
+
+    view->avg_gr = rgbs_grid->c0_avg;
+    view->avg_r = rgbs_grid->c1_avg;
+    view->avg_b = rgbs_grid->c2_avg;
+    view->avg_gb = rgbs_grid->c3_avg;
+    view->sat[0] = rgbs_grid->sat_ratio_0;
+    view->sat[1] = rgbs_grid->sat_ratio_1;
+    view->sat[2] = rgbs_grid->sat_ratio_2;
+    view->sat[3] = rgbs_grid->sat_ratio_3;
+    view->row_stride = (unsigned int)rgbs_grid->grid_width;
+    view->grid_width = (unsigned short)rgbs_grid->grid_width;
+    view->grid_height = (unsigned short)rgbs_grid->grid_height;
+    view->shading_correction = false;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Gets RGBS grid view pointing inside the given statistics binary.
+ *
+ * \param[in]  statistics  Mandatory. Statistics in ISP specific format.
+ * \param[out] view        Mandatory. View to the RGBS grid record inside the statistics buffer.
+ * \return                 Error code. ia_err_data, if statistics don't contain RGBS grid.
+ */
+static inline ia_err
+ia_isp_bxt_statistics_get_rgbs_grid_view(const ia_binary_data *statistics,
+                                         ia_aiq_rgbs_grid_view *view)
+{
+    const ia_isp_bxt_statistics_header_t *header =
+        ia_isp_bxt_statistics_find_record(statistics, ia_isp_bxt_statistics_uuid_rgbs_grid);
+
+    if (view == NULL)
+        return ia_err_argument;
+    if (header == NULL || (size_t)header->size < sizeof(ia_isp_bxt_rgbs_grid_t))
+        return ia_err_data;
+    return ia_isp_bxt_rgbs_grid_get_view((const ia_isp_bxt_rgbs_grid_t *)header, view);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IA_ISP_BXT_STATISTICS_UTILS_H_ */
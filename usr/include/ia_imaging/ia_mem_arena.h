@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_mem_arena.h
+ * \brief Fixed budget memory arena and measurement of initialization footprint.
+ *
+ * ia_mem_arena carves allocations out of one client given memory region with a byte budget. The region can be allocated,
+ * pre-faulted with ia_mem_arena_prefault and locked (mlock) by the client once per camera, after which allocations from
+ * the arena never touch the global heap nor cause page faults. Use it for per-frame buffers owned by client, such as
+ * statistics blocks, copies of results and makernote data.
+ *
+ * ia_mem_arena_get_env gives an ia_mem_env whose hooks allocate from an arena, for libraries which take an ia_mem_env
+ * (ia_cp_init). The context argument of the hooks is the arena.
+ *
+ * ia_aiq_init, ia_isp_bxt_init, ia_ltm_init and ia_dvs_init don't take an ia_mem_env: their memory comes from the C library
+ * heap and the libraries don't report their worst-case footprint up front. The footprint can only be measured after init:
+ * ia_mem_footprint_begin and ia_mem_footprint_end measure how much heap initialization took, so that the heap can be
+ * sized, pre-faulted and locked (mlockall) for the next camera opens. The result depends on the tuning and the init
+ * parameters (e.g. statistics grid size), so measure with the configuration used in the product and leave a margin.
+ * Measurement is process wide: other threads must not allocate while measuring.
+ */
+
+#ifndef _IA_MEM_ARENA_H_
+#define _IA_MEM_ARENA_H_
+
+#include "ia_types.h"
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Alignment of all arena allocations in bytes.
+ */
+#define IA_MEM_ARENA_ALIGNMENT 16
+
+/*!
+ * \brief Stride used when touching arena memory in ia_mem_arena_prefault.
+ */
+#define IA_MEM_ARENA_PAGE_SIZE 4096
+
+/*!
+ * \brief Memory arena.
+ */
+typedef struct
+{
+    unsigned char *base;    /*!< Start of the region. */
+    size_t size;            /*!< Byte budget of the arena. */
+    size_t used;            /*!< Bytes currently allocated, including alignment padding. */
+    size_t peak;            /*!< Largest value of used since ia_mem_arena_init. */
+} ia_mem_arena;
+
+/*!
+ * \brief Initializes arena on top of a client owned region.
+ *
+ * \param[out] arena   Mandatory. Arena.
+ * \param[in]  buffer  Mandatory. Start of the region. Must stay valid as long as the arena is used.
+ * \param[in]  size    Mandatory. Size of the region in bytes.
+ * \return             Error code.
+ */
+static inline ia_err
+ia_mem_arena_init(ia_mem_arena *arena, void *buffer, size_t size)
+{
+    if (arena == NULL || buffer == NULL || size == 0)
+        return ia_err_argument;
+    arena->base = (unsigned char *)buffer;
+    arena->size = size;
+    arena->used = 0;
+    arena->peak = 0;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Allocates memory from arena.
+ * Returned memory is aligned to IA_MEM_ARENA_ALIGNMENT bytes and is not initialized.
+ *
+ * \param[in,out] arena  Mandatory. Arena.
+ * \param[in]     size   Mandatory. Number of bytes.
+ * \return               Pointer to the memory or NULL, if the budget is exceeded.
+ */
+static inline void *
+ia_mem_arena_alloc(ia_mem_arena *arena, size_t size)
+{
+    uintptr_t address, aligned;
+    size_t offset;
+
+    if (arena == NULL || size == 0)
+        return NULL;
+
+    address = (uintptr_t)arena->base + arena->used;
+    aligned = (address + (IA_MEM_ARENA_ALIGNMENT - 1)) & ~(uintptr_t)(IA_MEM_ARENA_ALIGNMENT - 1);
+    offset = arena->used + (size_t)(aligned - address);
+    if (offset > arena->size || size > arena->size - offset)
+        return NULL;
+
+    arena->used = offset + size;
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+    return arena->base + offset;
+}
+
+/*!
+ * \brief Returns current allocation position of arena.
+ * Memory allocated after the mark can be released at once with ia_mem_arena_release, e.g. scratch memory of one frame.
+ */
+static inline size_t
+ia_mem_arena_mark(const ia_mem_arena *arena)
+{
+    return arena != NULL ? arena->used : 0;
+}
+
+/*!
+ * \brief Releases all memory allocated after the given mark.
+ */
+static inline void
+ia_mem_arena_release(ia_mem_arena *arena, size_t mark)
+{
+    if (arena != NULL && mark <= arena->used)
+        arena->used = mark;
+}
+
+/*!
+ * \brief Releases all memory of arena. Peak usage is retained.
+ */
+static inline void
+ia_mem_arena_reset(ia_mem_arena *arena)
+{
+    ia_mem_arena_release(arena, 0);
+}
+
+/*!
+ * \brief Touches every page of the arena region so that the pages are mapped before real-time use.
+ * Region contents are set to zero.
+ */
+static inline void
+ia_mem_arena_prefault(ia_mem_arena *arena)
+{
+    volatile unsigned char *page;
+    size_t offset;
+
+    if (arena == NULL || arena->base == NULL)
+        return;
+    page = arena->base;
+    for (offset = 0; offset < arena->size; offset += IA_MEM_ARENA_PAGE_SIZE)
+        page[offset] = 0;
+    page[arena->size - 1] = 0;
+}
+
+static inline void *
+ia_mem_arena_env_alloc(void *arena, size_t size)
+{
+    return ia_mem_arena_alloc((ia_mem_arena *)arena, size);
+}
+
+/*!
+ * \brief Frees arena memory given through ia_mem_env.
+ * Only the latest allocation is returned to the arena, other memory is released with ia_mem_arena_reset.
+ */
+static inline void
+ia_mem_arena_env_free(void *arena, void *usr_ptr, size_t size)
+{
+    ia_mem_arena *mem_arena = (ia_mem_arena *)arena;
+    unsigned char *end;
+
+    if (mem_arena == NULL || usr_ptr == NULL)
+        return;
+    end = (unsigned char *)usr_ptr + size;
+    /* Nothing is allocated after usr_ptr, if less than alignment is used after it. */
+    if ((unsigned char *)usr_ptr >= mem_arena->base && end <= mem_arena->base + mem_arena->used &&
+        (size_t)(mem_arena->base + mem_arena->used - end) < IA_MEM_ARENA_ALIGNMENT)
+        mem_arena->used = (size_t)((unsigned char *)usr_ptr - mem_arena->base);
+}
+
+/*!
+ * \brief Gets memory environment which allocates from an arena.
+ * Give the arena as the context of the hooks (e.g. ia_acceleration isp for ia_cp_init).
+ *
+ * \param[out] mem_env  Mandatory. Memory environment.
+ */
+static inline void
+ia_mem_arena_get_env(ia_mem_env *mem_env)
+{
+    if (mem_env == NULL)
+        return;
+    mem_env->alloc = ia_mem_arena_env_alloc;
+    mem_env->free = ia_mem_arena_env_free;
+}
+
+/*!
+ * \brief Heap footprint measurement.
+ */
+typedef struct
+{
+    size_t start;   /*!< Heap usage when measurement was started. */
+    size_t bytes;   /*!< Heap growth between ia_mem_footprint_begin and ia_mem_footprint_end. */
+} ia_mem_footprint;
+
+static inline size_t
+ia_mem_heap_in_use(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo info = mallinfo();
+    return (size_t)(unsigned int)info.uordblks + (size_t)(unsigned int)info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/*!
+ * \brief Starts measuring heap footprint.
+ * Call e.g. before ia_aiq_init and ia_mem_footprint_end after it to get the footprint of an AIQ instance. Footprint is
+ * known only after init, not up front.
+ * On platforms without heap statistics the footprint is always 0.
+ *
+ * \param[out] footprint  Mandatory. Measurement.
+ */
+static inline void
+ia_mem_footprint_begin(ia_mem_footprint *footprint)
+{
+    if (footprint == NULL)
+        return;
+    footprint->start = ia_mem_heap_in_use();
+    footprint->bytes = 0;
+}
+
+/*!
+ * \brief Ends measuring heap footprint.
+ *
+ * \param[in,out] footprint  Mandatory. Measurement started with ia_mem_footprint_begin.
+ * \return                   Heap growth in bytes since ia_mem_footprint_begin.
+ */
+static inline size_t
+ia_mem_footprint_end(ia_mem_footprint *footprint)
+{
+    size_t now;
+
+    if (footprint == NULL)
+        return 0;
+    now = ia_mem_heap_in_use();
+    footprint->bytes = now > footprint->start ? now - footprint->start : 0;
+    return footprint->bytes;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_MEM_ARENA_H_ */
@@ -0,0 +1,431 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_mkn_codec.h
+ * \brief Fast compression of prepared makernote data into a client buffer.
+ *
+ * ia_mkn_prepare_into prepares the makernote and compresses it directly from the makernote buffer into a client buffer
+ * (for example EXIF APP segment), so no intermediate copy is made. Compressed data is a packed makernote: an
+ * ia_mkn_packed_header followed by the makernote (MKNT) data compressed with the selected codec.
+ *
+ * ia_mkn_codec_lz is the LZ4 block format: single pass greedy matching with a 4K entry hash table, so it compresses
+ * hundreds of megabytes per second. Decompression only copies bytes.
+ *
+ * Packed makernote is converted back into MKNT data with ia_mkn_unpack, after which ia_mkn_is_valid,
+ * ia_mkn_get_record etc. are used as with ia_mkn_prepare output.
+ */
+
+#ifndef _IA_MKN_CODEC_H_
+#define _IA_MKN_CODEC_H_
+
+#include "ia_mkn_encoder.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Tag of packed makernote data ('MKNZ').
+ */
+#define IA_MKN_PACKED_TAG 0x4D4B4E5A
+
+/*!
+ * \brief Codecs of packed makernote data.
+ */
+typedef enum
+{
+    ia_mkn_codec_none = 0,   /*!< Makernote data is copied as is. */
+    ia_mkn_codec_lz = 1      /*!< LZ4 block format. */
+} ia_mkn_codec;
+
+/*!
+ * \brief Header of packed makernote data. Compressed data follows the header.
+ */
+typedef struct
+{
+    uint32_t tag;            /*!< IA_MKN_PACKED_TAG. */
+    uint32_t codec;          /*!< ia_mkn_codec. */
+    uint32_t size;           /*!< Size of makernote (MKNT) data. */
+    uint32_t packed_size;    /*!< Size of compressed data following the header. */
+} ia_mkn_packed_header;
+
+#define IA_MKN_LZ_HASH_BITS 12
+#define IA_MKN_LZ_MIN_MATCH 4
+#define IA_MKN_LZ_MAX_OFFSET 65535
+#define IA_MKN_LZ_LAST_LITERALS 5    /*!< Last bytes of the data are always literals. */
+#define IA_MKN_LZ_MATCH_LIMIT 12     /*!< Last match starts at least this many bytes before the end of the data. */
+
+/*!
+ * \brief Maximum size of packed makernote data.
+ * \param[in] size Size of makernote (MKNT) data.
+ * \return         Size of buffer which is large enough for packed data with any codec.
+ */
+static inline size_t
+ia_mkn_packed_bound(size_t size)
+{
+    return sizeof(ia_mkn_packed_header) + size + size / 255 + 16;
+}
+
+static inline uint32_t
+ia_mkn_lz_read32(const uint8_t *ptr)
+{
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static inline uint32_t
+ia_mkn_lz_hash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - IA_MKN_LZ_HASH_BITS);
+}
+
+/*!
+ * \brief Writes one sequence: literals followed by a match. Match length 0 means the last sequence with literals only.
+ * \return Pointer past the sequence or NULL if it doesn't fit.
+ */
+static inline uint8_t *
+ia_mkn_lz_write_sequence(uint8_t *dst,
+                         const uint8_t *dst_end,
+                         const uint8_t *literals,
+                         size_t num_literals,
+                         size_t offset,
+                         size_t match_length)
+{
+    uint8_t *token = dst;
+    size_t length;
+
+    /* Token, literal length, literals, offset and match length. */
+    if ((size_t)(dst_end - dst) < 1 + num_literals / 255 + 1 + num_literals + 2 + match_length / 255 + 1)
+        return NULL;
+    dst++;
+
+    if (num_literals >= 15) {
+        *token = 15 << 4;
+        for (length = num_literals - 15; length >= 255; length -= 255)
+            *dst++ = 255;
+        *dst++ = (uint8_t)length;
+    } else {
+        *token = (uint8_t)(num_literals << 4);
+    }
+    memcpy(dst, literals, num_literals);
+    dst += num_literals;
+    if (match_length == 0)
+        return dst;
+
+    *dst++ = (uint8_t)offset;
+    *dst++ = (uint8_t)(offset >> 8);
+    length = match_length - IA_MKN_LZ_MIN_MATCH;
+    if (length >= 15) {
+        *token |= 15;
+        for (length -= 15; length >= 255; length -= 255)
+            *dst++ = 255;
+        *dst++ = (uint8_t)length;
+    } else {
+        *token |= (uint8_t)length;
+    }
+    return dst;
+}
+
+/*!
+ * \brief Compresses data into LZ4 block format.
+ * \param[in]  src      Mandatory. Data to compress.
+ * \param[in]  size     Mandatory. Size of data.
+ * \param[out] dst      Mandatory. Buffer for compressed data.
+ * \param[in]  capacity Mandatory. Size of the buffer.
+ * \return              Size of compressed data or 0 if the buffer is too small.
+ */
+static inline size_t
+ia_mkn_lz_compress(const void *src, size_t size, void *dst, size_t capacity)
+{
+    uint32_t table[1 << IA_MKN_LZ_HASH_BITS];
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *out = (uint8_t *)dst;
+    const uint8_t *out_end = out + capacity;
+    size_t anchor = 0, pos = 0;
+
+    if (size > IA_MKN_LZ_MATCH_LIMIT) {
+        const size_t pos_limit = size - IA_MKN_LZ_MATCH_LIMIT;
+        const size_t match_end_limit = size - IA_MKN_LZ_LAST_LITERALS;
+
+        memset(table, 0, sizeof(table));
+        while (pos <= pos_limit) {
+            const uint32_t sequence = ia_mkn_lz_read32(in + pos);
+            const uint32_t hash = ia_mkn_lz_hash(sequence);
+            size_t ref = table[hash];
+            size_t length;
+
+            table[hash] = (uint32_t)pos;
+            if (ref >= pos || pos - ref > IA_MKN_LZ_MAX_OFFSET || ia_mkn_lz_read32(in + ref) != sequence) {
+                /* Skip faster over data which doesn't compress. */
+                pos += 1 + ((pos - anchor) >> 6);
+                continue;
+            }
+
+            while (pos > anchor && ref > 0 && in[pos - 1] == in[ref - 1]) {
+                pos--;
+                ref--;
+            }
+            length = IA_MKN_LZ_MIN_MATCH;
+            while (pos + length < match_end_limit && in[pos + length] == in[ref + length])
+                length++;
+
+            out = ia_mkn_lz_write_sequence(out, out_end, in + anchor, pos - anchor, pos - ref, length);
+            if (out == NULL)
+                return 0;
+            pos += length;
+            anchor = pos;
+            if (pos - 2 <= pos_limit)
+                table[ia_mkn_lz_hash(ia_mkn_lz_read32(in + pos - 2))] = (uint32_t)(pos - 2);
+        }
+    }
+
+    out = ia_mkn_lz_write_sequence(out, out_end, in + anchor, size - anchor, 0, 0);
+    if (out == NULL)
+        return 0;
+    return (size_t)(out - (uint8_t *)dst);
+}
+
+/*!
+ * \brief Decompresses data in LZ4 block format.
+ * \param[in]  src      Mandatory. Compressed data.
+ * \param[in]  size     Mandatory. Size of compressed data.
+ * \param[out] dst      Mandatory. Buffer for decompressed data.
+ * \param[in]  capacity Mandatory. Size of decompressed data.
+ * \return              Error code. ia_err_data if compressed data is corrupted or doesn't decompress into capacity bytes.
+ */
+static inline ia_err
+ia_mkn_lz_decompress(const void *src, size_t size, void *dst, size_t capacity)
+{
+    const uint8_t *in = (const uint8_t *)src;
+    const uint8_t *in_end = in + size;
+    uint8_t *out = (uint8_t *)dst;
+    uint8_t *out_end = out + capacity;
+
+    while (in < in_end) {
+        const unsigned int token = *in++;
+        size_t length = token >> 4;
+        size_t offset;
+        const uint8_t *ref;
+
+        if (length == 15) {
+            uint8_t extra;
+            do {
+                if (in >= in_end)
+                    return ia_err_data;
+                extra = *in++;
+                length += extra;
+            } while (extra == 255);
+        }
+        if ((size_t)(in_end - in) < length || (size_t)(out_end - out) < length)
+            return ia_err_data;
+        memcpy(out, in, length);
+        in += length;
+        out += length;
+        if (in == in_end)
+            break;
+
+        if (in_end - in < 2)
+            return ia_err_data;
+        offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (size_t)(out - (uint8_t *)dst))
+            return ia_err_data;
+        length = token & 15;
+        if (length == 15) {
+            uint8_t extra;
+            do {
+                if (in >= in_end)
+                    return ia_err_data;
+                extra = *in++;
+                length += extra;
+            } while (extra == 255);
+        }
+        length += IA_MKN_LZ_MIN_MATCH;
+        if ((size_t)(out_end - out) < length)
+            return ia_err_data;
+        /* Matches may overlap the bytes they produce, so copy byte by byte unless they are far enough apart. */
+        ref = out - offset;
+        if (offset >= length) {
+            memcpy(out, ref, length);
+            out += length;
+        } else {
+            while (length-- > 0)
+                *out++ = *ref++;
+        }
+    }
+    return out == out_end ? ia_err_none : ia_err_data;
+}
+
+/*!
+ * \brief Packs makernote (MKNT) data into a client buffer.
+ * \param[in]  mknt_data   Mandatory. Makernote data from ia_mkn_prepare.
+ * \param[in]  codec       Mandatory. Codec of the packed data.
+ * \param[out] buffer      Mandatory. Buffer for packed data. ia_mkn_packed_bound(mknt_data->size) bytes is always enough.
+ * \param[in]  capacity    Mandatory. Size of the buffer.
+ * \param[out] packed_size Mandatory. Size of packed data.
+ * \return                 Error code. ia_err_nomemory if the buffer is too small.
+ */
+static inline ia_err
+ia_mkn_pack(const ia_binary_data *mknt_data,
+            ia_mkn_codec codec,
+            void *buffer,
+            size_t capacity,
+            size_t *packed_size)
+{
+    ia_mkn_packed_header header;
+    uint8_t *payload = (uint8_t *)buffer + sizeof(header);
+    size_t payload_size;
+
+    if (mknt_data == NULL || mknt_data->data == NULL || buffer == NULL || packed_size == NULL)
+        return ia_err_argument;
+    if (capacity < sizeof(header))
+        return ia_err_nomemory;
+
+    switch (codec) {
+    case ia_mkn_codec_none:
+        payload_size = mknt_data->size;
+        if (capacity - sizeof(header) < payload_size)
+            return ia_err_nomemory;
+        memcpy(payload, mknt_data->data, payload_size);
+        break;
+    case ia_mkn_codec_lz:
+        payload_size = ia_mkn_lz_compress(mknt_data->data, mknt_data->size, payload, capacity - sizeof(header));
+        if (payload_size == 0)
+            return ia_err_nomemory;
+        break;
+    default:
+        return ia_err_argument;
+    }
+
+    header.tag = IA_MKN_PACKED_TAG;
+    header.codec = (uint32_t)codec;
+    header.size = mknt_data->size;
+    header.packed_size = (uint32_t)payload_size;
+    memcpy(buffer, &header, sizeof(header));
+    *packed_size = sizeof(header) + payload_size;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Prepares makernote and packs it into a client buffer.
+ * Makernote is compressed directly from the makernote buffer of ia_mkn_prepare into the client buffer.
+ *
+ * \param[in]  mkn         Mandatory. Pointer to makernote handle obtained from ia_mkn_init function call.
+ * \param[in]  data_target Mandatory. Target of the makernote as defined in enum ia_mkn_trg.
+ * \param[in]  codec       Mandatory. Codec of the packed data.
+ * \param[out] buffer      Mandatory. Buffer for packed data.
+ * \param[in]  capacity    Mandatory. Size of the buffer.
+ * \param[out] packed_size Mandatory. Size of packed data.
+ * \return                 Error code. ia_err_nomemory if the buffer is too small.
+ */
+static inline ia_err
+ia_mkn_prepare_into(ia_mkn *mkn,
+                    ia_mkn_trg data_target,
+                    ia_mkn_codec codec,
+                    void *buffer,
+                    size_t capacity,
+                    size_t *packed_size)
+{
+    ia_binary_data mknt_data;
+
+    if (mkn == NULL)
+        return ia_err_argument;
+    mknt_data = ia_mkn_prepare(mkn, data_target);
+    if (mknt_data.data == NULL || mknt_data.size == 0)
+        return ia_err_general;
+    return ia_mkn_pack(&mknt_data, codec, buffer, capacity, packed_size);
+}
+
+/*!
+ * \brief Gets size of makernote (MKNT) data of packed makernote.
+ * \param[in]  packed_data Mandatory. Packed makernote data.
+ * \param[out] size        Mandatory. Size of makernote data which ia_mkn_unpack produces.
+ * \return                 Error code.
+ */
+static inline ia_err
+ia_mkn_packed_get_size(const ia_binary_data *packed_data, size_t *size)
+{
+    ia_mkn_packed_header header;
+
+    if (packed_data == NULL || packed_data->data == NULL || size == NULL)
+        return ia_err_argument;
+    if (packed_data->size < sizeof(header))
+        return ia_err_data;
+    memcpy(&header, packed_data->data, sizeof(header));
+    if (header.tag != IA_MKN_PACKED_TAG || header.packed_size > packed_data->size - sizeof(header))
+        return ia_err_data;
+    *size = header.size;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Converts packed makernote back into makernote (MKNT) data.
+ * \param[in]  packed_data Mandatory. Packed makernote data.
+ * \param[out] buffer      Mandatory. Buffer for makernote data. Size is queried with ia_mkn_packed_get_size.
+ * \param[in]  capacity    Mandatory. Size of the buffer.
+ * \param[out] mknt_data   Mandatory. Makernote data in the buffer.
+ * \return                 Error code.
+ */
+static inline ia_err
+ia_mkn_unpack(const ia_binary_data *packed_data,
+              void *buffer,
+              size_t capacity,
+              ia_binary_data *mknt_data)
+{
+    ia_mkn_packed_header header;
+    const uint8_t *payload;
+    size_t size;
+    ia_err err;
+
+    err = ia_mkn_packed_get_size(packed_data, &size);
+    if (err != ia_err_none)
+        return err;
+    if (buffer == NULL || mknt_data == NULL)
+        return ia_err_argument;
+    if (capacity < size)
+        return ia_err_nomemory;
+    memcpy(&header, packed_data->data, sizeof(header));
+    payload = (const uint8_t *)packed_data->data + sizeof(header);
+
+    switch (header.codec) {
+    case ia_mkn_codec_none:
+        if (header.packed_size != header.size)
+            return ia_err_data;
+        memcpy(buffer, payload, size);
+        break;
+    case ia_mkn_codec_lz:
+        err = ia_mkn_lz_decompress(payload, header.packed_size, buffer, size);
+        if (err != ia_err_none)
+            return err;
+        break;
+    default:
+        return ia_err_data;
+    }
+    mknt_data->data = buffer;
+    mknt_data->size = (unsigned int)size;
+    return ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_MKN_CODEC_H_ */
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_mkn_local.h
+ * \brief Per-thread makernote record buffers which are merged into one makernote when it is prepared.
+ *
+ * All producers of makernote records (AIQ, ISP, LTM, HAL) normally write into one ia_mkn handle, which serializes them.
+ * ia_mkn_local_set gives each producer thread an ia_mkn handle of its own: a local makernote. Local makernotes are
+ * passed to ia_aiq_init, ia_isp_bxt_init, ia_ltm_init etc. instead of the shared handle, and HAL records are added
+ * into them with ia_mkn_add_record. Producers never touch the same handle, so no locks are needed when recording.
+ *
+ * ia_mkn_local_set_prepare merges all local makernotes into the shared makernote with ia_mkn_merge and prepares it.
+ * Output is byte identical to the output of a single makernote with the same records. Prepare must be called when the
+ * producers of the frame have finished recording, which is also required when a single makernote is used.
+ */
+
+#ifndef _IA_MKN_LOCAL_H_
+#define _IA_MKN_LOCAL_H_
+
+#include "ia_mkn_encoder.h"
+#include "ia_abstraction.h"
+#include <stddef.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Shared makernote and local makernotes of producer threads.
+ */
+typedef struct
+{
+    ia_mkn *mkn;                 /*!< Shared makernote into which local makernotes are merged. */
+    ia_mkn **locals;             /*!< Local makernotes. */
+    unsigned int num_locals;     /*!< Number of local makernotes. */
+    volatile long num_claimed;   /*!< Number of local makernotes handed out with ia_mkn_local_claim. */
+} ia_mkn_local_set;
+
+/*!
+ * \brief Deletes shared and local makernotes.
+ * \param[in] set Mandatory. Makernote set.
+ */
+static inline void
+ia_mkn_local_set_uninit(ia_mkn_local_set *set)
+{
+    unsigned int i;
+
+    if (set == NULL)
+        return;
+    if (set->locals != NULL) {
+        for (i = 0; i < set->num_locals; i++) {
+            if (set->locals[i] != NULL)
+                ia_mkn_uninit(set->locals[i]);
+        }
+        IA_FREEZ(set->locals);
+    }
+    if (set->mkn != NULL)
+        ia_mkn_uninit(set->mkn);
+    set->mkn = NULL;
+    set->num_locals = 0;
+    set->num_claimed = 0;
+}
+
+/*!
+ * \brief Creates shared makernote and local makernotes.
+ * All makernotes are created with the same section sizes, because ia_mkn_merge takes the section layout of the merged
+ * makernote from the source. Sizes must be large enough for records of all producers.
+ *
+ * \param[out] set                Mandatory. Makernote set.
+ * \param[in]  mkn_config_bits    Mandatory. Configuration flag bits of all makernotes.
+ * \param[in]  mkn_section_1_size Mandatory. Size of Section 1 data buffer of all makernotes.
+ * \param[in]  mkn_section_2_size Mandatory. Size of Section 2 data buffer of all makernotes.
+ * \param[in]  num_locals         Mandatory. Number of local makernotes (producer threads).
+ * \return                        Error code.
+ */
+static inline ia_err
+ia_mkn_local_set_init(ia_mkn_local_set *set,
+                      ia_mkn_config_bits mkn_config_bits,
+                      size_t mkn_section_1_size,
+                      size_t mkn_section_2_size,
+                      unsigned int num_locals)
+{
+    unsigned int i;
+
+    if (set == NULL || num_locals == 0)
+        return ia_err_argument;
+    set->num_locals = 0;
+    set->num_claimed = 0;
+    set->locals = NULL;
+    set->mkn = ia_mkn_init(mkn_config_bits, mkn_section_1_size, mkn_section_2_size);
+    if (set->mkn == NULL)
+        return ia_err_nomemory;
+    set->locals = (ia_mkn **)IA_CALLOC(num_locals * sizeof(ia_mkn *));
+    if (set->locals == NULL) {
+        ia_mkn_local_set_uninit(set);
+        return ia_err_nomemory;
+    }
+    set->num_locals = num_locals;
+    for (i = 0; i < num_locals; i++) {
+        set->locals[i] = ia_mkn_init(mkn_config_bits, mkn_section_1_size, mkn_section_2_size);
+        if (set->locals[i] == NULL) {
+            ia_mkn_local_set_uninit(set);
+            return ia_err_nomemory;
+        }
+    }
+    return ia_err_none;
+}
+
+/*!
+ * \brief Gets local makernote of a producer.
+ * \param[in] set   Mandatory. Makernote set.
+ * \param[in] index Mandatory. Index of the producer [0, num_locals - 1].
+ * \return          Local makernote or NULL if index is out of range.
+ */
+static inline ia_mkn *
+ia_mkn_local_get(const ia_mkn_local_set *set, unsigned int index)
+{
+    if (set == NULL || index >= set->num_locals)
+        return NULL;
+    return set->locals[index];
+}
+
+/*!
+ * \brief Hands out next unused local makernote.
+ * For producer threads which don't have a fixed index. Can be called concurrently from any thread.
+ *
+ * \param[in] set Mandatory. Makernote set.
+ * \return        Local makernote or NULL if all local makernotes have been handed out.
+ */
+static inline ia_mkn *
+ia_mkn_local_claim(ia_mkn_local_set *set)
+{
+    long index;
+
+    if (set == NULL)
+        return NULL;
+#if defined(_MSC_VER)
+    index = _InterlockedIncrement(&set->num_claimed) - 1;
+#else
+    index = __sync_fetch_and_add(&set->num_claimed, 1);
+#endif
+    return ia_mkn_local_get(set, (unsigned int)index);
+}
+
+/*!
+ * \brief Enables or disables data collection of shared and local makernotes.
+ * \param[in] set                    Mandatory. Makernote set.
+ * \param[in] enable_data_collection Mandatory. Enable/disable data collection.
+ * \return                           Error code.
+ */
+static inline ia_err
+ia_mkn_local_set_enable(ia_mkn_local_set *set, bool enable_data_collection)
+{
+    ia_err err;
+    unsigned int i;
+
+    if (set == NULL || set->mkn == NULL)
+        return ia_err_argument;
+    err = ia_mkn_enable(set->mkn, enable_data_collection);
+    for (i = 0; i < set->num_locals && err == ia_err_none; i++)
+        err = ia_mkn_enable(set->locals[i], enable_data_collection);
+    return err;
+}
+
+/*!
+ * \brief Resets shared and local makernotes to default state.
+ * \param[in] set Mandatory. Makernote set.
+ * \return        Error code.
+ */
+static inline ia_err
+ia_mkn_local_set_reset(ia_mkn_local_set *set)
+{
+    ia_err err;
+    unsigned int i;
+
+    if (set == NULL || set->mkn == NULL)
+        return ia_err_argument;
+    err = ia_mkn_reset(set->mkn);
+    for (i = 0; i < set->num_locals && err == ia_err_none; i++)
+        err = ia_mkn_reset(set->locals[i]);
+    return err;
+}
+
+/*!
+ * \brief Merges local makernotes into the shared makernote and prepares it.
+ * Shared makernote is reset before merging, so it contains exactly the records of the local makernotes. If the same
+ * record is in more than one local makernote, the record of the local makernote with the highest index is used.
+ *
+ * \param[in] set         Mandatory. Makernote set.
+ * \param[in] data_target Mandatory. Target of the makernote as defined in enum ia_mkn_trg.
+ * \return                Binary data structure with pointer and size of data. Size is 0 if merging fails.
+ */
+static inline ia_binary_data
+ia_mkn_local_set_prepare(ia_mkn_local_set *set, ia_mkn_trg data_target)
+{
+    ia_binary_data mknt = { NULL, 0 };
+    ia_err err;
+    unsigned int i;
+
+    if (set == NULL || set->mkn == NULL)
+        return mknt;
+    err = ia_mkn_reset(set->mkn);
+    for (i = 0; i < set->num_locals && err == ia_err_none; i++)
+        err = ia_mkn_merge(set->mkn, set->locals[i]);
+    if (err != ia_err_none)
+        return mknt;
+    return ia_mkn_prepare(set->mkn, data_target);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_MKN_LOCAL_H_ */
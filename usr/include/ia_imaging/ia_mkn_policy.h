@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_mkn_policy.h
+ * \brief Sampling and record filtering policy of makernote data collection.
+ *
+ * ia_mkn_policy limits makernote data collection so that it can be left enabled permanently:
+ * - Frame sampling: data collection of the makernote is enabled only on every Nth frame (ia_mkn_policy_begin_frame),
+ *   so algorithms don't write records on other frames.
+ * - DNID allow list: HAL records outside the allowed DNID ranges are not added (ia_mkn_policy_add_record). Records
+ *   written by algorithm libraries are removed before the makernote is prepared (ia_mkn_policy_prepare).
+ * - Byte cap: records which don't fit into the per frame byte budget are removed before the makernote is prepared.
+ *   Records of DNID ranges earlier in the allow list are kept first.
+ *
+ * Output of ia_mkn_policy_prepare is ordinary makernote data, which is decoded with ia_mkn_decoder.h.
+ */
+
+#ifndef _IA_MKN_POLICY_H_
+#define _IA_MKN_POLICY_H_
+
+#include "ia_mkn_encoder.h"
+#include "ia_mkn_decoder.h"
+#include "ia_abstraction.h"
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Inclusive range of DNIDs. Section target bits (ia_mkn_trg) are ignored.
+ */
+typedef struct
+{
+    unsigned int first;    /*!< First DNID of the range. */
+    unsigned int last;     /*!< Last DNID of the range. */
+} ia_mkn_dnid_range;
+
+/*!
+ * \brief Makernote data collection policy.
+ */
+typedef struct
+{
+    unsigned int frame_interval;        /*!< Records are collected on every frame_interval'th frame. 0 and 1 collect every frame. */
+    const ia_mkn_dnid_range *ranges;    /*!< Allowed DNID ranges in priority order. NULL allows all DNIDs. */
+    unsigned int num_ranges;            /*!< Number of allowed DNID ranges. */
+    size_t max_bytes_per_frame;         /*!< Maximum size of records (including record headers) in prepared makernote. 0 for no limit. */
+} ia_mkn_policy;
+
+/*!
+ * \brief Mask of DNID bits in a record DNID, without section target bits.
+ */
+#define IA_MKN_POLICY_DNID_MASK 0xFFFF
+
+/*!
+ * \brief Rank of a DNID in the allow list.
+ * \return Index of the first allowed range containing the DNID or -1 if DNID is not allowed.
+ */
+static inline int
+ia_mkn_policy_rank(const ia_mkn_policy *policy, unsigned int dnid)
+{
+    unsigned int i;
+
+    dnid &= IA_MKN_POLICY_DNID_MASK;
+    if (policy->ranges == NULL)
+        return 0;
+    for (i = 0; i < policy->num_ranges; i++) {
+        if (dnid >= policy->ranges[i].first && dnid <= policy->ranges[i].last)
+            return (int)i;
+    }
+    return -1;
+}
+
+/*!
+ * \brief Checks whether records are collected on a frame.
+ * \param[in] policy   Mandatory. Makernote policy.
+ * \param[in] frame_id Mandatory. Frame ID.
+ * \return             True if records are collected.
+ */
+static inline bool
+ia_mkn_policy_is_sampled(const ia_mkn_policy *policy, unsigned long long frame_id)
+{
+    return policy->frame_interval <= 1 || frame_id % policy->frame_interval == 0;
+}
+
+/*!
+ * \brief Enables data collection of the makernote on sampled frames and disables it on other frames.
+ * Call before algorithms of the frame are run. Makernote should be prepared only on sampled frames, because records
+ * of the previous sampled frame remain in the makernote.
+ *
+ * \param[in]  policy   Mandatory. Makernote policy.
+ * \param[in]  mkn      Mandatory. Makernote handle.
+ * \param[in]  frame_id Mandatory. Frame ID.
+ * \param[out] sampled  Optional. True if records are collected on this frame.
+ * \return              Error code.
+ */
+static inline ia_err
+ia_mkn_policy_begin_frame(const ia_mkn_policy *policy,
+                          ia_mkn *mkn,
+                          unsigned long long frame_id,
+                          bool *sampled)
+{
+    bool is_sampled;
+
+    if (policy == NULL || mkn == NULL)
+        return ia_err_argument;
+    is_sampled = ia_mkn_policy_is_sampled(policy, frame_id);
+    if (sampled != NULL)
+        *sampled = is_sampled;
+    return ia_mkn_enable(mkn, is_sampled);
+}
+
+/*!
+ * \brief Adds a data record into the makernote, if the DNID is allowed by the policy.
+ * Parameters are the same as in ia_mkn_add_record.
+ * \return Error code. ia_err_none also when the record is not allowed and not added.
+ */
+static inline ia_err
+ia_mkn_policy_add_record(const ia_mkn_policy *policy,
+                         ia_mkn *mkn,
+                         ia_mkn_dfid mkn_data_format_id,
+                         ia_mkn_dnid mkn_data_name_id,
+                         const void *data,
+                         unsigned int num_elements,
+                         const char *key)
+{
+    if (policy == NULL || mkn == NULL)
+        return ia_err_argument;
+    if (ia_mkn_policy_rank(policy, (unsigned int)mkn_data_name_id) < 0)
+        return ia_err_none;
+    return ia_mkn_add_record(mkn, mkn_data_format_id, mkn_data_name_id, data, num_elements, key);
+}
+
+/*!
+ * \brief Removes records which are not allowed or don't fit into the byte cap, and prepares the makernote.
+ * Removed records are deleted from the makernote.
+ *
+ * \param[in] policy      Mandatory. Makernote policy.
+ * \param[in] mkn         Mandatory. Makernote handle.
+ * \param[in] data_target Mandatory. Target of the makernote as defined in enum ia_mkn_trg.
+ * \return                Binary data structure with pointer and size of data. Size is 0 on failure.
+ */
+static inline ia_binary_data
+ia_mkn_policy_prepare(const ia_mkn_policy *policy, ia_mkn *mkn, ia_mkn_trg data_target)
+{
+    ia_binary_data mknt_data = { NULL, 0 };
+    ia_mkn_record_header *headers;
+    unsigned int *sections;
+    int num_records = 0, i;
+    size_t section_1_size, offset, used = 0;
+    unsigned int rank, num_ranks;
+
+    if (policy == NULL || mkn == NULL)
+        return mknt_data;
+    if (policy->ranges == NULL && policy->max_bytes_per_frame == 0)
+        return ia_mkn_prepare(mkn, data_target);
+
+    /* Records of Section 1 come first in the makernote data of Section 2 target. */
+    mknt_data = ia_mkn_prepare(mkn, ia_mkn_trg_section_1);
+    if (mknt_data.size < sizeof(ia_mkn_header))
+        return mknt_data;
+    section_1_size = mknt_data.size - sizeof(ia_mkn_header);
+    mknt_data = ia_mkn_prepare(mkn, ia_mkn_trg_section_2);
+    if (ia_mkn_get_record_headers(&mknt_data, &num_records, NULL) != ia_err_none || num_records <= 0)
+        return ia_mkn_prepare(mkn, data_target);
+
+    headers = (ia_mkn_record_header *)IA_ALLOC(num_records * sizeof(ia_mkn_record_header));
+    sections = (unsigned int *)IA_ALLOC(num_records * sizeof(unsigned int));
+    if (headers == NULL || sections == NULL ||
+        ia_mkn_get_record_headers(&mknt_data, &num_records, headers) != ia_err_none) {
+        IA_FREEZ(headers);
+        IA_FREEZ(sections);
+        mknt_data.data = NULL;
+        mknt_data.size = 0;
+        return mknt_data;
+    }
+
+    /* Remove records which are not allowed. Dummy records fill the unused part of Section 1 and are kept. */
+    for (i = 0, offset = 0; i < num_records; offset += headers[i].size, i++) {
+        sections[i] = offset < section_1_size ? ia_mkn_trg_section_1 : ia_mkn_trg_section_2;
+        if (headers[i].data_name_id == ia_mkn_dnid_dummy)
+            continue;
+        if (ia_mkn_policy_rank(policy, headers[i].data_name_id) < 0) {
+            ia_mkn_delete_record(mkn, (ia_mkn_dfid)headers[i].data_format_id,
+                                 (ia_mkn_dnid)(headers[i].data_name_id | sections[i]));
+            headers[i].data_name_id = ia_mkn_dnid_dummy;
+        }
+    }
+
+    /* Keep records in priority order while they fit into the byte cap. */
+    if (policy->max_bytes_per_frame > 0) {
+        num_ranks = policy->ranges != NULL ? policy->num_ranges : 1;
+        for (rank = 0; rank < num_ranks; rank++) {
+            for (i = 0; i < num_records; i++) {
+                if (headers[i].data_name_id == ia_mkn_dnid_dummy ||
+                    ia_mkn_policy_rank(policy, headers[i].data_name_id) != (int)rank)
+                    continue;
+                if (used + headers[i].size <= policy->max_bytes_per_frame) {
+                    used += headers[i].size;
+                    continue;
+                }
+                ia_mkn_delete_record(mkn, (ia_mkn_dfid)headers[i].data_format_id,
+                                     (ia_mkn_dnid)(headers[i].data_name_id | sections[i]));
+                headers[i].data_name_id = ia_mkn_dnid_dummy;
+            }
+        }
+    }
+
+    IA_FREEZ(headers);
+    IA_FREEZ(sections);
+    return ia_mkn_prepare(mkn, data_target);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_MKN_POLICY_H_ */
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_nvm_cache.h
+ * \brief Persistent cache of parsed NVM data.
+ *
+ * NVM of a camera module doesn't change, but ia_nvm_parse decodes it (LSC, AWB, AF and PDAF tables) every time the camera
+ * is opened. ia_nvm_cache_parse stores the parsed ia_nvm into a cache file as a relocatable image, in the same format as
+ * CMC snapshots (see ia_cmc_snapshot.h), and on the next open maps the file and relocates its pointers instead of parsing.
+ *
+ * Cache is keyed with a hash of the NVM data and the header of the AIQB (which carries the tuning version and checksum),
+ * so a cache file is not used after module or tuning change:
+ * \code
+ * ia_nvm_cache cache;
+ * if (ia_nvm_cache_parse(&cache, "/var/cache/camera/imx185.nvmc", nvm_data, aiqb_data) == ia_nvm_error_none)
+ *     use(cache.ia_nvm);
+ * ia_nvm_cache_close(&cache);
+ * \endcode
+ *
+ * ia_nvm returned from the cache is owned by the cache and must not be given to ia_nvm_deinit.
+ */
+
+#ifndef _IA_NVM_CACHE_H_
+#define _IA_NVM_CACHE_H_
+
+#include "ia_cmc_snapshot.h"
+#include "ia_nvm.h"
+#include "ia_types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IA_NVM_CACHE_MAGIC IA_MKN_CHTOUL('N','V','M','C')
+#define IA_NVM_CACHE_VERSION 1
+
+/*!
+ * \brief Header in the beginning of a NVM cache image.
+ */
+typedef struct
+{
+    uint32_t magic;             /*!< IA_NVM_CACHE_MAGIC. */
+    uint32_t version;           /*!< IA_NVM_CACHE_VERSION. */
+    uint32_t pointer_size;      /*!< Size of pointers on the host which created the image. */
+    uint32_t nvm_size;          /*!< Size of ia_nvm on the host which created the image. */
+    uint64_t key;               /*!< Key, see ia_nvm_cache_key. */
+    uint64_t size;              /*!< Size of the image including this header. */
+    uint64_t nvm_offset;        /*!< Offset of ia_nvm. */
+    uint64_t reloc_offset;      /*!< Offset of relocation table (uint32_t offsets of pointers). */
+    uint64_t num_relocs;        /*!< Number of pointers. */
+    uint64_t base;              /*!< Address the pointers are currently relocated to. 0 in a stored image. */
+} ia_nvm_cache_header;
+
+/*!
+ * \brief Calculates key of NVM data parsed for the given tuning (64 bit FNV-1a hash).
+ *
+ * \param[in] nvm_data   Mandatory. NVM data.
+ * \param[in] aiqb_data  Optional. AIQB. Only its header is hashed.
+ * \return               Key.
+ */
+static inline uint64_t
+ia_nvm_cache_key(const ia_binary_data *nvm_data,
+                 const ia_binary_data *aiqb_data)
+{
+    ia_binary_data header = { NULL, 0 };
+
+    if (aiqb_data != NULL && aiqb_data->data != NULL && aiqb_data->size >= sizeof(ia_mkn_header)) {
+        header.data = aiqb_data->data;
+        header.size = sizeof(ia_mkn_header);
+    }
+    return ia_cmc_snapshot_key(nvm_data, &header);
+}
+
+static inline void
+ia_nvm_cache_write(ia_cmc_snapshot_writer *w, size_t slot, const ia_nvm *src)
+{
+    const size_t lsc_size = (size_t)src->lsc_width * src->lsc_height;
+    size_t n, offset;
+    bool created;
+    unsigned int i, j;
+
+    n = ia_cmc_snapshot_array(w, slot, src, sizeof(*src));
+    if (n == 0)
+        return;
+
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(n, ia_nvm, vcm_af_near), src->vcm_af_near, src->n_pos * sizeof(int16_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(n, ia_nvm, vcm_af_far), src->vcm_af_far, src->n_pos * sizeof(int16_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(n, ia_nvm, vcm_af_start), src->vcm_af_start, src->n_pos * sizeof(int16_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(n, ia_nvm, vcm_af_end), src->vcm_af_end, src->n_pos * sizeof(int16_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(n, ia_nvm, cie_coords_x), src->cie_coords_x, src->n_lights * sizeof(uint8_t));
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(n, ia_nvm, cie_coords_y), src->cie_coords_y, src->n_lights * sizeof(uint8_t));
+
+    offset = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(n, ia_nvm, lsc), src->lsc,
+                                  src->n_lights * sizeof(ia_nvm_lsc), src->n_lights * sizeof(ia_nvm_lsc), &created);
+    for (i = 0; created && i < src->n_lights; i++) {
+        const size_t value_size = src->lsc[i].lsc_frac_bits <= IA_NVM_LSC_BIT_DEPTH_THRESHOLD ? sizeof(uint8_t) : sizeof(uint16_t);
+        for (j = 0; j < IA_NVM_NUM_CHANNELS; j++)
+            ia_cmc_snapshot_array(w, offset + i * sizeof(ia_nvm_lsc) + offsetof(ia_nvm_lsc, lsc_tables) + j * sizeof(void *),
+                                  src->lsc[i].lsc_tables[j], lsc_size * value_size);
+    }
+    for (j = 0; j < IA_NVM_NUM_CHANNELS; j++)
+        ia_cmc_snapshot_array(w, n + offsetof(ia_nvm, awb_sensitivities) + j * sizeof(uint16_t *),
+                              src->awb_sensitivities[j], src->n_lights * sizeof(uint16_t));
+
+    offset = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(n, ia_nvm, pdaf_data), src->pdaf_data,
+                                  sizeof(ia_nvm_pdaf_data), sizeof(ia_nvm_pdaf_data), &created);
+    if (created) {
+        const ia_nvm_pdaf_data *pdaf = src->pdaf_data;
+        const size_t ps_size = (size_t)pdaf->pdaf_ps_knots_width * pdaf->pdaf_ps_knots_height * sizeof(uint16_t);
+        const size_t tables = ia_cmc_snapshot_data(w, IA_AIQ_RECORD_SLOT(offset, ia_nvm_pdaf_data, pdaf_ps_tables),
+                                                   pdaf->pdaf_ps_tables,
+                                                   pdaf->pdaf_ps_sensor_modes * sizeof(ia_nvm_pdaf_ps),
+                                                   pdaf->pdaf_ps_sensor_modes * sizeof(ia_nvm_pdaf_ps), &created);
+        for (i = 0; created && i < pdaf->pdaf_ps_sensor_modes; i++) {
+            const size_t table = tables + i * sizeof(ia_nvm_pdaf_ps);
+            ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(table, ia_nvm_pdaf_ps, pdaf_ps_left), pdaf->pdaf_ps_tables[i].pdaf_ps_left, ps_size);
+            ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(table, ia_nvm_pdaf_ps, pdaf_ps_right), pdaf->pdaf_ps_tables[i].pdaf_ps_right, ps_size);
+        }
+        ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(offset, ia_nvm_pdaf_data, pdaf_dlom_tables), pdaf->pdaf_dlom_tables,
+                              (size_t)pdaf->pdaf_dlom_knots_width * pdaf->pdaf_dlom_knots_height * sizeof(int32_t));
+    }
+
+    ia_cmc_snapshot_array(w, IA_AIQ_RECORD_SLOT(n, ia_nvm, vcm), src->vcm, sizeof(ia_nvm_closed_loop_vcm));
+}
+
+/*!
+ * \brief Serializes parsed NVM into a relocatable image.
+ *
+ * \param[in]  ia_nvm  Mandatory. Parsed NVM from ia_nvm_parse.
+ * \param[in]  key     Mandatory. Key, see ia_nvm_cache_key.
+ * \param[out] image   Mandatory. Image. Data is allocated with malloc and released by the caller with free.
+ * \return             Error code.
+ */
+static inline ia_err
+ia_nvm_serialize(const ia_nvm *ia_nvm,
+                 uint64_t key,
+                 ia_binary_data *image)
+{
+    ia_cmc_snapshot_writer w;
+    ia_nvm_cache_header header;
+    size_t nvm_offset, reloc_offset;
+
+    if (ia_nvm == NULL || image == NULL)
+        return ia_err_argument;
+    image->data = NULL;
+    image->size = 0;
+
+    memset(&w, 0, sizeof(w));
+    ia_aiq_record_put(&w.buffer, NULL, sizeof(header));
+    nvm_offset = w.buffer.size;
+    ia_nvm_cache_write(&w, 0, ia_nvm);
+    reloc_offset = ia_aiq_record_put(&w.buffer, w.buffer.relocs, w.buffer.num_relocs * sizeof(uint32_t));
+    free(w.spans);
+    if (w.buffer.err != ia_err_none) {
+        const ia_err err = w.buffer.err;
+        ia_aiq_record_buffer_free(&w.buffer);
+        return err;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = IA_NVM_CACHE_MAGIC;
+    header.version = IA_NVM_CACHE_VERSION;
+    header.pointer_size = sizeof(void *);
+    header.nvm_size = sizeof(*ia_nvm);
+    header.key = key;
+    header.size = w.buffer.size;
+    header.nvm_offset = nvm_offset;
+    header.reloc_offset = reloc_offset;
+    header.num_relocs = w.buffer.num_relocs;
+    memcpy(w.buffer.data, &header, sizeof(header));
+
+    image->data = w.buffer.data;
+    image->size = (unsigned int)w.buffer.size;
+    free(w.buffer.relocs);
+    return ia_err_none;
+}
+
+/*!
+ * \brief Turns a serialized image into parsed NVM in place. See ia_cmc_deserialize.
+ *
+ * \param[in,out] image  Mandatory. Image created with ia_nvm_serialize. Must be aligned to 8 bytes.
+ * \param[in]     size   Mandatory. Size of the image.
+ * \param[in]     key    Mandatory. Expected key, see ia_nvm_cache_key.
+ * \return               NVM inside the image or NULL, if the image is invalid, created for another ABI or has another key.
+ */
+static inline ia_nvm *
+ia_nvm_deserialize(void *image,
+                   size_t size,
+                   uint64_t key)
+{
+    unsigned char *data = (unsigned char *)image;
+    ia_nvm_cache_header *header = (ia_nvm_cache_header *)image;
+
+    if (image == NULL || size < sizeof(*header) || ((uintptr_t)image & 7) != 0)
+        return NULL;
+    if (header->magic != IA_NVM_CACHE_MAGIC || header->version != IA_NVM_CACHE_VERSION ||
+        header->pointer_size != sizeof(void *) || header->nvm_size != sizeof(ia_nvm) ||
+        header->key != key || header->size != size ||
+        header->nvm_offset > size - sizeof(ia_nvm))
+        return NULL;
+    if (!ia_cmc_snapshot_relocate(data, size, header->reloc_offset, header->num_relocs, &header->base))
+        return NULL;
+    return (ia_nvm *)(data + header->nvm_offset);
+}
+
+/*!
+ * \brief Parsed NVM from the cache.
+ */
+typedef struct
+{
+    void *data;         /*!< Image. */
+    size_t size;        /*!< Size of the image. */
+    bool mapped;        /*!< Image is memory mapped. Otherwise it is in allocated memory. */
+    bool parsed;        /*!< ia_nvm comes directly from ia_nvm_parse, because it couldn't be serialized. */
+    ia_nvm *ia_nvm;     /*!< Parsed NVM. */
+} ia_nvm_cache;
+
+/*!
+ * \brief Releases parsed NVM of the cache.
+ */
+static inline void
+ia_nvm_cache_close(ia_nvm_cache *cache)
+{
+    if (cache == NULL)
+        return;
+    if (cache->parsed)
+        ia_nvm_deinit(cache->ia_nvm);
+    ia_cmc_snapshot_unmap_file(cache->data, cache->size, cache->mapped);
+    memset(cache, 0, sizeof(*cache));
+}
+
+/*!
+ * \brief Returns parsed NVM from the cache file, or parses the NVM and stores it into the cache file.
+ * Failure to write the cache file is not an error.
+ *
+ * \param[out] cache      Mandatory. Parsed NVM.
+ * \param[in]  path       Optional. Cache file. If NULL, NVM is parsed without caching.
+ * \param[in]  nvm_data   Mandatory. NVM data.
+ * \param[in]  aiqb_data  Optional. AIQB the NVM is used with. Included into the key.
+ * \return                NVM parsing error code.
+ */
+static inline ia_nvm_error
+ia_nvm_cache_parse(ia_nvm_cache *cache,
+                   const char *path,
+                   const ia_binary_data *nvm_data,
+                   const ia_binary_data *aiqb_data)
+{
+    ia_binary_data image;
+    ia_nvm *parsed = NULL;
+    ia_nvm_error nvm_err;
+    uint64_t key;
+
+    if (cache == NULL || nvm_data == NULL || nvm_data->data == NULL)
+        return ia_nvm_error_no_data;
+    memset(cache, 0, sizeof(*cache));
+    key = ia_nvm_cache_key(nvm_data, aiqb_data);
+
+    if (path != NULL && ia_cmc_snapshot_map_file(path, &cache->data, &cache->size, &cache->mapped) == ia_err_none) {
+        cache->ia_nvm = ia_nvm_deserialize(cache->data, cache->size, key);
+        if (cache->ia_nvm != NULL)
+            return ia_nvm_error_none;
+        ia_nvm_cache_close(cache);
+    }
+
+    nvm_err = ia_nvm_parse(nvm_data, &parsed);
+    if (nvm_err != ia_nvm_error_none)
+        return nvm_err;
+    if (ia_nvm_serialize(parsed, key, &image) != ia_err_none) {
+        cache->ia_nvm = parsed;
+        cache->parsed = true;
+        return ia_nvm_error_none;
+    }
+    ia_nvm_deinit(parsed);
+
+    if (path != NULL)
+        ia_cmc_snapshot_write_file(path, image.data, image.size);
+    cache->data = image.data;
+    cache->size = image.size;
+    cache->ia_nvm = ia_nvm_deserialize(cache->data, cache->size, key);
+    return ia_nvm_error_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_NVM_CACHE_H_ */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_nvm_lsc.h
+ * \brief Expansion of NVM LSC tables into 16 bit gains.
+ *
+ * LSC tables in ia_nvm are stored with the fractional bit depth of the module calibration: as 8 bit values up to
+ * IA_NVM_LSC_BIT_DEPTH_THRESHOLD fractional bits and as 16 bit values above it. ia_nvm_lsc_expand converts a table into
+ * 16 bit gains with the fractional bit depth wanted by the client. SSE2 is used where available (8 values per instruction),
+ * other platforms use a plain loop which compilers can vectorize.
+ */
+
+#ifndef _IA_NVM_LSC_H_
+#define _IA_NVM_LSC_H_
+
+#include "ia_nvm.h"
+#include "ia_types.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IA_NVM_LSC_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Converts gains between fractional bit depths. Right shifts are rounded to nearest.
+ */
+static inline uint16_t
+ia_nvm_lsc_convert(unsigned int value, int shift)
+{
+    if (shift >= 0)
+        return (uint16_t)(value << shift);
+    return (uint16_t)((value >> -shift) + ((value >> (-shift - 1)) & 1));
+}
+
+/*!
+ * \brief Expands LSC table of one light source and channel into 16 bit gains.
+ *
+ * \param[in]  ia_nvm     Mandatory. Parsed NVM.
+ * \param[in]  light      Mandatory. Light source index [0, n_lights - 1].
+ * \param[in]  channel    Mandatory. Channel index [0, IA_NVM_NUM_CHANNELS - 1].
+ * \param[in]  frac_bits  Mandatory. Fractional bit depth of the gains [0, 15].
+ * \param[out] gains      Mandatory. lsc_width * lsc_height gains.
+ * \return                Error code.
+ */
+static inline ia_err
+ia_nvm_lsc_expand(const ia_nvm *ia_nvm,
+                  unsigned int light,
+                  unsigned int channel,
+                  unsigned int frac_bits,
+                  uint16_t *gains)
+{
+    const ia_nvm_lsc *lsc;
+    size_t num_values, i = 0;
+    int shift;
+
+    if (ia_nvm == NULL || gains == NULL || light >= ia_nvm->n_lights || channel >= IA_NVM_NUM_CHANNELS ||
+        frac_bits > 15 || ia_nvm->lsc == NULL || ia_nvm->lsc[light].lsc_tables[channel] == NULL)
+        return ia_err_argument;
+    lsc = &ia_nvm->lsc[light];
+    num_values = (size_t)ia_nvm->lsc_width * ia_nvm->lsc_height;
+    shift = (int)frac_bits - (int)lsc->lsc_frac_bits;
+
+    if (lsc->lsc_frac_bits <= IA_NVM_LSC_BIT_DEPTH_THRESHOLD) {
+        const uint8_t *table = (const uint8_t *)lsc->lsc_tables[channel];
+#ifdef IA_NVM_LSC_HAS_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i count = _mm_cvtsi32_si128(shift >= 0 ? shift : -shift);
+        const __m128i round_count = _mm_cvtsi32_si128(shift >= 0 ? 0 : -shift - 1);
+        const __m128i one = _mm_set1_epi16(1);
+        for (; i + 16 <= num_values; i += 16) {
+            const __m128i bytes = _mm_loadu_si128((const __m128i *)(table + i));
+            __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            if (shift >= 0) {
+                lo = _mm_sll_epi16(lo, count);
+                hi = _mm_sll_epi16(hi, count);
+            } else {
+                lo = _mm_add_epi16(_mm_srl_epi16(lo, count), _mm_and_si128(_mm_srl_epi16(lo, round_count), one));
+                hi = _mm_add_epi16(_mm_srl_epi16(hi, count), _mm_and_si128(_mm_srl_epi16(hi, round_count), one));
+            }
+            _mm_storeu_si128((__m128i *)(gains + i), lo);
+            _mm_storeu_si128((__m128i *)(gains + i + 8), hi);
+        }
+#endif
+        for (; i < num_values; i++)
+            gains[i] = ia_nvm_lsc_convert(table[i], shift);
+    } else {
+        const uint16_t *table = (const uint16_t *)lsc->lsc_tables[channel];
+#ifdef IA_NVM_LSC_HAS_SSE2
+        const __m128i count = _mm_cvtsi32_si128(shift >= 0 ? shift : -shift);
+        const __m128i round_count = _mm_cvtsi32_si128(shift >= 0 ? 0 : -shift - 1);
+        const __m128i one = _mm_set1_epi16(1);
+        for (; i + 8 <= num_values; i += 8) {
+            __m128i values = _mm_loadu_si128((const __m128i *)(table + i));
+            if (shift >= 0)
+                values = _mm_sll_epi16(values, count);
+            else
+                values = _mm_add_epi16(_mm_srl_epi16(values, count), _mm_and_si128(_mm_srl_epi16(values, round_count), one));
+            _mm_storeu_si128((__m128i *)(gains + i), values);
+        }
+#endif
+        for (; i < num_values; i++)
+            gains[i] = ia_nvm_lsc_convert(table[i], shift);
+    }
+    return ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_NVM_LSC_H_ */
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_task.h
+ * \brief Worker pool abstraction used by IA helpers which fan out independent work items.
+ *
+ * Client can hand its own thread pool to the helpers by filling ia_task_env. If no environment is given,
+ * work items are executed on short lived POSIX threads (or serially on platforms without pthreads).
+ */
+
+#ifndef _IA_TASK_H_
+#define _IA_TASK_H_
+
+#include "ia_types.h"
+#include "ia_abstraction.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Work item callback.
+ * \param[in] arg    User argument given to ia_task_run.
+ * \param[in] index  Index of the work item [0, num_items - 1].
+ */
+typedef void (*ia_task_func)(void *arg, unsigned int index);
+
+/*!
+ * \brief Client provided worker pool.
+ * parallel_for must call task(arg, i) exactly once for each i in [0, num_items - 1] and return only after all calls have completed.
+ * Calls may be executed in any order and on any thread.
+ */
+typedef struct
+{
+    void *pool;                                          /*!< Client specific worker pool handle. */
+    void (*parallel_for)(void *pool,
+                         ia_task_func task,
+                         void *arg,
+                         unsigned int num_items);        /*!< Mandatory. Executes all work items and waits for their completion. */
+} ia_task_env;
+
+#if !defined(_WIN32) && !defined(WIN32) && !defined(__BUILD_FOR_GSD_AOH__)
+#define IA_TASK_HAS_PTHREAD 1
+#endif
+
+/*!
+ * \brief Maximum number of threads the default executor spawns for one ia_task_run call.
+ */
+#define IA_TASK_MAX_DEFAULT_THREADS 16
+
+#ifdef IA_TASK_HAS_PTHREAD
+typedef struct
+{
+    ia_task_func task;
+    void *arg;
+    unsigned int first;
+    unsigned int count;
+} ia_task_slice;
+
+static inline void *
+ia_task_slice_entry(void *slice_ptr)
+{
+    ia_task_slice *slice = (ia_task_slice *)slice_ptr;
+    unsigned int i;
+    for (i = slice->first; i < slice->first + slice->count; i++)
+        slice->task(slice->arg, i);
+    return NULL;
+}
+#endif
+
+/*!
+ * \brief Executes num_items work items and waits for their completion.
+ * If task_env is given, work items are dispatched to the client worker pool. Otherwise work items are split into
+ * at most IA_TASK_MAX_DEFAULT_THREADS slices, one of which is executed on the calling thread. If a thread can't be created,
+ * its slice is executed on the calling thread so that all work items are always run.
+ *
+ * \param[in] task_env   Optional. Client worker pool. NULL to use the default executor.
+ * \param[in] task       Mandatory. Work item callback.
+ * \param[in] arg        Optional. Argument passed to each work item.
+ * \param[in] num_items  Number of work items.
+ */
+static inline void
+ia_task_run(const ia_task_env *task_env,
+            ia_task_func task,
+            void *arg,
+            unsigned int num_items)
+{
+    if (task == NULL || num_items == 0)
+        return;
+
+    if (task_env != NULL && task_env->parallel_for != NULL) {
+        task_env->parallel_for(task_env->pool, task, arg, num_items);
+        return;
+    }
+
+#ifdef IA_TASK_HAS_PTHREAD
+    {
+        ia_task_slice slices[IA_TASK_MAX_DEFAULT_THREADS];
+        pthread_t threads[IA_TASK_MAX_DEFAULT_THREADS];
+        bool started[IA_TASK_MAX_DEFAULT_THREADS];
+        unsigned int num_slices = IA_MIN(num_items, (unsigned int)IA_TASK_MAX_DEFAULT_THREADS);
+        unsigned int first = 0;
+        unsigned int i;
+
+        for (i = 0; i < num_slices; i++) {
+            slices[i].task = task;
+            slices[i].arg = arg;
+            slices[i].first = first;
+            slices[i].count = num_items / num_slices + (i < num_items % num_slices ? 1 : 0);
+            first += slices[i].count;
+            started[i] = false;
+        }
+
+        /* Slice 0 runs on the calling thread. */
+        for (i = 1; i < num_slices; i++)
+            started[i] = (pthread_create(&threads[i], NULL, ia_task_slice_entry, &slices[i]) == 0);
+
+        ia_task_slice_entry(&slices[0]);
+
+        for (i = 1; i < num_slices; i++) {
+            if (started[i])
+                pthread_join(threads[i], NULL);
+            else
+                ia_task_slice_entry(&slices[i]);
+        }
+    }
+#else
+    {
+        unsigned int i;
+        for (i = 0; i < num_items; i++)
+            task(arg, i);
+    }
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_TASK_H_ */
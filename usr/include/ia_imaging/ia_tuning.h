@@ -0,0 +1,470 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_tuning.h
+ * \brief Tuning handle shared by AIQ, ISP, LTM, DVS and ME corner initialization.
+ *
+ * ia_tuning opens the AIQB file once (memory mapped, see ia_cmc_file.h), parses the CMC once and indexes the records of
+ * the file by data name ID, so that a record is found in constant time. All components are initialized from the same
+ * mapping and the same parsed CMC instead of each getting its own copy of the tuning.
+ *
+ * After ia_tuning_open the handle is read-only. Components can therefore be initialized concurrently from different
+ * threads, either by calling the ia_tuning_*_init functions directly or with ia_tuning_init_components, which initializes
+ * the requested components in parallel:
+ * \code
+ * ia_tuning tuning;
+ * ia_tuning_components_params params;
+ * ia_tuning_components components;
+ *
+ * ia_tuning_open(&tuning, "/etc/camera/ipu4p/imx185.aiqb", nvm_data);
+ * memset(&params, 0, sizeof(params));
+ * params.components = ia_tuning_component_aiq | ia_tuning_component_isp_bxt | ia_tuning_component_ltm;
+ * params.stats_max_width = 80;
+ * ...
+ * ia_tuning_init_components(&tuning, NULL, &params, &components);
+ * ...
+ * ia_tuning_deinit_components(&components);
+ * ia_tuning_close(&tuning);
+ * \endcode
+ *
+ * The tuning handle must outlive all components initialized from it.
+ *
+ * ME corner detection is opt-in: define IA_TUNING_WITH_ME_CORNER before including this header. ia_me_corner.h includes
+ * dvs_stat_public.h, which is not part of this SDK, so the ME corner wrapper can only be built where that header is
+ * available.
+ */
+
+#ifndef _IA_TUNING_H_
+#define _IA_TUNING_H_
+
+#include "ia_aiq.h"
+#include "ia_cmc_file.h"
+#include "ia_dvs.h"
+#include "ia_isp_bxt.h"
+#include "ia_ltm.h"
+#if defined(IA_TUNING_WITH_ME_CORNER)
+#include "ia_me_corner.h"
+#endif
+#include "ia_task.h"
+#include "ia_types.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Index entry of a record.
+ */
+typedef struct
+{
+    uint32_t offset;        /*!< Offset of the record in AIQB. 0 for an empty entry. */
+    uint16_t data_name_id;  /*!< Data name ID of the record. */
+} ia_tuning_index_entry;
+
+/*!
+ * \brief Tuning handle.
+ */
+typedef struct
+{
+    ia_cmc_file file;                   /*!< AIQB file. */
+    ia_binary_data nvm;                 /*!< NVM data given to ia_tuning_open. Not owned by the handle. */
+    ia_tuning_index_entry *index;       /*!< Open addressing hash table of the records. */
+    unsigned int index_mask;            /*!< Number of entries in the index - 1. */
+    unsigned int num_records;           /*!< Number of records in AIQB. */
+} ia_tuning;
+
+static inline unsigned int
+ia_tuning_index_hash(uint16_t data_name_id, unsigned int mask)
+{
+    return (unsigned int)((data_name_id * 2654435761U) >> 16) & mask;
+}
+
+static inline ia_err
+ia_tuning_build_index(ia_tuning *tuning)
+{
+    const unsigned char *data = (const unsigned char *)tuning->file.aiqb.data;
+    ia_mkn_header header;
+    unsigned int capacity = 16;
+    size_t offset;
+
+    memcpy(&header, data, sizeof(header));
+    tuning->num_records = 0;
+    for (offset = sizeof(header); offset + sizeof(ia_mkn_record_header) <= header.size; ) {
+        ia_mkn_record_header record;
+        memcpy(&record, data + offset, sizeof(record));
+        if (record.size < sizeof(record) || record.size > header.size - offset)
+            return ia_err_data;
+        tuning->num_records++;
+        offset += record.size;
+    }
+
+    /* Load factor is kept at or below 1/2. */
+    while (capacity < tuning->num_records * 2)
+        capacity *= 2;
+    tuning->index = (ia_tuning_index_entry *)IA_CALLOC(capacity * sizeof(ia_tuning_index_entry));
+    if (tuning->index == NULL)
+        return ia_err_nomemory;
+    tuning->index_mask = capacity - 1;
+
+    for (offset = sizeof(header); offset + sizeof(ia_mkn_record_header) <= header.size; ) {
+        ia_mkn_record_header record;
+        unsigned int i;
+        memcpy(&record, data + offset, sizeof(record));
+        i = ia_tuning_index_hash(record.data_name_id, tuning->index_mask);
+        while (tuning->index[i].offset != 0 && tuning->index[i].data_name_id != record.data_name_id)
+            i = (i + 1) & tuning->index_mask;
+        /* The first record wins, same as in ia_cmc_file_find_record. */
+        if (tuning->index[i].offset == 0) {
+            tuning->index[i].offset = (uint32_t)offset;
+            tuning->index[i].data_name_id = record.data_name_id;
+        }
+        offset += record.size;
+    }
+    return ia_err_none;
+}
+
+/*!
+ * \brief Closes tuning. Components initialized from the tuning must be deinitialized before this call.
+ */
+static inline void
+ia_tuning_close(ia_tuning *tuning)
+{
+    if (tuning == NULL)
+        return;
+    IA_FREEZ(tuning->index);
+    ia_cmc_file_close(&tuning->file);
+    memset(tuning, 0, sizeof(*tuning));
+}
+
+/*!
+ * \brief Opens tuning. AIQB file is mapped, its records are indexed and the CMC is parsed.
+ *
+ * \param[out] tuning    Mandatory. Tuning handle.
+ * \param[in]  path      Mandatory. Path of the AIQB file.
+ * \param[in]  nvm_data  Optional. NVM data. Must stay valid until the tuning is closed.
+ * \return               Error code. ia_err_data, if the file is not valid AIQB.
+ */
+static inline ia_err
+ia_tuning_open(ia_tuning *tuning,
+               const char *path,
+               const ia_binary_data *nvm_data)
+{
+    ia_err err;
+
+    if (tuning == NULL || path == NULL)
+        return ia_err_argument;
+    memset(tuning, 0, sizeof(*tuning));
+
+    err = ia_cmc_file_open(&tuning->file, path);
+    if (err != ia_err_none)
+        return err;
+    if (nvm_data != NULL)
+        tuning->nvm = *nvm_data;
+
+    err = ia_tuning_build_index(tuning);
+    if (err == ia_err_none && ia_cmc_file_get_cmc(&tuning->file, nvm_data) == NULL)
+        err = ia_err_data;
+    if (err != ia_err_none)
+        ia_tuning_close(tuning);
+    return err;
+}
+
+/*!
+ * \brief Returns contents of the AIQB file.
+ */
+static inline const ia_binary_data *
+ia_tuning_aiqb(const ia_tuning *tuning)
+{
+    return tuning != NULL ? ia_cmc_file_aiqb(&tuning->file) : NULL;
+}
+
+/*!
+ * \brief Returns NVM data or NULL, if no NVM data was given.
+ */
+static inline const ia_binary_data *
+ia_tuning_nvm(const ia_tuning *tuning)
+{
+    return tuning != NULL && tuning->nvm.data != NULL ? &tuning->nvm : NULL;
+}
+
+/*!
+ * \brief Returns the parsed CMC. CMC is owned by the tuning.
+ */
+static inline ia_cmc_t *
+ia_tuning_cmc(const ia_tuning *tuning)
+{
+    return tuning != NULL ? tuning->file.ia_cmc : NULL;
+}
+
+/*!
+ * \brief Finds a record from AIQB in constant time.
+ * See ia_cmc_file_find_record for layout and alignment of the returned record.
+ *
+ * \param[in] tuning        Mandatory. Tuning handle.
+ * \param[in] data_name_id  Mandatory. Name ID of the record, e.g. cmc_name_id_general_data.
+ * \return                  Header of the first record with the name ID or NULL, if not found.
+ */
+static inline const ia_mkn_record_header *
+ia_tuning_find_record(const ia_tuning *tuning, uint16_t data_name_id)
+{
+    unsigned int i;
+
+    if (tuning == NULL || tuning->index == NULL)
+        return NULL;
+    i = ia_tuning_index_hash(data_name_id, tuning->index_mask);
+    while (tuning->index[i].offset != 0) {
+        if (tuning->index[i].data_name_id == data_name_id)
+            return (const ia_mkn_record_header *)((const unsigned char *)tuning->file.aiqb.data + tuning->index[i].offset);
+        i = (i + 1) & tuning->index_mask;
+    }
+    return NULL;
+}
+
+/*!
+ * \brief Initializes AIQ from the tuning. See ia_aiq_init.
+ */
+static inline ia_aiq *
+ia_tuning_aiq_init(const ia_tuning *tuning,
+                   const ia_binary_data *aiqd_data,
+                   unsigned int stats_max_width,
+                   unsigned int stats_max_height,
+                   unsigned int max_num_stats_in,
+                   ia_mkn *ia_mkn)
+{
+    if (tuning == NULL)
+        return NULL;
+    return ia_aiq_init(ia_tuning_aiqb(tuning), ia_tuning_nvm(tuning), aiqd_data,
+                       stats_max_width, stats_max_height, max_num_stats_in, ia_tuning_cmc(tuning), ia_mkn);
+}
+
+/*!
+ * \brief Initializes ISP adaptation from the tuning. See ia_isp_bxt_init.
+ */
+static inline ia_isp_bxt *
+ia_tuning_isp_bxt_init(const ia_tuning *tuning,
+                       unsigned int max_stats_width,
+                       unsigned int max_stats_height,
+                       unsigned int max_num_stats_in,
+                       ia_mkn *ia_mkn)
+{
+    if (tuning == NULL)
+        return NULL;
+    return ia_isp_bxt_init(ia_tuning_aiqb(tuning), ia_tuning_cmc(tuning),
+                           max_stats_width, max_stats_height, max_num_stats_in, ia_mkn);
+}
+
+/*!
+ * \brief Initializes LTM from the tuning. See ia_ltm_init.
+ */
+static inline ia_ltm *
+ia_tuning_ltm_init(const ia_tuning *tuning, ia_mkn *ia_mkn)
+{
+    if (tuning == NULL)
+        return NULL;
+    return ia_ltm_init(ia_tuning_aiqb(tuning), ia_mkn);
+}
+
+/*!
+ * \brief Initializes DVS from the tuning. See ia_dvs_init.
+ */
+static inline ia_err
+ia_tuning_dvs_init(const ia_tuning *tuning, ia_dvs_state **dvs_state)
+{
+    if (tuning == NULL)
+        return ia_err_argument;
+    return ia_dvs_init(dvs_state, ia_tuning_aiqb(tuning), ia_tuning_cmc(tuning));
+}
+
+#if defined(IA_TUNING_WITH_ME_CORNER)
+/*!
+ * \brief Initializes ME corner detection from the tuning. See ia_me_corner_init.
+ */
+static inline ia_err
+ia_tuning_me_corner_init(const ia_tuning *tuning, ia_me_corner_state **me_corner_state)
+{
+    if (tuning == NULL)
+        return ia_err_argument;
+    return ia_me_corner_init(me_corner_state, ia_tuning_aiqb(tuning));
+}
+#endif
+
+/*!
+ * \brief Components initialized by ia_tuning_init_components.
+ */
+typedef enum
+{
+    ia_tuning_component_aiq       = (1 << 0),
+    ia_tuning_component_isp_bxt   = (1 << 1),
+    ia_tuning_component_ltm       = (1 << 2),
+    ia_tuning_component_dvs       = (1 << 3),
+#if defined(IA_TUNING_WITH_ME_CORNER)
+    ia_tuning_component_me_corner = (1 << 4)    /*!< Only with IA_TUNING_WITH_ME_CORNER. */
+#endif
+} ia_tuning_component;
+
+#if defined(IA_TUNING_WITH_ME_CORNER)
+#define IA_TUNING_NUM_COMPONENTS 5
+#else
+#define IA_TUNING_NUM_COMPONENTS 4
+#endif
+
+/*!
+ * \brief Parameters of ia_tuning_init_components.
+ */
+typedef struct
+{
+    unsigned int components;            /*!< Mandatory. Bitmask of ia_tuning_component values. */
+    const ia_binary_data *aiqd_data;    /*!< Optional. AIQD data for AIQ. */
+    unsigned int stats_max_width;       /*!< Mandatory for AIQ and ISP. Maximum statistics width. */
+    unsigned int stats_max_height;      /*!< Mandatory for AIQ and ISP. Maximum statistics height. */
+    unsigned int max_num_stats_in;      /*!< Mandatory for AIQ and ISP. Maximum number of statistics in. */
+    ia_mkn *aiq_mkn;                    /*!< Optional. Makernote handle of AIQ. */
+    ia_mkn *isp_bxt_mkn;                /*!< Optional. Makernote handle of ISP. */
+    ia_mkn *ltm_mkn;                    /*!< Optional. Makernote handle of LTM. */
+} ia_tuning_components_params;
+
+/*!
+ * \brief Initialized components. Components which were not requested or failed to initialize are NULL.
+ */
+typedef struct
+{
+    ia_aiq *ia_aiq;
+    ia_isp_bxt *ia_isp_bxt;
+    ia_ltm *ia_ltm;
+    ia_dvs_state *dvs_state;
+#if defined(IA_TUNING_WITH_ME_CORNER)
+    ia_me_corner_state *me_corner_state;
+#endif
+} ia_tuning_components;
+
+typedef struct
+{
+    const ia_tuning *tuning;
+    const ia_tuning_components_params *params;
+    ia_tuning_components *components;
+    ia_err err[IA_TUNING_NUM_COMPONENTS];
+} ia_tuning_components_work;
+
+static inline void
+ia_tuning_init_component(void *arg, unsigned int index)
+{
+    ia_tuning_components_work *work = (ia_tuning_components_work *)arg;
+    const ia_tuning_components_params *params = work->params;
+    ia_tuning_components *components = work->components;
+    ia_err err = ia_err_none;
+
+    if ((params->components & (1U << index)) == 0)
+        return;
+
+    switch (1U << index) {
+    case ia_tuning_component_aiq:
+        components->ia_aiq = ia_tuning_aiq_init(work->tuning, params->aiqd_data, params->stats_max_width,
+                                                params->stats_max_height, params->max_num_stats_in, params->aiq_mkn);
+        err = components->ia_aiq != NULL ? ia_err_none : ia_err_general;
+        break;
+    case ia_tuning_component_isp_bxt:
+        components->ia_isp_bxt = ia_tuning_isp_bxt_init(work->tuning, params->stats_max_width, params->stats_max_height,
+                                                        params->max_num_stats_in, params->isp_bxt_mkn);
+        err = components->ia_isp_bxt != NULL ? ia_err_none : ia_err_general;
+        break;
+    case ia_tuning_component_ltm:
+        components->ia_ltm = ia_tuning_ltm_init(work->tuning, params->ltm_mkn);
+        err = components->ia_ltm != NULL ? ia_err_none : ia_err_general;
+        break;
+    case ia_tuning_component_dvs:
+        err = ia_tuning_dvs_init(work->tuning, &components->dvs_state);
+        break;
+#if defined(IA_TUNING_WITH_ME_CORNER)
+    case ia_tuning_component_me_corner:
+        err = ia_tuning_me_corner_init(work->tuning, &components->me_corner_state);
+        break;
+#endif
+    default:
+        break;
+    }
+    work->err[index] = err;
+}
+
+/*!
+ * \brief Deinitializes components. Components which are NULL are skipped.
+ */
+static inline void
+ia_tuning_deinit_components(ia_tuning_components *components)
+{
+    if (components == NULL)
+        return;
+    if (components->ia_aiq != NULL)
+        ia_aiq_deinit(components->ia_aiq);
+    if (components->ia_isp_bxt != NULL)
+        ia_isp_bxt_deinit(components->ia_isp_bxt);
+    if (components->ia_ltm != NULL)
+        ia_ltm_deinit(components->ia_ltm);
+    if (components->dvs_state != NULL)
+        ia_dvs_deinit(components->dvs_state);
+#if defined(IA_TUNING_WITH_ME_CORNER)
+    if (components->me_corner_state != NULL)
+        ia_me_corner_deinit(components->me_corner_state);
+#endif
+    memset(components, 0, sizeof(*components));
+}
+
+/*!
+ * \brief Initializes the requested components in parallel, each on its own work item.
+ * Different makernote handles should be given to the components, since makernote handles are not thread-safe.
+ *
+ * \param[in]  tuning      Mandatory. Tuning handle.
+ * \param[in]  env         Optional. Worker pool. If NULL, default executor of ia_task_run is used.
+ * \param[in]  params      Mandatory. Components to initialize and their parameters.
+ * \param[out] components  Mandatory. Initialized components.
+ * \return                 Error code. If any component fails, all components are deinitialized.
+ */
+static inline ia_err
+ia_tuning_init_components(const ia_tuning *tuning,
+                          const ia_task_env *env,
+                          const ia_tuning_components_params *params,
+                          ia_tuning_components *components)
+{
+    ia_tuning_components_work work;
+    unsigned int i;
+
+    if (components != NULL)
+        memset(components, 0, sizeof(*components));
+    if (tuning == NULL || ia_tuning_cmc(tuning) == NULL || params == NULL || components == NULL)
+        return ia_err_argument;
+
+    memset(&work, 0, sizeof(work));
+    work.tuning = tuning;
+    work.params = params;
+    work.components = components;
+    ia_task_run(env, ia_tuning_init_component, &work, IA_TUNING_NUM_COMPONENTS);
+
+    for (i = 0; i < IA_TUNING_NUM_COMPONENTS; i++) {
+        if (work.err[i] != ia_err_none) {
+            ia_tuning_deinit_components(components);
+            return work.err[i];
+        }
+    }
+    return ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_TUNING_H_ */
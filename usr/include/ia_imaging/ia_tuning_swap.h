@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_tuning_swap.h
+ * \brief Switching AIQ and LTM tunings at run-time in two phases.
+ *
+ * ia_aiq_set_tuning and ia_ltm_set_tuning process the new tuning on the calling thread. With the functions of this file
+ * the work is split into two phases:
+ * - Prepare (any thread): the new AIQB is copied and validated, its CMC is parsed and, for AIQ, a new instance is
+ *   initialized with the tuning. The running instance is not touched.
+ * - Commit (thread running the algorithms, between frames): the prepared tuning replaces the active one. Tuning that was
+ *   replaced is returned and is released later with the release function, again on any thread.
+ *
+ * AIQ commit is a pointer swap. To keep the AIQ transition smooth, the new instance is initialized with AIQD of the
+ * running instance (see ia_aiq_get_aiqd_data) and it is warmed up with ia_aiq_tuning_warm_up for a few frames before the
+ * commit. Warm up runs AE and AWB of the new instance with the same statistics as the running instance, so that their
+ * temporal filtering has converged when the new instance takes over. Without warm up, AWB of the new instance starts
+ * from its initial convergence.
+ * LTM has no exportable state, so LTM commit uses ia_ltm_set_tuning with the prepared data and keeps the smooth transition
+ * of the library.
+ * \code
+ * // 3A thread, when a new tuning has been pushed:
+ * ia_aiq_get_aiqd_data(active->ia_aiq, &aiqd); // copy AIQD into a buffer owned by the request
+ * // Worker thread:
+ * request->prepared = ia_aiq_tuning_prepare(&request->aiqb, nvm, &request->aiqd, 80, 60, 1, NULL);
+ * // Worker thread, for the next frames, with the statistics given to the running instance:
+ * ia_aiq_tuning_warm_up(request->prepared, snapshot.params, &ae_input_params, &awb_input_params);
+ * // 3A thread, at a frame boundary after the warm up:
+ * ia_aiq_tuning_commit(&active, request->prepared, &retired);
+ * // Any thread, when results of the retired instance are not referenced anymore:
+ * ia_aiq_tuning_release(retired);
+ * \endcode
+ */
+
+#ifndef _IA_TUNING_SWAP_H_
+#define _IA_TUNING_SWAP_H_
+
+#include "ia_aiq.h"
+#include "ia_aiq_clone.h"
+#include "ia_ltm.h"
+#include "ia_abstraction.h"
+#include "ia_types.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * \brief Copies tuning data into a private buffer and validates AIQB header and checksum.
+ */
+static inline ia_err
+ia_tuning_swap_copy(ia_binary_data *dst, const ia_binary_data *src)
+{
+    ia_mkn_header header;
+    uint32_t checksum = 0;
+    size_t i;
+
+    dst->data = NULL;
+    dst->size = 0;
+    if (src == NULL || src->data == NULL || src->size < sizeof(header))
+        return ia_err_argument;
+    memcpy(&header, src->data, sizeof(header));
+    if (header.tag != AIQB_TAG || header.size < sizeof(header) || header.size > src->size)
+        return ia_err_data;
+
+    for (i = 0; i + sizeof(uint32_t) <= header.size; i += sizeof(uint32_t)) {
+        uint32_t word;
+        if (i == offsetof(ia_mkn_header, checksum))
+            continue;
+        memcpy(&word, (const unsigned char *)src->data + i, sizeof(word));
+        checksum += word;
+    }
+    if (checksum != header.checksum)
+        return ia_err_data;
+
+    dst->data = IA_ALLOC(header.size);
+    if (dst->data == NULL)
+        return ia_err_nomemory;
+    memcpy(dst->data, src->data, header.size);
+    dst->size = header.size;
+    return ia_err_none;
+}
+
+/*!
+ * \brief AIQ instance with the tuning it was initialized with.
+ */
+typedef struct
+{
+    ia_binary_data aiqb_data;   /*!< Private copy of the tuning. */
+    ia_aiq_shared *shared;      /*!< Initialization context holding the CMC parsed from the tuning. */
+    ia_aiq *ia_aiq;             /*!< AIQ instance running with the tuning. */
+} ia_aiq_tuning;
+
+/*!
+ * \brief Releases a tuning and its AIQ instance. Can be called on any thread.
+ */
+static inline void
+ia_aiq_tuning_release(ia_aiq_tuning *tuning)
+{
+    if (tuning == NULL)
+        return;
+    ia_aiq_clone_deinit(tuning->shared, tuning->ia_aiq);
+    ia_aiq_shared_deinit(tuning->shared);
+    IA_FREEZ(tuning->aiqb_data.data);
+    IA_FREEZ(tuning);
+}
+
+/*!
+ * \brief Prepares a tuning: copies and validates the AIQB, parses CMC and initializes an AIQ instance with it.
+ * Can be called on any thread while the active instance keeps running.
+ *
+ * \param[in]     aiqb_data         Mandatory. New tuning. Copied, so it can be released after the call.
+ * \param[in]     nvm_data          Optional. NVM data. Must be kept available until the tuning is released.
+ * \param[in]     aiqd_data         Optional. AIQD of the running instance for a smooth transition. Not used after the call.
+ * \param[in]     stats_max_width   Mandatory. Maximum width of RGBS and AF statistics grids from ISP.
+ * \param[in]     stats_max_height  Mandatory. Maximum height of RGBS and AF statistics grids from ISP.
+ * \param[in]     max_num_stats_in  Mandatory. The maximum number of input statistics for one frame.
+ * \param[in,out] ia_mkn            Optional. Makernote handle. Can't be the handle used by the running instance.
+ * \return                          Prepared tuning or NULL, if the tuning is invalid or in case of an error.
+ */
+static inline ia_aiq_tuning *
+ia_aiq_tuning_prepare(const ia_binary_data *aiqb_data,
+                      const ia_binary_data *nvm_data,
+                      const ia_binary_data *aiqd_data,
+                      unsigned int stats_max_width,
+                      unsigned int stats_max_height,
+                      unsigned int max_num_stats_in,
+                      ia_mkn *ia_mkn)
+{
+    ia_aiq_tuning *tuning = (ia_aiq_tuning *)IA_CALLOC(sizeof(ia_aiq_tuning));
+
+    if (tuning == NULL)
+        return NULL;
+    if (ia_tuning_swap_copy(&tuning->aiqb_data, aiqb_data) != ia_err_none) {
+        IA_FREEZ(tuning);
+        return NULL;
+    }
+    tuning->shared = ia_aiq_shared_init(&tuning->aiqb_data, nvm_data, aiqd_data,
+                                        stats_max_width, stats_max_height, max_num_stats_in, NULL);
+    if (tuning->shared != NULL)
+        tuning->ia_aiq = ia_aiq_clone(tuning->shared, NULL, ia_mkn);
+    if (tuning->ia_aiq == NULL) {
+        ia_aiq_tuning_release(tuning);
+        return NULL;
+    }
+    return tuning;
+}
+
+/*!
+ * \brief Runs AE and AWB of a prepared tuning with statistics of the running instance.
+ * Can be called on any thread, but not concurrently with itself for the same tuning. Results are discarded.
+ *
+ * \param[in,out] tuning                   Mandatory. Prepared tuning.
+ * \param[in]     statistics_input_params  Mandatory. Statistics given to the running instance for the frame.
+ *                                         Must stay valid until the call returns.
+ * \param[in]     ae_input_params          Optional. AE is not run, if NULL.
+ * \param[in]     awb_input_params         Optional. AWB is not run, if NULL.
+ * \return                                 Error code.
+ */
+static inline ia_err
+ia_aiq_tuning_warm_up(ia_aiq_tuning *tuning,
+                      const ia_aiq_statistics_input_params_v1 *statistics_input_params,
+                      const ia_aiq_ae_input_params *ae_input_params,
+                      const ia_aiq_awb_input_params *awb_input_params)
+{
+    ia_aiq_ae_results *ae_results = NULL;
+    ia_aiq_awb_results *awb_results = NULL;
+    ia_err err;
+
+    if (tuning == NULL || statistics_input_params == NULL)
+        return ia_err_argument;
+    err = ia_aiq_statistics_set_v1(tuning->ia_aiq, statistics_input_params);
+    if (err == ia_err_none && ae_input_params != NULL)
+        err = ia_aiq_ae_run(tuning->ia_aiq, ae_input_params, &ae_results);
+    if (err == ia_err_none && awb_input_params != NULL)
+        err = ia_aiq_awb_run(tuning->ia_aiq, awb_input_params, &awb_results);
+    return err;
+}
+
+/*!
+ * \brief Makes a prepared tuning active. Call between frames on the thread running AIQ.
+ * After the call algorithms are run with (*active)->ia_aiq. Results of the replaced instance stay valid until it is
+ * released, so they can still be given as frame_ae_parameters and awb_results of the frames exposed with them.
+ *
+ * \param[in,out] active    Mandatory. Active tuning. May point to NULL before the first commit.
+ * \param[in]     prepared  Mandatory. Prepared tuning.
+ * \param[out]    retired   Mandatory. Replaced tuning (NULL, if there was none) to be released with ia_aiq_tuning_release.
+ * \return                  Error code.
+ */
+static inline ia_err
+ia_aiq_tuning_commit(ia_aiq_tuning **active,
+                     ia_aiq_tuning *prepared,
+                     ia_aiq_tuning **retired)
+{
+    if (active == NULL || prepared == NULL || retired == NULL)
+        return ia_err_argument;
+    *retired = *active;
+    *active = prepared;
+    return ia_err_none;
+}
+
+/*!
+ * \brief Validated LTM tuning.
+ */
+typedef struct
+{
+    ia_binary_data aiqb_data;   /*!< Private copy of the tuning. */
+} ia_ltm_tuning;
+
+/*!
+ * \brief Releases a LTM tuning. Can be called on any thread.
+ */
+static inline void
+ia_ltm_tuning_release(ia_ltm_tuning *tuning)
+{
+    if (tuning == NULL)
+        return;
+    IA_FREEZ(tuning->aiqb_data.data);
+    IA_FREEZ(tuning);
+}
+
+/*!
+ * \brief Prepares a LTM tuning: copies and validates the AIQB. Can be called on any thread.
+ *
+ * \param[in] aiqb_data  Mandatory. New tuning. Copied, so it can be released after the call.
+ * \return               Prepared tuning or NULL, if the tuning is invalid or in case of an error.
+ */
+static inline ia_ltm_tuning *
+ia_ltm_tuning_prepare(const ia_binary_data *aiqb_data)
+{
+    ia_ltm_tuning *tuning = (ia_ltm_tuning *)IA_CALLOC(sizeof(ia_ltm_tuning));
+
+    if (tuning == NULL)
+        return NULL;
+    if (ia_tuning_swap_copy(&tuning->aiqb_data, aiqb_data) != ia_err_none) {
+        IA_FREEZ(tuning);
+        return NULL;
+    }
+    return tuning;
+}
+
+/*!
+ * \brief Sets a prepared tuning to LTM with ia_ltm_set_tuning. Call between frames on the thread running LTM.
+ * The active tuning is kept alive until it is replaced, because LTM may refer to the tuning data.
+ *
+ * \param[in,out] ia_ltm    Mandatory. LTM instance.
+ * \param[in,out] active    Mandatory. Active tuning. May point to NULL, if LTM is running with a tuning of the client.
+ * \param[in]     prepared  Mandatory. Prepared tuning.
+ * \param[out]    retired   Mandatory. Tuning to be released with ia_ltm_tuning_release: the replaced one, or the prepared
+ *                          one in case of an error.
+ * \return                  Error code. Active tuning is not changed in case of an error.
+ */
+static inline ia_err
+ia_ltm_tuning_commit(ia_ltm *ia_ltm,
+                     ia_ltm_tuning **active,
+                     ia_ltm_tuning *prepared,
+                     ia_ltm_tuning **retired)
+{
+    ia_err err;
+
+    if (ia_ltm == NULL || active == NULL || prepared == NULL || retired == NULL)
+        return ia_err_argument;
+    err = ia_ltm_set_tuning(ia_ltm, &prepared->aiqb_data);
+    if (err != ia_err_none) {
+        *retired = prepared;
+        return err;
+    }
+    *retired = *active;
+    *active = prepared;
+    return ia_err_none;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IA_TUNING_SWAP_H_ */
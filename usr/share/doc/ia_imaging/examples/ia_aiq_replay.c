@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_aiq_replay.c
+ * \brief Replays an AIQ recording (see ia_aiq_record.h) without a sensor.
+ *
+ * Each pass initializes a fresh AIQ instance with the given tuning, drives it with the recorded statistics and input
+ * parameters of every record, and compares the results with the recorded ones. Prints the number of mismatches per
+ * algorithm and timing of each algorithm over all passes. Exit status is 0, if all results were equal to the
+ * recording, 1 otherwise.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 $(pkg-config --cflags ia_imaging) ia_aiq_replay.c -o ia_aiq_replay \
+ *       $(pkg-config --libs ia_imaging) -lia_aiq -lia_cmc_parser -lia_aiqb_parser -lia_exc -lia_mkn -lia_log -lpthread -lm
+ * Against an uninstalled tree, add --define-variable=prefix=<tree>/usr to pkg-config and -Wl,-rpath-link,<tree>/usr/lib64
+ * to the link, and run with LD_LIBRARY_PATH=<tree>/usr/lib64.
+ *
+ * Run:
+ *   ia_aiq_replay <recording> [aiqb file] [passes]
+ * Defaults are /etc/camera/ipu4p/imx185.aiqb and 1 pass. The tuning must be the one the recording was made with.
+ */
+
+#include "ia_aiq_record.h"
+#include "ia_cmc_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *record_names[ia_aiq_record_type_num] = { "stats", "ae", "af", "awb", "gbce", "sa", "pa" };
+static const char *algo_names[ia_aiq_perf_num_algos] = { "stats", "ae", "af", "awb", "gbce", "dsd", "sa", "pa" };
+
+static int
+replay_load(const char *path, ia_binary_data *data)
+{
+    FILE *file = fopen(path, "rb");
+    long size;
+
+    if (file == NULL)
+        return -1;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data->data = malloc((size_t)size);
+    data->size = (unsigned int)size;
+    if (data->data == NULL || fread(data->data, 1, (size_t)size, file) != (size_t)size) {
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    return 0;
+}
+
+/*!
+ * \brief Adds counters of one pass into the counters of all passes.
+ */
+static void
+replay_accumulate(ia_aiq_perf_stats *total, const ia_aiq_perf_stats *pass)
+{
+    unsigned int i;
+
+    for (i = 0; i < ia_aiq_perf_num_algos; i++) {
+        ia_aiq_perf_counter *t = &total->algos[i];
+        const ia_aiq_perf_counter *p = &pass->algos[i];
+        if (p->num_calls == 0)
+            continue;
+        if (t->num_calls == 0 || p->min_ns < t->min_ns)
+            t->min_ns = p->min_ns;
+        if (p->max_ns > t->max_ns)
+            t->max_ns = p->max_ns;
+        t->num_calls += p->num_calls;
+        t->num_errors += p->num_errors;
+        t->total_ns += p->total_ns;
+        t->last_ns = p->last_ns;
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *aiqb_path = argc > 2 ? argv[2] : "/etc/camera/ipu4p/imx185.aiqb";
+    int passes = argc > 3 ? atoi(argv[3]) : 1;
+    ia_aiq_replay replay;
+    ia_aiq_replay_report report;
+    ia_aiq_perf_stats perf;
+    unsigned int mismatches[ia_aiq_record_type_num];
+    unsigned int i;
+    ia_binary_data aiqb;
+    ia_cmc_t *ia_cmc;
+    ia_aiq *ia_aiq;
+    ia_err err;
+    int pass, failed = 0;
+
+    if (argc < 2 || passes <= 0 || replay_load(aiqb_path, &aiqb) != 0) {
+        fprintf(stderr, "usage: %s <recording> [aiqb file] [passes]\n", argv[0]);
+        return 1;
+    }
+    err = ia_aiq_replay_open(&replay, argv[1]);
+    if (err != ia_err_none) {
+        fprintf(stderr, "%s: can't open recording (%d)\n", argv[1], err);
+        return 1;
+    }
+    ia_cmc = ia_cmc_parser_init_v1(&aiqb, NULL);
+    if (ia_cmc == NULL) {
+        fprintf(stderr, "%s: can't parse CMC\n", aiqb_path);
+        ia_aiq_replay_close(&replay);
+        return 1;
+    }
+
+    memset(&report, 0, sizeof(report));
+    memset(&perf, 0, sizeof(perf));
+    memset(mismatches, 0, sizeof(mismatches));
+    for (pass = 0; pass < passes; pass++) {
+        ia_aiq = ia_aiq_init(&aiqb, NULL, NULL, replay.header->stats_max_width, replay.header->stats_max_height,
+                             replay.header->max_num_stats_in, ia_cmc, NULL);
+        if (ia_aiq == NULL) {
+            fprintf(stderr, "ia_aiq_init failed with %s\n", aiqb_path);
+            failed = 1;
+            break;
+        }
+        ia_aiq_replay_rewind(&replay);
+        err = ia_aiq_replay_run(&replay, ia_aiq, &report);
+        ia_aiq_deinit(ia_aiq);
+        if (err != ia_err_none) {
+            fprintf(stderr, "%s: recording is corrupted after %u records\n", argv[1], report.num_records);
+            failed = 1;
+            break;
+        }
+        if (report.num_mismatches > 0 && !failed)
+            printf("pass %d: first mismatch at frame %llu\n", pass, report.first_mismatch_frame_id);
+        for (i = 0; i < ia_aiq_record_type_num; i++)
+            mismatches[i] += report.mismatches[i];
+        failed |= report.num_mismatches > 0;
+        replay_accumulate(&perf, &report.perf);
+    }
+
+    printf("%d passes of %u frames, %u records\n", pass, report.num_frames, report.num_records);
+    printf("mismatches:");
+    for (i = 0; i < ia_aiq_record_type_num; i++)
+        printf(" %s %u", record_names[i], mismatches[i]);
+    printf("\n%-6s %8s %7s %10s %10s %10s\n", "algo", "calls", "errors", "mean us", "min us", "max us");
+    for (i = 0; i < ia_aiq_perf_num_algos; i++) {
+        const ia_aiq_perf_counter *counter = &perf.algos[i];
+        if (counter->num_calls == 0)
+            continue;
+        printf("%-6s %8llu %7llu %10.2f %10.2f %10.2f\n", algo_names[i], counter->num_calls, counter->num_errors,
+               (double)counter->total_ns / counter->num_calls * 1e-3, counter->min_ns * 1e-3, counter->max_ns * 1e-3);
+    }
+
+    ia_aiq_replay_close(&replay);
+    ia_cmc_parser_deinit(ia_cmc);
+    free(aiqb.data);
+    return failed;
+}
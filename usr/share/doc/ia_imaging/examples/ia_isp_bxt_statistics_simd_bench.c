@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2015 - 2018 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*!
+ * \file ia_isp_bxt_statistics_simd_bench.c
+ * \brief Benchmark of the statistics converters of ia_isp_bxt_statistics_simd.h against ia_isp_bxt.
+ *
+ * Times RGBS grid (96x72), filter response grid (32x32), histogram and HDR RGBS grid (96x72, two exposures)
+ * conversions of the library and of every instruction set supported by the CPU, and checks that the results are equal.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 $(pkg-config --cflags ia_imaging) ia_isp_bxt_statistics_simd_bench.c \
+ *       -o ia_isp_bxt_statistics_simd_bench $(pkg-config --libs ia_imaging) \
+ *       -lia_isp_bxt -lia_cmc_parser -lia_aiqb_parser -lia_exc -lia_mkn -lia_log -lpthread -lm
+ * Against an uninstalled tree, add --define-variable=prefix=<tree>/usr to pkg-config and -Wl,-rpath-link,<tree>/usr/lib64
+ * to the link, and run with LD_LIBRARY_PATH=<tree>/usr/lib64.
+ *
+ * Run:
+ *   ia_isp_bxt_statistics_simd_bench [aiqb file] [iterations]
+ * Defaults are /etc/camera/ipu4p/imx185.aiqb and 2000 iterations.
+ */
+
+#include "ia_isp_bxt_statistics_simd.h"
+#include "ia_isp_bxt.h"
+#include "ia_cmc_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_RGBS_GRID_WIDTH 96
+#define BENCH_RGBS_GRID_HEIGHT 72
+#define BENCH_AF_GRID_WIDTH 32
+#define BENCH_AF_GRID_HEIGHT 32
+#define BENCH_NUM_EXPOSURES 2
+
+typedef struct
+{
+    ia_isp_bxt_rgbs_grid_t rgbs_grid;
+    ia_isp_bxt_filter_response_grid_t filter_response_grid;
+    ia_isp_bxt_histograms_t histograms;
+} bench_statistics;
+
+static const char *simd_names[] = { "c", "sse2", "avx2" };
+
+static double
+bench_now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static int
+bench_load(const char *path, ia_binary_data *data)
+{
+    FILE *file = fopen(path, "rb");
+    long size;
+
+    if (file == NULL)
+        return -1;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data->data = malloc((size_t)size);
+    data->size = (unsigned int)size;
+    if (data->data == NULL || fread(data->data, 1, (size_t)size, file) != (size_t)size) {
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    return 0;
+}
+
+/*!
+ * \brief Fills statistics with values in the ranges of the ISP output, and a few out of range values.
+ */
+static void
+bench_fill(bench_statistics *statistics, ia_isp_bxt_hdr_rgbs_grid_t *hdr_grid)
+{
+    unsigned int i;
+
+    statistics->rgbs_grid.header.uuid = ia_isp_bxt_statistics_uuid_rgbs_grid;
+    statistics->rgbs_grid.header.size = sizeof(statistics->rgbs_grid);
+    statistics->rgbs_grid.grid_width = BENCH_RGBS_GRID_WIDTH;
+    statistics->rgbs_grid.grid_height = BENCH_RGBS_GRID_HEIGHT;
+    for (i = 0; i < BXT_RGBS_GRID_MAX_NUM_ELEMENTS; i++) {
+        statistics->rgbs_grid.c0_avg[i] = rand() % 300 - 20;
+        statistics->rgbs_grid.c1_avg[i] = rand() % 300 - 20;
+        statistics->rgbs_grid.c2_avg[i] = rand() % 300 - 20;
+        statistics->rgbs_grid.c3_avg[i] = rand() % 300 - 20;
+    }
+    for (i = 0; i < BXT_RGBS_GRID_MAX_NUM_ELEMENTS / 4; i++) {
+        statistics->rgbs_grid.sat_ratio_0[i] = rand() % 256;
+        statistics->rgbs_grid.sat_ratio_1[i] = rand() % 256;
+        statistics->rgbs_grid.sat_ratio_2[i] = rand() % 256;
+        statistics->rgbs_grid.sat_ratio_3[i] = rand() % 256;
+    }
+
+    statistics->filter_response_grid.header.uuid = ia_isp_bxt_statistics_uuid_filter_response_grid;
+    statistics->filter_response_grid.header.size = sizeof(statistics->filter_response_grid);
+    statistics->filter_response_grid.grid_width = BENCH_AF_GRID_WIDTH;
+    statistics->filter_response_grid.grid_height = BENCH_AF_GRID_HEIGHT;
+    for (i = 0; i < BXT_FILTER_RESPONSE_GRID_MAX_NUM_ELEMENTS; i++) {
+        statistics->filter_response_grid.y00_avg[i] = rand() % 4096;
+        statistics->filter_response_grid.y01_avg[i] = rand() % 4096;
+        statistics->filter_response_grid.y10_avg[i] = rand() % 8 == 0 ? 0xFFF : rand() % 4096;
+        statistics->filter_response_grid.y11_avg[i] = rand() % 8 == 0 ? 0xFFF : rand() % 4096;
+    }
+
+    statistics->histograms.header.uuid = ia_isp_bxt_statistics_uuid_histograms;
+    statistics->histograms.header.size = sizeof(statistics->histograms);
+    for (i = 0; i < BXT_HISTOGRAM_BINS; i++) {
+        statistics->histograms.hist_c0[i] = rand() % 1000;
+        statistics->histograms.hist_c1[i] = rand() % 1000;
+        statistics->histograms.hist_c2[i] = rand() % 1000;
+        statistics->histograms.hist_c3[i] = rand() % 1000;
+    }
+
+    /* Compressed 15 bit HDR averages. */
+    hdr_grid->header.uuid = ia_isp_bxt_statistics_uuid_hdr_rgbs_grid;
+    hdr_grid->header.size = sizeof(*hdr_grid);
+    hdr_grid->grid_width = BENCH_RGBS_GRID_WIDTH;
+    hdr_grid->grid_height = BENCH_RGBS_GRID_HEIGHT;
+    for (i = 0; i < BXT_RGBS_GRID_MAX_NUM_ELEMENTS; i++) {
+        hdr_grid->r_avg[i] = rand() % (1 << 15);
+        hdr_grid->g_avg[i] = rand() % (1 << 15);
+        hdr_grid->b_avg[i] = rand() % (1 << 15);
+        hdr_grid->sat[i] = (unsigned char)(rand() % 256);
+    }
+}
+
+static void
+bench_report(const char *name, const char *simd, double seconds, int iterations, double reference, int exact)
+{
+    double us = seconds / iterations * 1e6;
+
+    if (reference > 0.0)
+        printf("%-5s %-8s %10.2f us  %6.2fx  %s\n", name, simd, us, reference / seconds, exact ? "exact" : "MISMATCH");
+    else
+        printf("%-5s %-8s %10.2f us\n", name, simd, us);
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *aiqb_path = argc > 1 ? argv[1] : "/etc/camera/ipu4p/imx185.aiqb";
+    int iterations = argc > 2 ? atoi(argv[2]) : 2000;
+    static bench_statistics statistics;
+    static ia_isp_bxt_hdr_rgbs_grid_t hdr_grid;
+    static ia_isp_bxt_statistics_output output;
+    static ia_isp_bxt_hdr_statistics_output hdr_output;
+    static rgbs_grid_block lib_rgbs_blocks[BENCH_NUM_EXPOSURES][BXT_RGBS_GRID_MAX_NUM_ELEMENTS];
+    static hdr_rgbs_grid_block lib_hdr_blocks[BXT_RGBS_GRID_MAX_NUM_ELEMENTS];
+    ia_aiq_rgbs_grid lib_rgbs_grids[BENCH_NUM_EXPOSURES];
+    ia_aiq_rgbs_grid *lib_rgbs_grid_ptrs[BENCH_NUM_EXPOSURES];
+    ia_aiq_hdr_rgbs_grid lib_hdr_grid;
+    ia_aiq_hdr_rgbs_grid *lib_hdr_grid_ptr = &lib_hdr_grid;
+    ia_aiq_exposure_parameters exposure_parameters[BENCH_NUM_EXPOSURES];
+    ia_aiq_ae_exposure_result exposures[BENCH_NUM_EXPOSURES];
+    ia_aiq_ae_results ae_results;
+    ia_isp_bxt_hdr_compression_t hdr_compression;
+    ia_binary_data aiqb, binary, hdr_binary;
+    ia_aiq_rgbs_grid *lib_rgbs_grid = NULL, *rgbs_grid = NULL;
+    ia_aiq_grid *lib_ir_grid = NULL;
+    ia_aiq_af_grid *lib_af_grid = NULL, *af_grid = NULL;
+    ia_aiq_histogram *lib_histogram = NULL, *histogram = NULL;
+    ia_aiq_hdr_rgbs_grid *hdr_rgbs_grid = NULL;
+    double lib_awb, lib_af, lib_ae, lib_hdr, t;
+    unsigned int count = BENCH_RGBS_GRID_WIDTH * BENCH_RGBS_GRID_HEIGHT;
+    unsigned int af_count = BENCH_AF_GRID_WIDTH * BENCH_AF_GRID_HEIGHT;
+    ia_cmc_t *ia_cmc;
+    ia_isp_bxt *isp;
+    int i, e, simd, exact, failed = 0;
+
+    if (iterations <= 0 || bench_load(aiqb_path, &aiqb) != 0) {
+        fprintf(stderr, "usage: %s [aiqb file] [iterations]\n", argv[0]);
+        return 1;
+    }
+    ia_cmc = ia_cmc_parser_init_v1(&aiqb, NULL);
+    isp = ia_cmc != NULL ? ia_isp_bxt_init(&aiqb, ia_cmc, BENCH_RGBS_GRID_WIDTH, BENCH_RGBS_GRID_HEIGHT, 1, NULL) : NULL;
+    if (isp == NULL) {
+        fprintf(stderr, "ia_isp_bxt_init failed with %s\n", aiqb_path);
+        return 1;
+    }
+
+    srand(1);
+    bench_fill(&statistics, &hdr_grid);
+    binary.data = &statistics;
+    binary.size = sizeof(statistics);
+    hdr_binary.data = &hdr_grid;
+    hdr_binary.size = sizeof(hdr_grid);
+
+    /* Short and long exposure, 16x ratio. 20 bit data compressed to 15 bits with RGB average. */
+    memset(exposure_parameters, 0, sizeof(exposure_parameters));
+    memset(exposures, 0, sizeof(exposures));
+    memset(&ae_results, 0, sizeof(ae_results));
+    for (e = 0; e < BENCH_NUM_EXPOSURES; e++) {
+        exposure_parameters[e].total_target_exposure = 1000u << (4 * e);
+        exposures[e].exposure = &exposure_parameters[e];
+    }
+    ae_results.exposures = exposures;
+    ae_results.num_exposures = BENCH_NUM_EXPOSURES;
+    hdr_compression.y_compression_method = ia_isp_bxt_hdr_y_decompression_avg_rgb;
+    hdr_compression.bpp_info.input_bpp = 20;
+    hdr_compression.bpp_info.output_bpp = 15;
+    for (e = 0; e < BENCH_NUM_EXPOSURES; e++) {
+        memset(&lib_rgbs_grids[e], 0, sizeof(lib_rgbs_grids[e]));
+        lib_rgbs_grids[e].blocks_ptr = lib_rgbs_blocks[e];
+        lib_rgbs_grid_ptrs[e] = &lib_rgbs_grids[e];
+    }
+    memset(&lib_hdr_grid, 0, sizeof(lib_hdr_grid));
+    lib_hdr_grid.blocks_ptr = lib_hdr_blocks;
+
+    printf("%d iterations, RGBS grid %dx%d, AF grid %dx%d, %d HDR exposures\n", iterations, BENCH_RGBS_GRID_WIDTH,
+           BENCH_RGBS_GRID_HEIGHT, BENCH_AF_GRID_WIDTH, BENCH_AF_GRID_HEIGHT, BENCH_NUM_EXPOSURES);
+
+    t = bench_now();
+    for (i = 0; i < iterations; i++)
+        ia_isp_bxt_statistics_convert_awb_from_binary_v2(isp, &binary, NULL, NULL, &lib_rgbs_grid, &lib_ir_grid);
+    lib_awb = bench_now() - t;
+    t = bench_now();
+    for (i = 0; i < iterations; i++)
+        ia_isp_bxt_statistics_convert_af_from_binary(isp, &binary, &lib_af_grid);
+    lib_af = bench_now() - t;
+    t = bench_now();
+    for (i = 0; i < iterations; i++)
+        ia_isp_bxt_statistics_convert_ae_from_binary(isp, &binary, &lib_histogram);
+    lib_ae = bench_now() - t;
+    t = bench_now();
+    for (i = 0; i < iterations; i++)
+        ia_isp_bxt_statistics_convert_awb_hdr_from_binary_v2(isp, &hdr_binary, &ae_results, &hdr_compression, 0, 0,
+                                                             1.5f, 1.0f, 2.0f, lib_rgbs_grid_ptrs, &lib_hdr_grid_ptr);
+    lib_hdr = bench_now() - t;
+    if (lib_rgbs_grid == NULL || lib_af_grid == NULL || lib_histogram == NULL) {
+        fprintf(stderr, "library conversion failed\n");
+        return 1;
+    }
+    bench_report("awb", "library", lib_awb, iterations, 0.0, 1);
+    bench_report("af", "library", lib_af, iterations, 0.0, 1);
+    bench_report("ae", "library", lib_ae, iterations, 0.0, 1);
+    bench_report("hdr", "library", lib_hdr, iterations, 0.0, 1);
+
+    ia_isp_bxt_statistics_output_init(&output);
+    ia_isp_bxt_hdr_statistics_output_init(&hdr_output);
+    for (simd = ia_isp_bxt_simd_none; simd <= (int)ia_isp_bxt_simd_detect(); simd++) {
+        output.simd = (ia_isp_bxt_simd)simd;
+        hdr_output.simd = (ia_isp_bxt_simd)simd;
+
+        t = bench_now();
+        for (i = 0; i < iterations; i++)
+            ia_isp_bxt_statistics_convert_awb_simd(&binary, &output, &rgbs_grid);
+        t = bench_now() - t;
+        exact = rgbs_grid != NULL && memcmp(rgbs_grid->blocks_ptr, lib_rgbs_grid->blocks_ptr, count * sizeof(rgbs_grid_block)) == 0;
+        bench_report("awb", simd_names[simd], t, iterations, lib_awb, exact);
+        failed |= !exact;
+
+        t = bench_now();
+        for (i = 0; i < iterations; i++)
+            ia_isp_bxt_statistics_convert_af_simd(&binary, &output, &af_grid);
+        t = bench_now() - t;
+        exact = af_grid != NULL &&
+                memcmp(af_grid->filter_response_1, lib_af_grid->filter_response_1, af_count * sizeof(int)) == 0 &&
+                memcmp(af_grid->filter_response_2, lib_af_grid->filter_response_2, af_count * sizeof(int)) == 0;
+        bench_report("af", simd_names[simd], t, iterations, lib_af, exact);
+        failed |= !exact;
+
+        t = bench_now();
+        for (i = 0; i < iterations; i++)
+            ia_isp_bxt_statistics_convert_ae_simd(&binary, &output, &histogram);
+        t = bench_now() - t;
+        exact = histogram != NULL &&
+                memcmp(histogram->r, lib_histogram->r, BXT_HISTOGRAM_BINS * sizeof(unsigned int)) == 0 &&
+                memcmp(histogram->g, lib_histogram->g, BXT_HISTOGRAM_BINS * sizeof(unsigned int)) == 0 &&
+                memcmp(histogram->b, lib_histogram->b, BXT_HISTOGRAM_BINS * sizeof(unsigned int)) == 0 &&
+                memcmp(histogram->y, lib_histogram->y, BXT_HISTOGRAM_BINS * sizeof(unsigned int)) == 0;
+        bench_report("ae", simd_names[simd], t, iterations, lib_ae, exact);
+        failed |= !exact;
+
+        t = bench_now();
+        for (i = 0; i < iterations; i++)
+            ia_isp_bxt_statistics_convert_awb_hdr_simd(&hdr_binary, ia_cmc, &ae_results, &hdr_compression,
+                                                       1.5f, 1.0f, 2.0f, &hdr_output, &rgbs_grid, &hdr_rgbs_grid);
+        t = bench_now() - t;
+        exact = rgbs_grid != NULL && hdr_rgbs_grid != NULL &&
+                memcmp(hdr_rgbs_grid->blocks_ptr, lib_hdr_blocks, count * sizeof(hdr_rgbs_grid_block)) == 0;
+        for (e = 0; e < BENCH_NUM_EXPOSURES && exact; e++)
+            exact = memcmp(rgbs_grid[e].blocks_ptr, lib_rgbs_blocks[e], count * sizeof(rgbs_grid_block)) == 0;
+        bench_report("hdr", simd_names[simd], t, iterations, lib_hdr, exact);
+        failed |= !exact;
+    }
+
+    ia_isp_bxt_deinit(isp);
+    ia_cmc_parser_deinit(ia_cmc);
+    free(aiqb.data);
+    return failed;
+}